@@ -0,0 +1,457 @@
+#include "deflate.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace deflate {
+
+namespace {
+
+constexpr std::size_t window_size = std::size_t(1) << 15;
+constexpr std::size_t min_match = 3;
+constexpr std::size_t max_match = 258;
+/// Longer chains find longer matches in repetitive text at the cost of speed
+constexpr std::size_t max_chain_length = 64;
+/// A match this long is taken without looking for a longer one
+constexpr std::size_t nice_match = 128;
+constexpr unsigned hash_bits = 15;
+constexpr std::size_t block_symbol_count = std::size_t(1) << 16;
+
+constexpr unsigned max_code_length = 15;
+constexpr unsigned max_code_length_code_length = 7;
+constexpr std::size_t literal_length_code_count = 286;
+constexpr std::size_t distance_code_count = 30;
+constexpr std::size_t code_length_code_count = 19;
+constexpr unsigned end_of_block = 256;
+
+constexpr std::array<std::uint16_t, 29> length_bases{
+        3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+        35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr std::array<std::uint8_t, 29> length_extra_bits{
+        0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+        3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr std::array<std::uint16_t, 30> distance_bases{
+        1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+        257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr std::array<std::uint8_t, 30> distance_extra_bits{
+        0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+        7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+constexpr std::array<std::uint8_t, code_length_code_count> code_length_order{
+        16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+/// Writes bits starting from the least significant one, as deflate packs them
+class BitWriter {
+public:
+    explicit BitWriter(std::string& output) noexcept
+            : output_(output) {
+    }
+
+    void Write(std::uint32_t value, unsigned count) {
+        buffer_ |= static_cast<std::uint64_t>(value) << count_;
+        count_ += count;
+        while (count_ >= 8) {
+            output_.push_back(static_cast<char>(buffer_ & 0xFF));
+            buffer_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    /// Huffman codes are packed starting from their most significant bit
+    void WriteCode(std::uint32_t code, unsigned length) {
+        std::uint32_t reversed = 0;
+        for (unsigned i = 0; i < length; ++i) {
+            reversed = (reversed << 1) | ((code >> i) & 1);
+        }
+        Write(reversed, length);
+    }
+
+    void Flush() {
+        if (count_ > 0) {
+            output_.push_back(static_cast<char>(buffer_ & 0xFF));
+            buffer_ = 0;
+            count_ = 0;
+        }
+    }
+
+private:
+    std::string& output_;
+    std::uint64_t buffer_ = 0;
+    unsigned count_ = 0;
+};
+
+/// A literal byte if the distance is zero, otherwise a match
+struct Symbol {
+    std::uint16_t literal_or_length;
+    std::uint16_t distance;
+};
+
+[[nodiscard]] unsigned GetLengthCode(std::size_t length) noexcept {
+    const auto iter = std::upper_bound(length_bases.begin(), length_bases.end(), length);
+    return static_cast<unsigned>(std::distance(length_bases.begin(), iter) - 1);
+}
+
+[[nodiscard]] unsigned GetDistanceCode(std::size_t distance) noexcept {
+    const auto iter = std::upper_bound(distance_bases.begin(), distance_bases.end(), distance);
+    return static_cast<unsigned>(std::distance(distance_bases.begin(), iter) - 1);
+}
+
+/// Lengths of a Huffman code no longer than \p max_length. Frequencies are halved until the code fits,
+/// which costs little since it happens only for very skewed frequencies
+[[nodiscard]] std::vector<std::uint8_t> BuildCodeLengths(std::vector<std::uint32_t> frequencies, unsigned max_length) {
+    // Decoders need at least two codes to tell them apart
+    for (std::size_t i = 0; i < frequencies.size()
+            && std::count_if(frequencies.begin(), frequencies.end(), [](std::uint32_t f) { return f > 0; }) < 2; ++i) {
+        frequencies[i] = std::max<std::uint32_t>(frequencies[i], 1);
+    }
+
+    std::vector<std::uint8_t> lengths(frequencies.size(), 0);
+    while (true) {
+        using Node = std::pair<std::uint64_t, std::size_t>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+        std::vector<std::size_t> parents(frequencies.size(), 0);
+        for (std::size_t i = 0; i < frequencies.size(); ++i) {
+            if (frequencies[i] > 0) {
+                queue.emplace(frequencies[i], i);
+            }
+        }
+        while (queue.size() > 1) {
+            const auto [first_weight, first] = queue.top();
+            queue.pop();
+            const auto [second_weight, second] = queue.top();
+            queue.pop();
+            const std::size_t parent = parents.size();
+            parents.push_back(0);
+            parents[first] = parent;
+            parents[second] = parent;
+            queue.emplace(first_weight + second_weight, parent);
+        }
+        const std::size_t root = queue.top().second;
+
+        unsigned longest = 0;
+        for (std::size_t i = 0; i < frequencies.size(); ++i) {
+            unsigned length = 0;
+            if (frequencies[i] > 0) {
+                for (std::size_t node = i; node != root; node = parents[node]) {
+                    ++length;
+                }
+            }
+            lengths[i] = static_cast<std::uint8_t>(std::min(length, 255u));
+            longest = std::max(longest, length);
+        }
+        if (longest <= max_length) {
+            return lengths;
+        }
+
+        for (auto& frequency : frequencies) {
+            if (frequency > 0) {
+                frequency = std::max<std::uint32_t>(frequency / 2, 1);
+            }
+        }
+    }
+}
+
+/// Canonical Huffman codes of the given lengths
+[[nodiscard]] std::vector<std::uint16_t> BuildCodes(const std::vector<std::uint8_t>& lengths) {
+    std::array<std::uint16_t, max_code_length + 2> length_counts{};
+    for (const auto length : lengths) {
+        ++length_counts[length];
+    }
+    length_counts[0] = 0;
+
+    std::array<std::uint16_t, max_code_length + 2> next_codes{};
+    std::uint16_t code = 0;
+    for (unsigned bits = 1; bits <= max_code_length; ++bits) {
+        code = static_cast<std::uint16_t>((code + length_counts[bits - 1]) << 1);
+        next_codes[bits] = code;
+    }
+
+    std::vector<std::uint16_t> codes(lengths.size(), 0);
+    for (std::size_t i = 0; i < lengths.size(); ++i) {
+        if (lengths[i] > 0) {
+            codes[i] = next_codes[lengths[i]]++;
+        }
+    }
+    return codes;
+}
+
+/// Code length symbol with its repeat count for symbols 16, 17 and 18
+struct CodeLengthSymbol {
+    std::uint8_t symbol;
+    std::uint8_t extra;
+};
+
+[[nodiscard]] std::vector<CodeLengthSymbol> EncodeCodeLengths(const std::vector<std::uint8_t>& lengths) {
+    std::vector<CodeLengthSymbol> symbols;
+    for (std::size_t i = 0; i < lengths.size();) {
+        const std::uint8_t length = lengths[i];
+        std::size_t run = 1;
+        while (i + run < lengths.size() && lengths[i + run] == length) {
+            ++run;
+        }
+        i += run;
+
+        if (length == 0) {
+            while (run >= 11) {
+                const std::size_t count = std::min<std::size_t>(run, 138);
+                symbols.push_back({18, static_cast<std::uint8_t>(count - 11)});
+                run -= count;
+            }
+            if (run >= 3) {
+                symbols.push_back({17, static_cast<std::uint8_t>(run - 3)});
+                run = 0;
+            }
+        } else {
+            symbols.push_back({length, 0});
+            --run;
+            while (run >= 3) {
+                const std::size_t count = std::min<std::size_t>(run, 6);
+                symbols.push_back({16, static_cast<std::uint8_t>(count - 3)});
+                run -= count;
+            }
+        }
+        for (; run > 0; --run) {
+            symbols.push_back({length, 0});
+        }
+    }
+    return symbols;
+}
+
+void WriteBlock(BitWriter& writer, const std::vector<Symbol>& symbols, bool is_final) {
+    std::vector<std::uint32_t> literal_length_frequencies(literal_length_code_count, 0);
+    std::vector<std::uint32_t> distance_frequencies(distance_code_count, 0);
+    for (const Symbol symbol : symbols) {
+        if (symbol.distance == 0) {
+            ++literal_length_frequencies[symbol.literal_or_length];
+        } else {
+            ++literal_length_frequencies[257 + GetLengthCode(symbol.literal_or_length)];
+            ++distance_frequencies[GetDistanceCode(symbol.distance)];
+        }
+    }
+    ++literal_length_frequencies[end_of_block];
+
+    const auto literal_length_lengths = BuildCodeLengths(literal_length_frequencies, max_code_length);
+    const auto distance_lengths = BuildCodeLengths(distance_frequencies, max_code_length);
+    const auto literal_length_codes = BuildCodes(literal_length_lengths);
+    const auto distance_codes = BuildCodes(distance_lengths);
+
+    std::size_t literal_length_count = literal_length_code_count;
+    while (literal_length_count > 257 && literal_length_lengths[literal_length_count - 1] == 0) {
+        --literal_length_count;
+    }
+    std::size_t distance_count = distance_code_count;
+    while (distance_count > 1 && distance_lengths[distance_count - 1] == 0) {
+        --distance_count;
+    }
+
+    // Both code length sequences are run-length coded as one
+    std::vector<std::uint8_t> lengths(literal_length_lengths.begin(),
+                                      literal_length_lengths.begin() + literal_length_count);
+    lengths.insert(lengths.end(), distance_lengths.begin(), distance_lengths.begin() + distance_count);
+    const auto code_length_symbols = EncodeCodeLengths(lengths);
+
+    std::vector<std::uint32_t> code_length_frequencies(code_length_code_count, 0);
+    for (const auto symbol : code_length_symbols) {
+        ++code_length_frequencies[symbol.symbol];
+    }
+    const auto code_length_lengths = BuildCodeLengths(code_length_frequencies, max_code_length_code_length);
+    const auto code_length_codes = BuildCodes(code_length_lengths);
+    std::size_t code_length_count = code_length_code_count;
+    while (code_length_count > 4 && code_length_lengths[code_length_order[code_length_count - 1]] == 0) {
+        --code_length_count;
+    }
+
+    writer.Write(is_final ? 1 : 0, 1);
+    writer.Write(2, 2);
+    writer.Write(static_cast<std::uint32_t>(literal_length_count - 257), 5);
+    writer.Write(static_cast<std::uint32_t>(distance_count - 1), 5);
+    writer.Write(static_cast<std::uint32_t>(code_length_count - 4), 4);
+    for (std::size_t i = 0; i < code_length_count; ++i) {
+        writer.Write(code_length_lengths[code_length_order[i]], 3);
+    }
+    for (const auto [symbol, extra] : code_length_symbols) {
+        writer.WriteCode(code_length_codes[symbol], code_length_lengths[symbol]);
+        if (symbol == 16) {
+            writer.Write(extra, 2);
+        } else if (symbol == 17) {
+            writer.Write(extra, 3);
+        } else if (symbol == 18) {
+            writer.Write(extra, 7);
+        }
+    }
+
+    for (const Symbol symbol : symbols) {
+        if (symbol.distance == 0) {
+            writer.WriteCode(literal_length_codes[symbol.literal_or_length],
+                             literal_length_lengths[symbol.literal_or_length]);
+            continue;
+        }
+        const unsigned length_code = GetLengthCode(symbol.literal_or_length);
+        writer.WriteCode(literal_length_codes[257 + length_code], literal_length_lengths[257 + length_code]);
+        writer.Write(symbol.literal_or_length - length_bases[length_code], length_extra_bits[length_code]);
+
+        const unsigned distance_code = GetDistanceCode(symbol.distance);
+        writer.WriteCode(distance_codes[distance_code], distance_lengths[distance_code]);
+        writer.Write(symbol.distance - distance_bases[distance_code], distance_extra_bits[distance_code]);
+    }
+    writer.WriteCode(literal_length_codes[end_of_block], literal_length_lengths[end_of_block]);
+}
+
+[[nodiscard]] std::uint32_t Hash(const unsigned char* data) noexcept {
+    const std::uint32_t value = data[0] | (data[1] << 8) | (data[2] << 16);
+    return (value * 2654435761u) >> (32 - hash_bits);
+}
+
+void WriteBigEndian(std::string& output, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void WriteLittleEndian(std::string& output, std::uint32_t value) {
+    for (int shift = 0; shift < 32; shift += 8) {
+        output.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void CompressInto(std::string& output, std::string_view data) {
+    BitWriter writer(output);
+    const auto* bytes = reinterpret_cast<const unsigned char*>(data.data());
+    const std::size_t size = data.size();
+
+    // Chains of earlier positions with the same hash of their first bytes, newest first
+    std::vector<std::int64_t> heads(std::size_t(1) << hash_bits, -1);
+    std::vector<std::int64_t> previous(window_size, -1);
+    const auto insert = [&](std::size_t position) {
+        if (position + min_match <= size) {
+            const std::uint32_t hash = Hash(bytes + position);
+            previous[position % window_size] = heads[hash];
+            heads[hash] = static_cast<std::int64_t>(position);
+        }
+    };
+
+    std::vector<Symbol> symbols;
+    symbols.reserve(block_symbol_count);
+    for (std::size_t position = 0; position < size;) {
+        std::size_t best_length = 0;
+        std::size_t best_distance = 0;
+        if (position + min_match <= size) {
+            const std::size_t max_length = std::min(max_match, size - position);
+            // Empty chains end with -1, which is in the window near the start of the data
+            const std::int64_t lowest = std::max<std::int64_t>(
+                    static_cast<std::int64_t>(position) - static_cast<std::int64_t>(window_size), -1);
+            std::int64_t candidate = heads[Hash(bytes + position)];
+            for (std::size_t chain = 0; candidate > lowest && chain < max_chain_length; ++chain) {
+                const auto* match = bytes + candidate;
+                if (match[best_length] == bytes[position + best_length] && match[0] == bytes[position]) {
+                    std::size_t length = 0;
+                    while (length < max_length && match[length] == bytes[position + length]) {
+                        ++length;
+                    }
+                    if (length > best_length) {
+                        best_length = length;
+                        best_distance = position - static_cast<std::size_t>(candidate);
+                        if (length >= nice_match || length == max_length) {
+                            break;
+                        }
+                    }
+                }
+                // Slots of positions that left the window are reused, so chains end at the first newer position
+                const std::int64_t next = previous[static_cast<std::size_t>(candidate) % window_size];
+                if (next >= candidate) {
+                    break;
+                }
+                candidate = next;
+            }
+        }
+
+        if (best_length >= min_match) {
+            symbols.push_back({static_cast<std::uint16_t>(best_length), static_cast<std::uint16_t>(best_distance)});
+            for (std::size_t i = 0; i < best_length; ++i) {
+                insert(position + i);
+            }
+            position += best_length;
+        } else {
+            symbols.push_back({bytes[position], 0});
+            insert(position);
+            ++position;
+        }
+
+        if (symbols.size() == block_symbol_count) {
+            WriteBlock(writer, symbols, false);
+            symbols.clear();
+        }
+    }
+    WriteBlock(writer, symbols, true);
+    writer.Flush();
+}
+
+} // namespace
+
+std::string Compress(std::string_view data) {
+    std::string output;
+    CompressInto(output, data);
+    return output;
+}
+
+std::string CompressZlib(std::string_view data) {
+    // Deflate with a 32 KiB window and the default compression level
+    std::string output{'\x78', '\x9C'};
+    CompressInto(output, data);
+    WriteBigEndian(output, Adler32(data));
+    return output;
+}
+
+std::string CompressGzip(std::string_view data) {
+    // Deflate without a modification time and an unknown operating system
+    std::string output{'\x1F', '\x8B', '\x08', '\x00', '\x00', '\x00', '\x00', '\x00', '\x00', '\xFF'};
+    CompressInto(output, data);
+    WriteLittleEndian(output, Crc32(data));
+    WriteLittleEndian(output, static_cast<std::uint32_t>(data.size()));
+    return output;
+}
+
+std::uint32_t Crc32(std::string_view data, std::uint32_t crc) noexcept {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> result{};
+        for (std::uint32_t i = 0; i < result.size(); ++i) {
+            std::uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                value = (value & 1) != 0 ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            result[i] = value;
+        }
+        return result;
+    }();
+
+    crc = ~crc;
+    for (const char c : data) {
+        crc = table[(crc ^ static_cast<unsigned char>(c)) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+std::uint32_t Adler32(std::string_view data, std::uint32_t adler) noexcept {
+    constexpr std::uint32_t modulo = 65521;
+    // The largest number of bytes whose sums don't overflow before taking the modulo
+    constexpr std::size_t max_run = 5552;
+
+    std::uint32_t a = adler & 0xFFFF;
+    std::uint32_t b = adler >> 16;
+    for (std::size_t first = 0; first < data.size(); first += max_run) {
+        const std::size_t last = std::min(data.size(), first + max_run);
+        for (std::size_t i = first; i < last; ++i) {
+            a += static_cast<unsigned char>(data[i]);
+            b += a;
+        }
+        a %= modulo;
+        b %= modulo;
+    }
+    return (b << 16) | a;
+}
+
+} // namespace deflate
\ No newline at end of file
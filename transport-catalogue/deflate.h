@@ -0,0 +1,28 @@
+/// \file
+/// Deflate compression (RFC 1951) with zlib (RFC 1950) and gzip (RFC 1952) framing, so PNG images
+/// and compressed responses don't depend on an external zlib
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace deflate {
+
+/// Raw deflate stream of LZ77 matches coded with dynamic Huffman codes
+[[nodiscard]] std::string Compress(std::string_view data);
+
+/// Deflate stream with a zlib header and an Adler-32 trailer, e.g. for PNG image data
+[[nodiscard]] std::string CompressZlib(std::string_view data);
+
+/// Single gzip member, e.g. for Content-Encoding: gzip
+[[nodiscard]] std::string CompressGzip(std::string_view data);
+
+/// Continue \p crc with \p data; the checksum of PNG chunks and gzip members
+[[nodiscard]] std::uint32_t Crc32(std::string_view data, std::uint32_t crc = 0) noexcept;
+
+/// Continue \p adler with \p data; the checksum of zlib streams
+[[nodiscard]] std::uint32_t Adler32(std::string_view data, std::uint32_t adler = 1) noexcept;
+
+} // namespace deflate
\ No newline at end of file
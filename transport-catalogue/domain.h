@@ -13,6 +13,8 @@ namespace transport_catalogue {
 struct Stop {
     std::string name;
     geo::Coordinates coordinates;
+    /// Filled by TransportCatalogue when the stop is added
+    geo::TrigCoordinates trig_coordinates;
 };
 
 using StopPtr = const Stop*;
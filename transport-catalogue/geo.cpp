@@ -1,5 +1,6 @@
 #include "geo.h"
 
+#include <algorithm>
 #include <cassert>
 #include <cmath>
 
@@ -42,9 +43,92 @@ Meter ComputeDistance(Coordinates from, Coordinates to) noexcept {
     const auto d1 = sin(from.lat.AsRadian()) * sin(to.lat.AsRadian());
     const auto diff = Degree{std::abs((from.lng - to.lng).Get())};
     const auto d2 = cos(from.lat.AsRadian()) * cos(to.lat.AsRadian()) * cos(diff.AsRadian());
-    const auto distance_factor = acos(d1 + d2);
+    // Rounding might push the cosine of very close points slightly above 1
+    const auto distance_factor = acos(min(1.0, max(-1.0, d1 + d2)));
 
     return mean_earth_radius * distance_factor;
 }
 
+// TrigCoordinates
+
+TrigCoordinates::TrigCoordinates(Coordinates coordinates) noexcept
+        : sin_lat(std::sin(coordinates.lat.AsRadian()))
+        , cos_lat(std::cos(coordinates.lat.AsRadian()))
+        , sin_lng(std::sin(coordinates.lng.AsRadian()))
+        , cos_lng(std::cos(coordinates.lng.AsRadian())) {
+}
+
+namespace {
+
+constexpr auto mean_earth_radius = Meter{6'371'000.0};
+
+/// Cosine of the central angle between two points. Rounding might push it slightly out of [-1, 1]
+[[nodiscard]] inline double ComputeCentralAngleCos(double from_sin_lat, double from_cos_lat,
+                                                   double from_sin_lng, double from_cos_lng,
+                                                   double to_sin_lat, double to_cos_lat,
+                                                   double to_sin_lng, double to_cos_lng) noexcept {
+    // cos(lng1 - lng2) = cos(lng1) * cos(lng2) + sin(lng1) * sin(lng2)
+    const double cos_lng_diff = from_cos_lng * to_cos_lng + from_sin_lng * to_sin_lng;
+    const double central_angle_cos = from_sin_lat * to_sin_lat + from_cos_lat * to_cos_lat * cos_lng_diff;
+    return std::min(1.0, std::max(-1.0, central_angle_cos));
+}
+
+} // namespace
+
+Meter ComputeDistance(const TrigCoordinates& from, const TrigCoordinates& to) noexcept {
+    const double central_angle_cos = ComputeCentralAngleCos(
+            from.sin_lat, from.cos_lat, from.sin_lng, from.cos_lng,
+            to.sin_lat, to.cos_lat, to.sin_lng, to.cos_lng);
+    return mean_earth_radius * std::acos(central_angle_cos);
+}
+
+bool IsClose(Meter lhs, Meter rhs, DistanceTolerance tolerance) noexcept {
+    const double diff = std::abs((lhs - rhs).Get());
+    const double scale = std::max(std::abs(lhs.Get()), std::abs(rhs.Get()));
+    return diff <= tolerance.absolute.Get() + tolerance.relative * scale;
+}
+
+// Path
+
+void Path::Reserve(std::size_t count) {
+    sin_lat_.reserve(count);
+    cos_lat_.reserve(count);
+    sin_lng_.reserve(count);
+    cos_lng_.reserve(count);
+}
+
+void Path::PushBack(const TrigCoordinates& point) {
+    sin_lat_.push_back(point.sin_lat);
+    cos_lat_.push_back(point.cos_lat);
+    sin_lng_.push_back(point.sin_lng);
+    cos_lng_.push_back(point.cos_lng);
+}
+
+std::size_t Path::GetSize() const noexcept {
+    return sin_lat_.size();
+}
+
+std::vector<Meter> Path::ComputeSegmentDistances() const {
+    const std::size_t segment_count = GetSize() > 0 ? GetSize() - 1 : 0;
+
+    // Only arithmetic without branches over contiguous arrays: this loop gets vectorized
+    std::vector<double> central_angle_cos(segment_count);
+    const double* sin_lat = sin_lat_.data();
+    const double* cos_lat = cos_lat_.data();
+    const double* sin_lng = sin_lng_.data();
+    const double* cos_lng = cos_lng_.data();
+    for (std::size_t i = 0; i < segment_count; ++i) {
+        central_angle_cos[i] = ComputeCentralAngleCos(
+                sin_lat[i], cos_lat[i], sin_lng[i], cos_lng[i],
+                sin_lat[i + 1], cos_lat[i + 1], sin_lng[i + 1], cos_lng[i + 1]);
+    }
+
+    std::vector<Meter> distances;
+    distances.reserve(segment_count);
+    for (const double angle_cos : central_angle_cos) {
+        distances.push_back(mean_earth_radius * std::acos(angle_cos));
+    }
+    return distances;
+}
+
 } // namespace geo
\ No newline at end of file
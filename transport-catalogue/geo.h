@@ -5,6 +5,9 @@
 
 #include "number_wrapper.h"
 
+#include <cstddef>
+#include <vector>
+
 namespace geo {
 
 using namespace number_wrapper;
@@ -44,4 +47,46 @@ struct Coordinates {
 
 [[nodiscard]] Meter ComputeDistance(Coordinates from, Coordinates to) noexcept;
 
+/// Trigonometric functions of coordinates computed once,
+/// so distances between such points need only multiplications and a single acos
+struct TrigCoordinates {
+    double sin_lat = 0.0;
+    double cos_lat = 1.0;
+    double sin_lng = 0.0;
+    double cos_lng = 1.0;
+
+    TrigCoordinates() noexcept = default;
+    explicit TrigCoordinates(Coordinates coordinates) noexcept;
+};
+
+[[nodiscard]] Meter ComputeDistance(const TrigCoordinates& from, const TrigCoordinates& to) noexcept;
+
+/// Tolerance within which distances computed from TrigCoordinates agree with ComputeDistance(Coordinates, Coordinates).
+/// The absolute part covers acos losing precision for very close points in both functions
+struct DistanceTolerance {
+    double relative = 1e-7;
+    Meter absolute{0.25};
+};
+
+[[nodiscard]] bool IsClose(Meter lhs, Meter rhs, DistanceTolerance tolerance = {}) noexcept;
+
+/// Polyline stored as a structure of arrays, so distances of all its segments are computed in tight loops
+/// that compilers vectorize
+class Path final {
+public:
+    void Reserve(std::size_t count);
+    void PushBack(const TrigCoordinates& point);
+
+    [[nodiscard]] std::size_t GetSize() const noexcept;
+
+    /// Return distances between every pair of consecutive points
+    [[nodiscard]] std::vector<Meter> ComputeSegmentDistances() const;
+
+private:
+    std::vector<double> sin_lat_;
+    std::vector<double> cos_lat_;
+    std::vector<double> sin_lng_;
+    std::vector<double> cos_lng_;
+};
+
 } // namespace geo
\ No newline at end of file
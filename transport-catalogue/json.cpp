@@ -1,6 +1,12 @@
 #include "json.h"
+#include "simd_scan.h"
 
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <limits>
 #include <stdexcept>
+#include <utility>
 
 namespace json {
 
@@ -9,99 +15,248 @@ namespace {
 using namespace std::string_literals;
 using namespace std::string_view_literals;
 
-[[nodiscard]] Node LoadNode(std::istream& input);
+/// Reads chunks of an input source with raw pointers
+class Scanner {
+public:
+    explicit Scanner(InputSource& source) noexcept
+            : source_(source) {
+    }
+
+    /// Return the next character without consuming it or EOF at the end of input
+    [[nodiscard]] int Peek() {
+        if (current_ == end_ && !Refill()) {
+            return std::char_traits<char>::eof();
+        }
+        return static_cast<unsigned char>(*current_);
+    }
 
-[[nodiscard]] Node LoadNumber(std::istream& input) {
-    std::string parsed_num;
+    [[nodiscard]] bool Get(char& ch) {
+        if (current_ == end_ && !Refill()) {
+            return false;
+        }
+        ch = *current_++;
+        return true;
+    }
+
+    /// Put back the character that has been just read
+    void Unget() noexcept {
+        --current_;
+    }
+
+    void SkipWs() {
+        while (true) {
+            current_ = simd_scan::SkipSpaces(current_, end_);
+            if (current_ != end_ || !Refill()) {
+                return;
+            }
+        }
+    }
+
+    /// Consume characters until a double quote, a backslash, a control character or the end of the current chunk.
+    /// The result refers to the chunk and is valid until the next chunk is requested
+    [[nodiscard]] std::string_view ReadStringRun() {
+        if (current_ == end_ && !Refill()) {
+            return {};
+        }
+        const char* run_begin = current_;
+        current_ = simd_scan::FindQuoteBackslashOrControl(current_, end_);
+        return {run_begin, static_cast<std::size_t>(current_ - run_begin)};
+    }
+
+    [[nodiscard]] bool IsChunkEnd() const noexcept {
+        return current_ == end_;
+    }
+
+    /// The unread part of the current chunk
+    [[nodiscard]] std::string_view GetChunkRest() const noexcept {
+        return {current_, static_cast<std::size_t>(end_ - current_)};
+    }
+
+    /// Consume \p count characters of the current chunk
+    void Advance(std::size_t count) noexcept {
+        current_ += count;
+    }
+
+    /// Storage for strings that are not contiguous in the input
+    [[nodiscard]] std::string& GetStringBuffer() noexcept {
+        return string_buffer_;
+    }
+
+private:
+    InputSource& source_;
+    std::string string_buffer_;
+    const char* current_ = nullptr;
+    const char* end_ = nullptr;
+
+    bool Refill() {
+        const std::string_view chunk = source_.NextChunk();
+        current_ = chunk.data();
+        end_ = chunk.data() + chunk.size();
+        return !chunk.empty();
+    }
+};
+
+void ParseNode(Scanner& input, EventHandler& handler);
+
+[[nodiscard]] bool IsDigit(char ch) noexcept {
+    return '0' <= ch && ch <= '9';
+}
+
+/// Return the end of the number that starts at \p first
+/// or nullptr if it is malformed or might continue after \p last
+[[nodiscard]] const char* MatchNumber(const char* first, const char* last, bool& is_int) noexcept {
+    auto skip_digits = [last](const char* ptr) noexcept {
+        while (ptr != last && IsDigit(*ptr)) {
+            ++ptr;
+        }
+        return ptr;
+    };
+
+    const char* ptr = first;
+    if (ptr != last && *ptr == '-') {
+        ++ptr;
+    }
+    if (ptr != last && *ptr == '0') {
+        ++ptr;
+    } else if (const char* digits_end = skip_digits(ptr); digits_end != ptr) {
+        ptr = digits_end;
+    } else {
+        return nullptr;
+    }
+
+    is_int = true;
+
+    if (ptr != last && *ptr == '.') {
+        const char* digits_end = skip_digits(++ptr);
+        if (digits_end == ptr) {
+            return nullptr;
+        }
+        ptr = digits_end;
+        is_int = false;
+    }
+
+    if (ptr != last && (*ptr == 'e' || *ptr == 'E')) {
+        if (++ptr != last && (*ptr == '+' || *ptr == '-')) {
+            ++ptr;
+        }
+        const char* digits_end = skip_digits(ptr);
+        if (digits_end == ptr) {
+            return nullptr;
+        }
+        ptr = digits_end;
+        is_int = false;
+    }
+
+    return (ptr != last) ? ptr : nullptr;
+}
+
+/// Integers that do not fit into int are reported as doubles
+void ConvertNumber(std::string_view text, bool is_int, EventHandler& handler) {
+    const char* const first = text.data();
+    const char* const last = text.data() + text.size();
+
+    if (is_int) {
+        int value;
+        if (const auto [ptr, error] = std::from_chars(first, last, value); error == std::errc{} && ptr == last) {
+            handler.Int(value);
+            return;
+        }
+    }
+
+    double value;
+    if (const auto [ptr, error] = std::from_chars(first, last, value); error != std::errc{} || ptr != last) {
+        throw ParsingError("Failed to convert "s + std::string(text) + " to a number"s);
+    }
+    handler.Double(value);
+}
+
+void ParseNumber(Scanner& input, EventHandler& handler) {
+    bool is_int = true;
+
+    // A number that ends inside the current chunk is converted in place
+    if (const std::string_view rest = input.GetChunkRest(); !rest.empty()) {
+        if (const char* number_end = MatchNumber(rest.data(), rest.data() + rest.size(), is_int)) {
+            const auto size = static_cast<std::size_t>(number_end - rest.data());
+            ConvertNumber(rest.substr(0, size), is_int, handler);
+            input.Advance(size);
+            return;
+        }
+    }
+
+    // Otherwise it is collected character by character, which also reports malformed numbers
+    std::string& parsed_num = input.GetStringBuffer();
+    parsed_num.clear();
 
     auto read_char = [&parsed_num, &input] {
-        parsed_num += static_cast<char>(input.get());
-        if (!input) {
+        char ch;
+        if (!input.Get(ch)) {
             throw ParsingError("Failed to read number from stream"s);
         }
+        parsed_num += ch;
     };
 
     auto read_digits = [&input, read_char] {
-        if (!std::isdigit(input.peek())) {
+        if (!std::isdigit(input.Peek())) {
             throw ParsingError("A digit is expected"s);
         }
-        while (std::isdigit(input.peek())) {
+        while (std::isdigit(input.Peek())) {
             read_char();
         }
     };
 
-    if (input.peek() == '-') {
+    if (input.Peek() == '-') {
         read_char();
     }
 
-    if (input.peek() == '0') {
+    if (input.Peek() == '0') {
         read_char();
     } else {
         read_digits();
     }
 
-    bool is_int = true;
-
-    if (input.peek() == '.') {
+    if (input.Peek() == '.') {
         read_char();
         read_digits();
         is_int = false;
     }
 
-    if (int ch = input.peek(); ch == 'e' || ch == 'E') {
+    if (int ch = input.Peek(); ch == 'e' || ch == 'E') {
         read_char();
-        if (ch = input.peek(); ch == '+' || ch == '-') {
+        if (ch = input.Peek(); ch == '+' || ch == '-') {
             read_char();
         }
         read_digits();
         is_int = false;
     }
 
-    try {
-        if (is_int) {
-            try {
-                return Node(std::stoi(parsed_num));
-            } catch (...) {
-                // pass
-            }
-        }
-        return Node(std::stod(parsed_num));
-    } catch (...) {
-        throw ParsingError("Failed to convert "s + parsed_num + " to a number"s);
-    }
+    ConvertNumber(parsed_num, is_int, handler);
 }
 
-[[nodiscard]] Node LoadString(std::istream& input) {
-    std::string str;
-
-    auto check_input = [&input] {
-        if (!input) {
-            throw ParsingError("Failed to read a character from the stream"s);
-        }
-    };
-
-    auto iter = std::istreambuf_iterator<char>(input);
-    auto end = std::istreambuf_iterator<char>();
+/// The result is valid until the next read from \p input
+[[nodiscard]] std::string_view ParseString(Scanner& input) {
+    // A string without escapes inside the current chunk is returned without copying
+    std::string_view run = input.ReadStringRun();
+    if (!input.IsChunkEnd() && input.Peek() == '"') {
+        char quote;
+        (void) input.Get(quote);
+        return run;
+    }
 
+    std::string& str = input.GetStringBuffer();
+    str.assign(run);
     while (true) {
-        check_input();
-
-        if (iter == end) {
+        char ch;
+        if (!input.Get(ch)) {
             throw ParsingError("String ended before a closed double quote"s);
         }
 
-        const char ch = *iter;
         if (ch == '"') {
-            ++iter;
-            check_input();
             break;
         } else if (ch == '\\') {
-            ++iter;
-            check_input();
-            if (iter == end) {
+            char escaped_char;
+            if (!input.Get(escaped_char)) {
                 throw ParsingError("String ended before a closed double quote"s);
             }
-            const char escaped_char = *iter;
             switch (escaped_char) {
                 case 'n':
                     str.push_back('\n');
@@ -127,28 +282,27 @@ using namespace std::string_view_literals;
             str.push_back(ch);
         }
 
-        ++iter;
+        run = input.ReadStringRun();
+        str.append(run);
     }
 
-    return Node(std::move(str));
+    return str;
 }
 
-bool TryReadNextChar(std::istream& input, char& ch) {
-    if (!(input >> ch)) {
+bool TryReadNextChar(Scanner& input, char& ch) {
+    if (!input.Get(ch)) {
         throw ParsingError("Failed to read a character from the stream"s);
     }
     return true;
 }
 
-bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
-    if (!(input >> std::ws >> ch)) {
-        throw ParsingError("Failed to read a character from the stream"s);
-    }
-    return true;
+bool TrySkipWsAndReadNextChar(Scanner& input, char& ch) {
+    input.SkipWs();
+    return TryReadNextChar(input, ch);
 }
 
-[[nodiscard]] Node LoadArray(std::istream& input) {
-    Array result;
+void ParseArray(Scanner& input, EventHandler& handler) {
+    handler.StartArray();
 
     char ch;
     TrySkipWsAndReadNextChar(input, ch);
@@ -157,14 +311,13 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
         throw ParsingError("Comma right after an open bracket"s);
     }
     if (ch == ']') {
-        return Node(std::move(result));
+        handler.EndArray();
+        return;
     }
 
     while (true) {
-        if (!input.putback(ch)) {
-            throw ParsingError("Failed to put a character back into the stream"s);
-        }
-        result.push_back(LoadNode(input));
+        input.Unget();
+        ParseNode(input, handler);
 
         TrySkipWsAndReadNextChar(input, ch);
         if (ch == ']') {
@@ -179,11 +332,11 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
         }
     }
 
-    return Node(std::move(result));
+    handler.EndArray();
 }
 
-[[nodiscard]] Node LoadDict(std::istream& input) {
-    Dict result;
+void ParseDict(Scanner& input, EventHandler& handler) {
+    handler.StartDict();
 
     char ch;
     TrySkipWsAndReadNextChar(input, ch);
@@ -192,13 +345,13 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
         throw ParsingError("Comma right after an open curly brace"s);
     }
     if (ch == '}') {
-        return Node(std::move(result));
+        handler.EndDict();
+        return;
     }
 
     while (true) {
-        std::string key;
         if (ch == '"') {
-            key = LoadString(input).AsString();
+            handler.Key(ParseString(input));
         } else {
             throw ParsingError("Dictionary key must start after a double quote"s);
         }
@@ -208,7 +361,7 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
             throw ParsingError("Dictionary key and value_ must be separated by a colon"s);
         }
 
-        result.emplace(std::move(key), LoadNode(input));
+        ParseNode(input, handler);
 
         TrySkipWsAndReadNextChar(input, ch);
         if (ch == '}') {
@@ -223,24 +376,24 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
         }
     }
 
-    return Node(std::move(result));
+    handler.EndDict();
 }
 
-[[nodiscard]] Node LoadNode(std::istream& input) {
+void ParseNode(Scanner& input, EventHandler& handler) {
     char ch;
 
     TrySkipWsAndReadNextChar(input, ch);
     if (ch == '[') {
-        return LoadArray(input);
+        ParseArray(input, handler);
     } else if (ch == '{') {
-        return LoadDict(input);
+        ParseDict(input, handler);
     } else if (ch == '"') {
-        return LoadString(input);
+        handler.String(ParseString(input));
     } else if (/*      check true literal     */ ch == 't') {
         if (       TryReadNextChar(input, ch) && ch == 'r'
                 && TryReadNextChar(input, ch) && ch == 'u'
                 && TryReadNextChar(input, ch) && ch == 'e') {
-            return Node(true);
+            handler.Bool(true);
         } else {
             throw ParsingError("Unrecognized literal; maybe it was meant `true`"s);
         }
@@ -249,7 +402,7 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
                 && TryReadNextChar(input, ch) && ch == 'l'
                 && TryReadNextChar(input, ch) && ch == 's'
                 && TryReadNextChar(input, ch) && ch == 'e') {
-            return Node(false);
+            handler.Bool(false);
         } else {
             throw ParsingError("Unrecognized literal; maybe it was meant `false`"s);
         }
@@ -257,15 +410,13 @@ bool TrySkipWsAndReadNextChar(std::istream& input, char& ch) {
         if (       TryReadNextChar(input, ch) && ch == 'u'
                 && TryReadNextChar(input, ch) && ch == 'l'
                 && TryReadNextChar(input, ch) && ch == 'l') {
-            return Node();
+            handler.Null();
         } else {
             throw ParsingError("Unrecognized literal; maybe it was meant `null`"s);
         }
     } else {
-        if (!input.putback(ch)) {
-            throw ParsingError("Failed to put a character back into the stream"s);
-        }
-        return LoadNumber(input);
+        input.Unget();
+        ParseNumber(input, handler);
     }
 }
 
@@ -375,12 +526,259 @@ bool Document::operator!=(const Document& rhs) const {
     return !(*this == rhs);
 }
 
+// NodeBuilder
+
+void NodeBuilder::Null() {
+    AddNode(Node());
+}
+
+void NodeBuilder::Bool(bool value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::Int(int value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::Double(double value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::String(std::string_view value) {
+    AddNode(Node(std::string(value)));
+}
+
+void NodeBuilder::StartArray() {
+    stack_.emplace_back(Array{});
+}
+
+void NodeBuilder::EndArray() {
+    Node node = std::move(stack_.back());
+    stack_.pop_back();
+    AddNode(std::move(node));
+}
+
+void NodeBuilder::StartDict() {
+    stack_.emplace_back(Dict{});
+}
+
+void NodeBuilder::Key(std::string_view key) {
+    keys_.emplace_back(key);
+}
+
+void NodeBuilder::EndDict() {
+    Node node = std::move(stack_.back());
+    stack_.pop_back();
+    AddNode(std::move(node));
+}
+
+bool NodeBuilder::HasNode() const noexcept {
+    return root_.has_value();
+}
+
+Node NodeBuilder::ReleaseNode() {
+    Node root = std::move(root_.value());
+    root_.reset();
+    return root;
+}
+
+void NodeBuilder::AddNode(Node node) {
+    if (stack_.empty()) {
+        root_ = std::move(node);
+        return;
+    }
+
+    Value& parent = stack_.back().GetValue();
+    if (auto* array_ptr = std::get_if<Array>(&parent)) {
+        array_ptr->push_back(std::move(node));
+    } else {
+        std::get<Dict>(parent).emplace(std::move(keys_.back()), std::move(node));
+        keys_.pop_back();
+    }
+}
+
+// Input sources
+
+BufferSource::BufferSource(std::string_view text) noexcept
+        : text_(text) {
+}
+
+std::string_view BufferSource::NextChunk() {
+    return std::exchange(text_, std::string_view{});
+}
+
+StreamSource::StreamSource(std::istream& input, std::size_t chunk_size)
+        : input_(input)
+        , chunk_(chunk_size) {
+}
+
+std::string_view StreamSource::NextChunk() {
+    const auto count = input_.rdbuf()->sgetn(chunk_.data(), static_cast<std::streamsize>(chunk_.size()));
+    return {chunk_.data(), static_cast<std::size_t>(count)};
+}
+
+// Parse
+
+void Parse(InputSource& source, EventHandler& handler) {
+    Scanner scanner(source);
+    ParseNode(scanner, handler);
+}
+
+void Parse(std::string_view text, EventHandler& handler) {
+    BufferSource source(text);
+    Parse(source, handler);
+}
+
+void Parse(std::istream& input, EventHandler& handler) {
+    StreamSource source(input);
+    Parse(source, handler);
+}
+
+Document Load(std::string_view text) {
+    NodeBuilder builder;
+    Parse(text, builder);
+    return Document(builder.ReleaseNode());
+}
+
 Document Load(std::istream& input) {
-    return Document(LoadNode(input));
+    NodeBuilder builder;
+    Parse(input, builder);
+    return Document(builder.ReleaseNode());
 }
 
 // Print
 
+namespace {
+
+constexpr unsigned int print_indent_step = 4;
+
+/// Appends to strings with the interface of streams
+struct StringWriter {
+    std::string& output;
+
+    void write(const char* data, std::size_t size) {
+        output.append(data, size);
+    }
+
+    void put(char ch) {
+        output.push_back(ch);
+    }
+};
+
+/// Write \p value without the enclosing quotes into a stream or a StringWriter
+template<typename Output>
+void WriteEscaped(std::string_view value, Output& output) {
+    const char* current = value.data();
+    const char* const last = value.data() + value.size();
+    while (true) {
+        // Runs without escaped characters are written as a whole
+        const char* escaped = simd_scan::FindEscaped(current, last);
+        output.write(current, escaped - current);
+        if (escaped == last) {
+            break;
+        }
+
+        output.put('\\');
+        switch (*escaped) {
+            case '\n':
+                output.put('n');
+                break;
+            case '\r':
+                output.put('r');
+                break;
+            default:
+                output.put(*escaped);
+        }
+        current = escaped + 1;
+    }
+}
+
+} // namespace
+
+// EscapedString
+
+EscapedString::EscapedString(std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size() + value.size() / 16);
+    StringWriter writer{escaped};
+    WriteEscaped(value, writer);
+    escaped_ = std::make_shared<const std::string>(std::move(escaped));
+}
+
+std::string_view EscapedString::GetEscaped() const noexcept {
+    return *escaped_;
+}
+
+EscapedString EscapedString::FromEscaped(std::string escaped) {
+    EscapedString result;
+    result.escaped_ = std::make_shared<const std::string>(std::move(escaped));
+    return result;
+}
+
+bool EscapedString::operator==(const EscapedString& rhs) const noexcept {
+    return escaped_ == rhs.escaped_ || *escaped_ == *rhs.escaped_;
+}
+
+bool EscapedString::operator!=(const EscapedString& rhs) const noexcept {
+    return !(*this == rhs);
+}
+
+std::string Unescape(std::string_view escaped) {
+    std::string value;
+    value.reserve(escaped.size());
+    while (true) {
+        const std::size_t backslash = escaped.find('\\');
+        value.append(escaped.substr(0, backslash));
+        if (backslash == std::string_view::npos || backslash + 1 == escaped.size()) {
+            break;
+        }
+
+        switch (const char ch = escaped[backslash + 1]) {
+            case 'n':
+                value.push_back('\n');
+                break;
+            case 'r':
+                value.push_back('\r');
+                break;
+            default:
+                value.push_back(ch);
+        }
+        escaped.remove_prefix(backslash + 2);
+    }
+    return value;
+}
+
+// EscapingBuffer
+
+EscapingBuffer::EscapingBuffer(std::string& target) noexcept
+        : target_(target) {
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
+EscapingBuffer::~EscapingBuffer() {
+    WriteBuffer();
+}
+
+EscapingBuffer::int_type EscapingBuffer::overflow(int_type ch) {
+    WriteBuffer();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+int EscapingBuffer::sync() {
+    WriteBuffer();
+    return 0;
+}
+
+void EscapingBuffer::WriteBuffer() {
+    StringWriter writer{target_};
+    WriteEscaped(std::string_view(pbase(), pptr() - pbase()), writer);
+    setp(buffer_.data(), buffer_.data() + buffer_.size());
+}
+
 PrintContext::PrintContext(std::ostream& output, unsigned int indent_step, unsigned int indent) noexcept
         : output(output)
         , indent_step(indent_step)
@@ -393,8 +791,17 @@ void PrintContext::PrintIndent() const {
     }
 }
 
+void PrintContext::PrintLineBreak() const {
+    if (!is_compact) {
+        output.put('\n');
+        PrintIndent();
+    }
+}
+
 PrintContext PrintContext::Indented() const noexcept {
-    return PrintContext(output, indent_step, indent_step + indent);
+    PrintContext context(output, indent_step, indent_step + indent);
+    context.is_compact = is_compact;
+    return context;
 }
 
 void PrintValue::operator()(std::nullptr_t) {
@@ -406,41 +813,34 @@ void PrintValue::operator()(bool value) {
 }
 
 void PrintValue::operator()(int value) {
-    context.output << value;
+    std::array<char, std::numeric_limits<int>::digits10 + 3> buffer;
+    const auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value);
+    context.output.write(buffer.data(), end - buffer.data());
 }
 
 void PrintValue::operator()(double value) {
-    context.output << value;
-}
-
-void PrintValue::operator()(const std::string& value) {
     auto& output = context.output;
-    std::ostreambuf_iterator output_buf(output);
 
-    output_buf = '\"';
-    for (const char ch : value) {
-        switch (ch) {
-            case '\n':
-                output_buf = '\\';
-                output_buf = 'n';
-                break;
-            case '\r':
-                output_buf = '\\';
-                output_buf = 'r';
-                break;
-            case '\"':
-                output_buf = '\\';
-                output_buf = '\"';
-                break;
-            case '\\':
-                output_buf = '\\';
-                output_buf = '\\';
-                break;
-            default:
-                output_buf = ch;
-        }
+    // Formatting other than the default one is left to the stream
+    constexpr auto custom_flags = std::ios_base::floatfield | std::ios_base::showpoint
+            | std::ios_base::showpos | std::ios_base::uppercase;
+    constexpr std::streamsize max_precision = std::numeric_limits<double>::max_digits10;
+    if ((output.flags() & custom_flags) || output.width() != 0 || output.precision() > max_precision) {
+        output << value;
+        return;
     }
-    output_buf = '\"';
+
+    // The default stream format is the same as %g with the stream precision
+    std::array<char, 32> buffer;
+    const auto [end, error] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), value,
+                                            std::chars_format::general, static_cast<int>(output.precision()));
+    output.write(buffer.data(), end - buffer.data());
+}
+
+void PrintValue::operator()(const std::string& value) {
+    context.output.put('"');
+    WriteEscaped(value, context.output);
+    context.output.put('"');
 }
 
 void PrintValue::operator()(const Array& array) {
@@ -453,18 +853,14 @@ void PrintValue::operator()(const Array& array) {
     }
 
     const PrintContext inner_context = context.Indented();
-    output << "\n"sv;
-    inner_context.PrintIndent();
+    inner_context.PrintLineBreak();
     std::visit(PrintValue{ inner_context }, array.front().GetValue());
     for (auto iter = ++array.begin(), last = array.end(); iter != last; ++iter) {
-        output << ",\n"sv;
-        inner_context.PrintIndent();
+        output << ","sv;
+        inner_context.PrintLineBreak();
         std::visit(PrintValue{ inner_context }, iter->GetValue());
     }
-    if (!array.empty()) {
-        output << "\n"sv;
-    }
-    context.PrintIndent();
+    context.PrintLineBreak();
     output << "]"sv;
 }
 
@@ -477,33 +873,54 @@ void PrintValue::operator()(const Dict& dict) {
         return;
     }
 
-    auto iter = dict.begin();
+    const std::string_view key_separator = context.is_compact ? "\":"sv : "\": "sv;
     const PrintContext inner_context = context.Indented();
-    {
-        output << "\n"sv;
-        inner_context.PrintIndent();
-        const auto& [key, node] = *iter;
-        output << "\""sv << key << "\": "sv;
-        std::visit(PrintValue{ inner_context }, node.GetValue());
-    }
-    ++iter;
-    for (auto last = dict.end(); iter != last; ++iter) {
-        output << ",\n"sv;
-        inner_context.PrintIndent();
-        const auto& [key, node] = *iter;
-        output << "\""sv << key << "\": "sv;
+    bool is_first = true;
+    for (const auto& [key, node] : dict) {
+        if (!std::exchange(is_first, false)) {
+            output << ","sv;
+        }
+        inner_context.PrintLineBreak();
+        output << "\""sv << key << key_separator;
         std::visit(PrintValue{ inner_context }, node.GetValue());
     }
-    if (!dict.empty()) {
-        output << "\n"sv;
-    }
-    context.PrintIndent();
+    context.PrintLineBreak();
     output << "}"sv;
 }
 
+void PrintValue::operator()(const EscapedString& value) {
+    const std::string_view escaped = value.GetEscaped();
+    context.output.put('"');
+    context.output.write(escaped.data(), static_cast<std::streamsize>(escaped.size()));
+    context.output.put('"');
+}
+
 void Print(const Document& document, std::ostream& output) {
-    const PrintContext context(output, 4);
+    const PrintContext context(output, print_indent_step);
     std::visit(PrintValue{ context }, document.GetRoot().GetValue());
 }
 
+void PrintCompact(const Node& node, std::ostream& output) {
+    PrintContext context(output);
+    context.is_compact = true;
+    std::visit(PrintValue{ context }, node.GetValue());
+}
+
+// ArrayWriter
+
+ArrayWriter::ArrayWriter(std::ostream& output) noexcept
+        : output_(output) {
+}
+
+void ArrayWriter::Write(const Node& node) {
+    const PrintContext inner_context = PrintContext(output_, print_indent_step).Indented();
+    output_ << ((count_++ == 0) ? "[\n"sv : ",\n"sv);
+    inner_context.PrintIndent();
+    std::visit(PrintValue{ inner_context }, node.GetValue());
+}
+
+void ArrayWriter::Close() {
+    output_ << ((std::exchange(count_, 0) == 0) ? "[]"sv : "\n]"sv);
+}
+
 }  // namespace json
\ No newline at end of file
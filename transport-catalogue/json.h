@@ -3,9 +3,14 @@
 
 #pragma once
 
+#include <array>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <optional>
+#include <streambuf>
 #include <string>
+#include <string_view>
 #include <variant>
 #include <vector>
 
@@ -23,7 +28,57 @@ public:
     using runtime_error::runtime_error;
 };
 
-using Value = std::variant<std::nullptr_t, bool, int, double, std::string, Array, Dict>;
+/// A string escaped once to be printed many times as is, e.g. a cached response.
+/// Copies share the escaped text; parsing never produces it
+class EscapedString {
+public:
+    explicit EscapedString(std::string_view value);
+
+    /// Escaped text without the enclosing quotes
+    [[nodiscard]] std::string_view GetEscaped() const noexcept;
+
+    /// Take text that is already escaped, e.g. by EscapingBuffer
+    [[nodiscard]] static EscapedString FromEscaped(std::string escaped);
+
+    [[nodiscard]] bool operator==(const EscapedString& rhs) const noexcept;
+    [[nodiscard]] bool operator!=(const EscapedString& rhs) const noexcept;
+
+private:
+    std::shared_ptr<const std::string> escaped_;
+
+    EscapedString() noexcept = default;
+};
+
+/// Undo the escaping of EscapedString and EscapingBuffer, e.g. to compress the text itself.
+/// Unlike parsing, expects no quotes and only the escapes they write
+[[nodiscard]] std::string Unescape(std::string_view escaped);
+
+/// Escapes everything written through it for a JSON string without the enclosing quotes,
+/// so e.g. a document is rendered straight into an EscapedString. Output is appended to the target
+/// in chunks and is complete after sync or destruction
+class EscapingBuffer final : public std::streambuf {
+public:
+    explicit EscapingBuffer(std::string& target) noexcept;
+
+    EscapingBuffer(const EscapingBuffer&) = delete;
+    EscapingBuffer& operator=(const EscapingBuffer&) = delete;
+
+    ~EscapingBuffer() override;
+
+protected:
+    int_type overflow(int_type ch) override;
+    int sync() override;
+
+private:
+    static constexpr std::size_t buffer_size = 1 << 13;
+
+    std::string& target_;
+    std::array<char, buffer_size> buffer_;
+
+    void WriteBuffer();
+};
+
+using Value = std::variant<std::nullptr_t, bool, int, double, std::string, Array, Dict, EscapedString>;
 
 class Node final : private Value {
 public:
@@ -80,6 +135,99 @@ private:
     Node root_;
 };
 
+// Event-driven parsing
+
+/// Receives values in the order they appear in the input.
+/// Every value inside a dictionary is preceded by its key
+class EventHandler {
+public:
+    virtual ~EventHandler() = default;
+
+    virtual void Null() = 0;
+    virtual void Bool(bool value) = 0;
+    virtual void Int(int value) = 0;
+    virtual void Double(double value) = 0;
+    /// Views of strings and keys are valid only during the call
+    virtual void String(std::string_view value) = 0;
+
+    virtual void StartArray() = 0;
+    virtual void EndArray() = 0;
+
+    virtual void StartDict() = 0;
+    virtual void Key(std::string_view key) = 0;
+    virtual void EndDict() = 0;
+};
+
+/// Builds a node from events, e.g. to keep only a part of the input in memory
+class NodeBuilder final : public EventHandler {
+public:
+    void Null() override;
+    void Bool(bool value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+
+    void StartArray() override;
+    void EndArray() override;
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    /// Whether the outermost value has been completed
+    [[nodiscard]] bool HasNode() const noexcept;
+    [[nodiscard]] Node ReleaseNode();
+
+private:
+    std::vector<Node> stack_;
+    std::vector<std::string> keys_;
+    std::optional<Node> root_;
+
+    void AddNode(Node node);
+};
+
+// Input sources
+
+/// Input split into contiguous chunks, so the parser scans them with raw pointers
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    /// Return the next chunk or an empty one at the end of input.
+    /// The previous chunk might be invalidated
+    [[nodiscard]] virtual std::string_view NextChunk() = 0;
+};
+
+/// Whole input is already in memory, e.g. a memory-mapped file
+class BufferSource final : public InputSource {
+public:
+    explicit BufferSource(std::string_view text) noexcept;
+
+    [[nodiscard]] std::string_view NextChunk() override;
+
+private:
+    std::string_view text_;
+};
+
+/// Reads a stream by large chunks. The stream is consumed beyond the end of the parsed value
+class StreamSource final : public InputSource {
+public:
+    static constexpr std::size_t default_chunk_size = 1 << 16;
+
+    explicit StreamSource(std::istream& input, std::size_t chunk_size = default_chunk_size);
+
+    [[nodiscard]] std::string_view NextChunk() override;
+
+private:
+    std::istream& input_;
+    std::vector<char> chunk_;
+};
+
+void Parse(InputSource& source, EventHandler& handler);
+void Parse(std::string_view text, EventHandler& handler);
+void Parse(std::istream& input, EventHandler& handler);
+
+Document Load(std::string_view text);
 Document Load(std::istream& input);
 
 // Print
@@ -88,11 +236,16 @@ struct PrintContext {
     std::ostream& output;
     unsigned int indent_step;
     unsigned int indent;
+    /// Print everything in one line without spaces between tokens
+    bool is_compact = false;
 
     explicit PrintContext(std::ostream& output, unsigned int indent_step = 0, unsigned int indent = 0) noexcept;
 
     void PrintIndent() const;
 
+    /// Start a new line with the indent unless the output is compact
+    void PrintLineBreak() const;
+
     [[nodiscard]] PrintContext Indented() const noexcept;
 };
 
@@ -106,8 +259,28 @@ struct PrintValue {
     void operator()(const std::string& value);
     void operator()(const Array& array);
     void operator()(const Dict& dict);
+    void operator()(const EscapedString& value);
 };
 
 void Print(const Document& document, std::ostream& output);
 
+/// Print \p node in one line, e.g. as a line of newline-delimited JSON
+void PrintCompact(const Node& node, std::ostream& output);
+
+/// Prints a top-level array in the format of Print element by element,
+/// so that the elements do not have to be kept until the whole array is ready
+class ArrayWriter final {
+public:
+    explicit ArrayWriter(std::ostream& output) noexcept;
+
+    void Write(const Node& node);
+
+    /// Print the end of the array; the next Write starts a new one
+    void Close();
+
+private:
+    std::ostream& output_;
+    std::size_t count_ = 0;
+};
+
 }  // namespace json
\ No newline at end of file
@@ -3,12 +3,16 @@
 #include "geo.h"
 #include "domain.h"
 #include "json_builder.h"
+#include "json_view.h"
 #include "map_renderer.h"
 #include "transport_router.h"
 #include "request_handler.h"
+#include "responses.h"
 
 #include <algorithm>
-#include <sstream>
+#include <exception>
+#include <optional>
+#include <stdexcept>
 #include <string_view>
 #include <typeindex>
 #include <typeinfo>
@@ -35,54 +39,62 @@ public:
                                {"router_settings"sv,        &JsonParser::GetRouterSettings},
                                {"serialization_settings"sv, &JsonParser::GetSerializationSettings},
                                {"from"sv,                   &JsonParser::GetStartStopName},
-                               {"to"sv,                     &JsonParser::GetEndStopName}}) {
+                               {"to"sv,                     &JsonParser::GetEndStopName},
+                               {"from_point"sv,             &JsonParser::GetStartPoint},
+                               {"to_point"sv,               &JsonParser::GetEndPoint},
+                               {"count"sv,                  &JsonParser::GetCount},
+                               {"box"sv,                    &JsonParser::GetBoundingBox},
+                               {"viewport"sv,               &JsonParser::GetViewport},
+                               {"with_map"sv,               &JsonParser::GetWithMap},
+                               {"format"sv,                 &JsonParser::GetImageFormat},
+                               {"encoding"sv,               &JsonParser::GetEncoding}}) {
     }
 
-    void Parse(const json::Document& document) {
+    /// Construct a query from a single request, e.g. an element of base_requests or the render_settings dictionary
+    void ParseRequest(std::string_view request_type, const json::view::Node& node) {
+        current_node_ = &node;
+        const auto query_type_index = GetTypeIndex(request_type);
+        const auto& factory = queries::QueryFactory::GetFactory(query_type_index);
+        GetResult().PushBack(factory.Construct(*this));
         current_node_ = nullptr;
-        for (const auto& [request_type, nodes] : document.GetRoot().AsDict()) {
-            if (nodes.IsArray()) {
-                for (const auto& node : nodes.AsArray()) {
-                    current_node_ = &node;
-                    const auto query_type_index = GetTypeIndex(request_type);
-                    const auto& factory = queries::QueryFactory::GetFactory(query_type_index);
-                    GetResult().PushBack(factory.Construct(*this));
-                }
-            } else if (nodes.IsDict()) {
-                current_node_ = &nodes;
-                const auto query_type_index = GetTypeIndex(request_type);
-                const auto& factory = queries::QueryFactory::GetFactory(query_type_index);
-                GetResult().PushBack(factory.Construct(*this));
-            }
-        }
     }
 
 private:
-    const json::Node* current_node_ = nullptr;
+    const json::view::Node* current_node_ = nullptr;
 
     using ObjectGetter = std::any(JsonParser::*)() const;
 
     std::unordered_map<std::string_view, ObjectGetter> object_getters_;
 
     [[nodiscard]] std::type_index GetTypeIndex(std::string_view request_type) const {
-        const auto& dict = current_node_->AsDict();
+        const auto dict = current_node_->AsDict();
         if (request_type == "base_requests"sv) {
-            const auto& type = dict.at("type");
-            if (type == "Stop"s) {
+            const auto type = dict.at("type"sv).AsString();
+            if (type == "Stop"sv) {
                 return typeid(Stop);
-            } else if (type == "Bus"s) {
+            } else if (type == "Bus"sv) {
                 return typeid(Bus);
             }
         } else if (request_type == "stat_requests"s) {
-            const auto& type = dict.at("type");
-            if (type == "Stop"s) {
+            const auto type = dict.at("type"sv).AsString();
+            if (type == "Stop"sv) {
                 return typeid(queries::Handler::StopInfo);
-            } else if (type == "Bus"s) {
+            } else if (type == "Bus"sv) {
                 return typeid(queries::Handler::BusInfo);
-            } else if (type == "Map"s) {
+            } else if (type == "Map"sv) {
+                if (dict.find("zoom"sv) != dict.end() || dict.find("min_latitude"sv) != dict.end()) {
+                    return typeid(renderer::Viewport);
+                }
                 return typeid(renderer::MapRenderer);
-            } else if (type == "Route"s) {
+            } else if (type == "Route"sv) {
+                if (dict.at("from"sv).IsDict()) {
+                    return typeid(geo::Coordinates);
+                }
                 return typeid(router::TransportRouter);
+            } else if (type == "NearestStops"sv) {
+                return typeid(spatial::Neighbour);
+            } else if (type == "StopsInBox"sv) {
+                return typeid(spatial::BoundingBox);
             }
         } else if (request_type == "render_settings"s) {
             return typeid(renderer::Settings);
@@ -100,24 +112,28 @@ private:
     }
 
     [[nodiscard]] std::any GetName() const {
-        std::string name = current_node_->AsDict().at("name"s).AsString();
+        std::string name(current_node_->AsDict().at("name"sv).AsString());
         return std::make_any<std::string>(std::move(name));
     }
 
     [[nodiscard]] std::any GetId() const {
-        return current_node_->AsDict().at("id"s).AsInt();
+        return current_node_->AsDict().at("id"sv).AsInt();
     }
 
     [[nodiscard]] std::any GetCoordinates() const {
-        const auto& dict = current_node_->AsDict();
-        const auto latitude = geo::Degree{dict.at("latitude"s).AsDouble()};
-        const auto longitude = geo::Degree{dict.at("longitude"s).AsDouble()};
+        return ParseCoordinates(*current_node_);
+    }
+
+    static geo::Coordinates ParseCoordinates(const json::view::Node& node) {
+        const auto dict = node.AsDict();
+        const auto latitude = geo::Degree{dict.at("latitude"sv).AsDouble()};
+        const auto longitude = geo::Degree{dict.at("longitude"sv).AsDouble()};
         return geo::Coordinates(latitude, longitude);
     }
 
     [[nodiscard]] std::any GetDistances() const {
-        const auto& dict = current_node_->AsDict();
-        const auto& map = dict.at("road_distances"s).AsDict();
+        const auto dict = current_node_->AsDict();
+        const auto map = dict.at("road_distances"sv).AsDict();
         std::unordered_map<std::string, geo::Meter> distances;
         distances.reserve(map.size());
         for (const auto& [to_stop_name, node] : map) {
@@ -128,23 +144,23 @@ private:
     }
 
     [[nodiscard]] std::any GetStopNames() const {
-        const auto& dict = current_node_->AsDict();
-        const auto& array = dict.at("stops"s).AsArray();
+        const auto dict = current_node_->AsDict();
+        const auto array = dict.at("stops"sv).AsArray();
         std::vector<std::string> stop_names;
         stop_names.reserve(array.size());
         for (const auto& node : array) {
-            const auto& stop_name = node.AsString();
+            const auto stop_name = node.AsString();
             stop_names.emplace_back(stop_name);
         }
         return std::make_any<decltype(stop_names)>(std::move(stop_names));
     }
 
     [[nodiscard]] std::any GetRouteType() const {
-        return (current_node_->AsDict().at("is_roundtrip"s).AsBool()) ? Bus::RouteType::Full : Bus::RouteType::Half;
+        return (current_node_->AsDict().at("is_roundtrip"sv).AsBool()) ? Bus::RouteType::Full : Bus::RouteType::Half;
     }
 
     [[nodiscard]] std::any GetRendererSettings() const {
-        const auto& dict = current_node_->AsDict();
+        const auto dict = current_node_->AsDict();
         renderer::Settings rs;
 
         auto check_attribute = [](const std::string& attribute, auto value, auto min, auto max) {
@@ -155,60 +171,65 @@ private:
             }
         };
 
-        rs.width = dict.at("width"s).AsDouble();
+        rs.width = dict.at("width"sv).AsDouble();
         check_attribute("width"s, rs.width, 0.0, 100'000.0);
 
-        rs.height = dict.at("height"s).AsDouble();
+        rs.height = dict.at("height"sv).AsDouble();
         check_attribute("height"s, rs.height, 0.0, 100'000.0);
 
-        rs.padding = dict.at("padding"s).AsDouble();
+        rs.padding = dict.at("padding"sv).AsDouble();
         if (rs.padding < 0.0 || rs.padding >= std::max(rs.width, rs.height) / 2.0) {
             throw std::invalid_argument("render_settings.padding must be in [0.0, max(width, height) / 2)"s);
         }
 
-        rs.line_width = dict.at("line_width"s).AsDouble();
+        rs.line_width = dict.at("line_width"sv).AsDouble();
         check_attribute("line_width"s, rs.line_width, 0.0, 100'000.0);
 
-        rs.stop_radius = dict.at("stop_radius"s).AsDouble();
+        rs.stop_radius = dict.at("stop_radius"sv).AsDouble();
         check_attribute("stop_radius"s, rs.stop_radius, 0.0, 100'000.0);
 
-        rs.bus_label_font_size = dict.at("bus_label_font_size"s).AsInt();
+        rs.bus_label_font_size = dict.at("bus_label_font_size"sv).AsInt();
         check_attribute("bus_label_font_size"s, rs.bus_label_font_size, 0, 100'000);
 
-        const json::Array& bus_label_offset = dict.at("bus_label_offset"s).AsArray();
+        const json::view::Array bus_label_offset = dict.at("bus_label_offset"sv).AsArray();
         rs.bus_label_offset.x = bus_label_offset[0].AsDouble();
         check_attribute("bus_label_offset.x"s, rs.bus_label_offset.x, -100'000.0, 100'000.0);
         rs.bus_label_offset.y = bus_label_offset[1].AsDouble();
         check_attribute("bus_label_offset.y"s, rs.bus_label_offset.y, -100'000.0, 100'000.0);
 
-        rs.stop_label_font_size = dict.at("stop_label_font_size"s).AsInt();
+        rs.stop_label_font_size = dict.at("stop_label_font_size"sv).AsInt();
         check_attribute("stop_label_font_size"s, rs.stop_label_font_size, 0, 100'000);
 
-        const json::Array& stop_label_offset = dict.at("stop_label_offset"s).AsArray();
+        const json::view::Array stop_label_offset = dict.at("stop_label_offset"sv).AsArray();
         rs.stop_label_offset.x = stop_label_offset[0].AsDouble();
         check_attribute("stop_label_offset.x"s, rs.stop_label_offset.x, -100'000.0, 100'000.0);
         rs.stop_label_offset.y = stop_label_offset[1].AsDouble();
         check_attribute("stop_label_offset.y"s, rs.stop_label_offset.y, -100'000.0, 100'000.0);
 
-        rs.underlayer_width = dict.at("underlayer_width"s).AsDouble();
+        rs.underlayer_width = dict.at("underlayer_width"sv).AsDouble();
         check_attribute("underlayer_width"s, rs.underlayer_width, 0.0, 100'000.0);
 
-        const auto& underlayer_color = dict.at("underlayer_color"s);
+        const auto& underlayer_color = dict.at("underlayer_color"sv);
         rs.underlayer_color = ParseColor(underlayer_color);
 
-        const auto& color_palette = dict.at("color_palette"s).AsArray();
+        const auto color_palette = dict.at("color_palette"sv).AsArray();
         for (const auto& node_color : color_palette) {
             rs.color_palette.push_back(ParseColor(node_color));
         }
 
+        if (const auto iter = dict.find("simplification_tolerance"sv); iter != dict.end()) {
+            rs.simplification_tolerance = iter->second.AsDouble();
+            check_attribute("simplification_tolerance"s, rs.simplification_tolerance, 0.0, 100'000.0);
+        }
+
         return std::make_any<renderer::Settings>(std::move(rs));
     }
 
-    static svg::color::Color ParseColor(const json::Node& node) {
+    static svg::color::Color ParseColor(const json::view::Node& node) {
         if (node.IsString()) {
-            return node.AsString();
+            return std::string(node.AsString());
         } else if (node.IsArray()) {
-            const auto& color_array = node.AsArray();
+            const auto color_array = node.AsArray();
             if (color_array.size() < 3) {
                 throw std::invalid_argument("Unrecognized color format: expected RGB or RGBA format"s);
             }
@@ -252,34 +273,298 @@ private:
     }
 
     [[nodiscard]] std::any GetRouterSettings() const {
-        const auto& dict = current_node_->AsDict();
+        const auto dict = current_node_->AsDict();
         router::Settings rs;
-        rs.bus_wait_time = router::Minute{dict.at("bus_wait_time"s).AsDouble()};
-        rs.bus_velocity = router::KmPerHour{dict.at("bus_velocity"s).AsDouble()};
+        rs.bus_wait_time = router::Minute{dict.at("bus_wait_time"sv).AsDouble()};
+        rs.bus_velocity = router::KmPerHour{dict.at("bus_velocity"sv).AsDouble()};
+        if (const auto iter = dict.find("walking_velocity"sv); iter != dict.end()) {
+            rs.walking_velocity = router::KmPerHour{iter->second.AsDouble()};
+            if (rs.walking_velocity <= router::KmPerHour{0.0}) {
+                throw std::invalid_argument("routing_settings.walking_velocity must be positive"s);
+            }
+        }
+        if (const auto iter = dict.find("walking_stop_count"sv); iter != dict.end()) {
+            const int walking_stop_count = iter->second.AsInt();
+            if (walking_stop_count < 0) {
+                throw std::invalid_argument("routing_settings.walking_stop_count must be non-negative"s);
+            }
+            rs.walking_stop_count = walking_stop_count;
+        }
+        if (const auto iter = dict.find("max_walk_distance"sv); iter != dict.end()) {
+            rs.max_walk_distance = geo::Meter{iter->second.AsDouble()};
+            if (rs.max_walk_distance < geo::Meter{0.0}) {
+                throw std::invalid_argument("routing_settings.max_walk_distance must be non-negative"s);
+            }
+        }
         return rs;
     }
 
     [[nodiscard]] std::any GetSerializationSettings() const {
-        const auto& dict = current_node_->AsDict();
+        const auto dict = current_node_->AsDict();
         serialization::Settings ss;
-        ss.file = dict.at("file"s).AsString();
+        ss.file = dict.at("file"sv).AsString();
+        if (const auto iter = dict.find("png_tiles_max_zoom"sv); iter != dict.end()) {
+            const int zoom = iter->second.AsInt();
+            if (zoom < 0 || zoom > serialization::Settings::max_png_tiles_zoom) {
+                throw std::invalid_argument("serialization_settings.png_tiles_max_zoom must be from 0 to "s
+                                            + std::to_string(serialization::Settings::max_png_tiles_zoom));
+            }
+            ss.png_tiles_max_zoom = zoom;
+        }
         return std::make_any<decltype(ss)>(std::move(ss));
     }
 
     [[nodiscard]] std::any GetStartStopName() const {
-        std::string stop_name = current_node_->AsDict().at("from"s).AsString();
+        std::string stop_name(current_node_->AsDict().at("from"sv).AsString());
         return std::make_any<std::string>(std::move(stop_name));
     }
 
     [[nodiscard]] std::any GetEndStopName() const {
-        std::string stop_name = current_node_->AsDict().at("to"s).AsString();
+        std::string stop_name(current_node_->AsDict().at("to"sv).AsString());
         return std::make_any<std::string>(std::move(stop_name));
     }
+
+    [[nodiscard]] std::any GetStartPoint() const {
+        return ParseCoordinates(current_node_->AsDict().at("from"sv));
+    }
+
+    [[nodiscard]] std::any GetEndPoint() const {
+        return ParseCoordinates(current_node_->AsDict().at("to"sv));
+    }
+
+    [[nodiscard]] std::any GetCount() const {
+        const int count = current_node_->AsDict().at("count"sv).AsInt();
+        if (count < 0) {
+            throw std::invalid_argument("count must be non-negative"s);
+        }
+        return count;
+    }
+
+    [[nodiscard]] std::any GetBoundingBox() const {
+        const auto dict = current_node_->AsDict();
+        const auto min_latitude = geo::Degree{dict.at("min_latitude"sv).AsDouble()};
+        const auto min_longitude = geo::Degree{dict.at("min_longitude"sv).AsDouble()};
+        const auto max_latitude = geo::Degree{dict.at("max_latitude"sv).AsDouble()};
+        const auto max_longitude = geo::Degree{dict.at("max_longitude"sv).AsDouble()};
+        if (min_latitude > max_latitude || min_longitude > max_longitude) {
+            throw std::invalid_argument("Bounding box minimum must not exceed its maximum"s);
+        }
+        return spatial::BoundingBox{geo::Coordinates(min_latitude, min_longitude),
+                                    geo::Coordinates(max_latitude, max_longitude)};
+    }
+
+    /// Optional, false by default
+    [[nodiscard]] std::any GetWithMap() const {
+        const auto dict = current_node_->AsDict();
+        const auto iter = dict.find("with_map"sv);
+        return iter != dict.end() && iter->second.AsBool();
+    }
+
+    /// Optional, "svg" or "png", SVG by default
+    [[nodiscard]] std::any GetImageFormat() const {
+        const auto dict = current_node_->AsDict();
+        const auto iter = dict.find("format"sv);
+        if (iter == dict.end() || iter->second.AsString() == "svg"sv) {
+            return renderer::ImageFormat::Svg;
+        }
+        if (iter->second.AsString() == "png"sv) {
+            return renderer::ImageFormat::Png;
+        }
+        throw std::invalid_argument("format must be either svg or png"s);
+    }
+
+    /// Optional, "gzip" or "deflate", the map is not compressed by default
+    [[nodiscard]] std::any GetEncoding() const {
+        const auto dict = current_node_->AsDict();
+        const auto iter = dict.find("encoding"sv);
+        if (iter == dict.end()) {
+            return into::Encoding::Identity;
+        }
+        if (iter->second.AsString() == "gzip"sv) {
+            return into::Encoding::Gzip;
+        }
+        if (iter->second.AsString() == "deflate"sv) {
+            return into::Encoding::Deflate;
+        }
+        throw std::invalid_argument("encoding must be either gzip or deflate"s);
+    }
+
+    /// Either a tile with zoom, x and y or a bounding box
+    [[nodiscard]] std::any GetViewport() const {
+        const auto dict = current_node_->AsDict();
+        if (dict.find("zoom"sv) == dict.end()) {
+            return renderer::Viewport(std::any_cast<spatial::BoundingBox>(GetBoundingBox()));
+        }
+        return renderer::Viewport(renderer::Tile{dict.at("zoom"sv).AsInt(),
+                                                 dict.at("x"sv).AsInt(),
+                                                 dict.at("y"sv).AsInt()});
+    }
+};
+
+/// Turns requests into queries while the input is still being parsed,
+/// so only the request being parsed is kept as a JSON node
+class JsonRequestStream final : public json::EventHandler {
+public:
+    /// Strings of requests that lie inside \p stable_input are not copied
+    explicit JsonRequestStream(JsonParser& parser, std::string_view stable_input = {}) noexcept
+            : parser_(parser)
+            , builder_(arena_, stable_input) {
+    }
+
+    void Null() override {
+        OnValue([](json::EventHandler& handler) { handler.Null(); });
+    }
+
+    void Bool(bool value) override {
+        OnValue([value](json::EventHandler& handler) { handler.Bool(value); });
+    }
+
+    void Int(int value) override {
+        OnValue([value](json::EventHandler& handler) { handler.Int(value); });
+    }
+
+    void Double(double value) override {
+        OnValue([value](json::EventHandler& handler) { handler.Double(value); });
+    }
+
+    void String(std::string_view value) override {
+        OnValue([value](json::EventHandler& handler) { handler.String(value); });
+    }
+
+    void StartArray() override {
+        if (IsBuilding() || IsInsideRequestArray()) {
+            StartBuilding();
+            builder_.StartArray();
+        } else if (depth_ == 1) {
+            // Every element of a top-level array is a separate request
+            depth_ = 2;
+        } else {
+            throw std::invalid_argument("JSON queries must be a dictionary"s);
+        }
+    }
+
+    void EndArray() override {
+        if (IsBuilding()) {
+            builder_.EndArray();
+            FinishBuilding();
+        } else {
+            depth_ = 1;
+        }
+    }
+
+    void StartDict() override {
+        if (depth_ == 0) {
+            depth_ = 1;
+        } else {
+            StartBuilding();
+            builder_.StartDict();
+        }
+    }
+
+    void Key(std::string_view key) override {
+        if (IsBuilding()) {
+            builder_.Key(key);
+        } else {
+            request_type_ = key;
+        }
+    }
+
+    void EndDict() override {
+        if (IsBuilding()) {
+            builder_.EndDict();
+            FinishBuilding();
+        } else {
+            depth_ = 0;
+        }
+    }
+
+private:
+    JsonParser& parser_;
+    /// Holds nodes of the request being built and is reused for the next one
+    json::view::Arena arena_;
+    json::view::NodeBuilder builder_;
+    std::string request_type_;
+    /// 0 is outside of the root, 1 is inside the root dictionary, 2 is inside a top-level array
+    int depth_ = 0;
+    /// Nesting of arrays and dictionaries inside the request being built
+    int building_depth_ = 0;
+
+    [[nodiscard]] bool IsBuilding() const noexcept {
+        return building_depth_ > 0;
+    }
+
+    [[nodiscard]] bool IsInsideRequestArray() const noexcept {
+        return depth_ == 2;
+    }
+
+    void StartBuilding() noexcept {
+        ++building_depth_;
+    }
+
+    void FinishBuilding() {
+        if (--building_depth_ == 0) {
+            ParseRequest();
+        }
+    }
+
+    void ParseRequest() {
+        parser_.ParseRequest(request_type_, builder_.ReleaseNode());
+        arena_.Reset();
+    }
+
+    template<typename Forward>
+    void OnValue(Forward forward) {
+        if (IsBuilding()) {
+            forward(builder_);
+        } else if (IsInsideRequestArray()) {
+            forward(builder_);
+            ParseRequest();
+        } else if (depth_ == 0) {
+            throw std::invalid_argument("JSON queries must be a dictionary"s);
+        }
+        // Scalars at the top level are not requests and are skipped
+    }
 };
 
 [[nodiscard]] Parser::Result ReadQueries(from::Json from) {
     JsonParser parser;
-    parser.Parse(json::Load(from.input));
+    JsonRequestStream request_stream(parser);
+    json::Parse(from.input, request_stream);
+    return parser.ReleaseResult();
+}
+
+[[nodiscard]] Parser::Result ReadQueries(from::JsonText from) {
+    JsonParser parser;
+    JsonRequestStream request_stream(parser, from.text);
+    json::Parse(from.text, request_stream);
+    return parser.ReleaseResult();
+}
+
+/// Read a line of a newline-delimited stream, which is either a single stat request
+/// or a dictionary of requests in the format of the whole input. Base requests add to the loaded base
+[[nodiscard]] Parser::Result ReadLineQueries(std::string_view line) {
+    const auto document = json::view::Load(line);
+    const auto& root = document.GetRoot();
+    if (!root.IsDict()) {
+        throw std::invalid_argument("JSON queries must be a dictionary"s);
+    }
+
+    JsonParser parser;
+    const auto dict = root.AsDict();
+    if (dict.find("type"sv) != dict.end()) {
+        parser.ParseRequest("stat_requests"sv, root);
+        return parser.ReleaseResult();
+    }
+
+    for (const auto& [request_type, node] : dict) {
+        if (node.IsArray()) {
+            for (const auto& request : node.AsArray()) {
+                parser.ParseRequest(request_type, request);
+            }
+        } else if (node.IsDict()) {
+            parser.ParseRequest(request_type, node);
+        }
+    }
     return parser.ReleaseResult();
 }
 
@@ -288,6 +573,7 @@ private:
 namespace into {
 
 using namespace std::string_literals;
+using namespace std::string_view_literals;
 
 using StopInfo = std::optional<const queries::Handler::StopInfo*>;
 using BusInfo = std::optional<const queries::Handler::BusInfo*>;
@@ -344,19 +630,30 @@ json::Node BusInfoAsJson(int id, BusInfo bus_info) {
             .Build();
 }
 
-json::Node SvgAsJson(int id, const svg::Document& document) {
-    std::ostringstream str_output;
-    document.Render(str_output);
+/// The map compressed with \p encoding is followed by the name of the encoding.
+/// Contexts of json::Builder are private, so the one of the dictionary is deduced
+template <typename DictBuilder>
+void AddMap(DictBuilder& dict_builder, const queries::RenderedMap& rendered_map, into::Encoding encoding) {
+    if (const auto* encoded = rendered_map.GetEncoded(encoding)) {
+        dict_builder
+            .Key("map"s).Value(*encoded)
+            .Key("map_encoding"s).Value((encoding == into::Encoding::Gzip) ? "gzip"s : "deflate"s);
+    } else {
+        dict_builder.Key("map"s).Value(rendered_map.json_image);
+    }
+}
 
-    return json::Builder{}
-        .StartDict()
-            .Key("request_id"s).Value(id)
-            .Key("map"s).Value(str_output.str())
-        .EndDict()
-        .Build();
+json::Node SvgAsJson(int id, const queries::RenderedMap& rendered_map, into::Encoding encoding) {
+    auto builder = json::Builder{};
+    auto dict_builder = builder
+            .StartDict()
+                .Key("request_id"s).Value(id);
+    AddMap(dict_builder, rendered_map, encoding);
+    return dict_builder.EndDict().Build();
 }
 
-json::Node RouteAsJson(int id, const queries::Handler::RouteResult& route_result) {
+json::Node RouteAsJson(int id, const queries::Handler::RouteResult& route_result,
+                       const queries::RenderedMap* itinerary, into::Encoding encoding) {
     auto builder = json::Builder{};
     auto dict_builder = builder
             .StartDict()
@@ -370,7 +667,18 @@ json::Node RouteAsJson(int id, const queries::Handler::RouteResult& route_result
     }
 
     json::Array items;
-    items.reserve(std::distance(route_result.begin(), route_result.end()));
+    items.reserve(std::distance(route_result.begin(), route_result.end()) + 2);
+    if (const auto& start_walk = route_result.GetStartWalk()) {
+        auto walk_builder = json::Builder{};
+        auto walk_dict_builder = walk_builder
+                .StartDict()
+                    .Key("type"s).Value("Walk"s)
+                    .Key("time"s).Value(start_walk->time.Get());
+        if (start_walk->stop != nullptr) {
+            walk_dict_builder.Key("to"s).Value(start_walk->stop->name);
+        }
+        items.emplace_back(walk_dict_builder.EndDict().Build());
+    }
     for (const auto edge_id : route_result) {
         json::Node item_node;
         const auto& item = route_result.GetItem(edge_id);
@@ -395,61 +703,252 @@ json::Node RouteAsJson(int id, const queries::Handler::RouteResult& route_result
                         .Key("time"s).Value(bus_item.time.Get())
                     .EndDict()
                     .Build();
+        } else if (item.IsWalkItem()) {
+            const auto& walk_item = item.GetWalkItem();
+            item_node = json::Builder{}
+                    .StartDict()
+                        .Key("type"s).Value("Walk"s)
+                        .Key("from"s).Value(route_result.GetStopBy(route_result.GetVertexId(edge_id)).name)
+                        .Key("to"s).Value(route_result.GetStopBy(route_result.GetTargetVertexId(edge_id)).name)
+                        .Key("time"s).Value(walk_item.time.Get())
+                    .EndDict()
+                    .Build();
         }
         items.emplace_back(std::move(item_node));
     }
+    if (const auto& finish_walk = route_result.GetFinishWalk()) {
+        items.emplace_back(json::Builder{}
+                .StartDict()
+                    .Key("type"s).Value("Walk"s)
+                    .Key("from"s).Value(finish_walk->stop->name)
+                    .Key("time"s).Value(finish_walk->time.Get())
+                .EndDict()
+                .Build());
+    }
+
+    dict_builder
+            .Key("total_time"s).Value(route_result.GetTotalTime().Get())
+            .Key("items"s).Value(std::move(items));
+    if (itinerary != nullptr) {
+        AddMap(dict_builder, *itinerary, encoding);
+    }
+    return dict_builder.EndDict().Build();
+}
+
+json::Node NearestStopsAsJson(int id, const std::vector<spatial::Neighbour>& neighbours) {
+    json::Array stops;
+    stops.reserve(neighbours.size());
+    for (const auto& [stop_ptr, distance] : neighbours) {
+        stops.emplace_back(json::Builder{}
+                .StartDict()
+                    .Key("name"s).Value(stop_ptr->name)
+                    .Key("distance"s).Value(distance.Get())
+                .EndDict()
+                .Build());
+    }
+
+    return json::Builder{}
+        .StartDict()
+            .Key("request_id"s).Value(id)
+            .Key("stops"s).Value(std::move(stops))
+        .EndDict()
+        .Build();
+}
+
+json::Node StopsInBoxAsJson(int id, const std::vector<StopPtr>& stop_ptrs) {
+    json::Array stops;
+    stops.reserve(stop_ptrs.size());
+    std::transform(
+            stop_ptrs.cbegin(), stop_ptrs.cend(),
+            std::back_inserter(stops),
+            [](StopPtr stop_ptr) {
+                return stop_ptr->name;
+            });
+
+    return json::Builder{}
+        .StartDict()
+            .Key("request_id"s).Value(id)
+            .Key("stops"s).Value(std::move(stops))
+        .EndDict()
+        .Build();
+}
 
+json::Node ErrorAsJson(std::optional<int> id, std::string_view message) {
+    auto builder = json::Builder{};
+    auto dict_builder = builder.StartDict();
+    if (id.has_value()) {
+        dict_builder.Key("request_id"s).Value(*id);
+    }
     return dict_builder
-                .Key("total_time"s).Value(route_result.GetTotalTime().Get())
-                .Key("items"s).Value(std::move(items))
+                .Key("error_message"s).Value(std::string(message))
             .EndDict()
             .Build();
 }
 
-class JsonPrintDriver : public PrintDriver {
+/// The id of a line that is a single stat request, so that its error can be told from the others
+std::optional<int> FindRequestId(std::string_view line) noexcept {
+    try {
+        const auto document = json::view::Load(line);
+        const auto& root = document.GetRoot();
+        if (root.IsDict()) {
+            if (const auto* id = root.AsDict().find("id"sv); id != nullptr && id->second.IsInt()) {
+                return id->second.AsInt();
+            }
+        }
+    } catch (const std::exception&) {
+        // A malformed line has no id
+    }
+    return std::nullopt;
+}
+
+/// Messages of the catalogue are answered as is, while those of the standard library are implementation-defined
+/// and are replaced with stable ones
+std::string GetErrorMessage(const std::exception_ptr& error) {
+    try {
+        std::rethrow_exception(error);
+    } catch (const std::bad_optional_access&) {
+        // Unknown stops and buses, or a base without the settings the request needs
+        return "not found"s;
+    } catch (const std::out_of_range&) {
+        return "not found"s;
+    } catch (const json::ParsingError& parsing_error) {
+        return parsing_error.what();
+    } catch (const std::logic_error& logic_error) {
+        return logic_error.what();
+    } catch (const std::exception&) {
+        return "internal error"s;
+    }
+}
+
+class JsonPrintDriver final : public PrintDriver {
 public:
-    explicit JsonPrintDriver(std::ostream& output)
-            : PrintDriver(output) {
-        Initialize();
+    enum class Layout {
+        /// Responses are elements of a single pretty-printed array
+        Array,
+        /// Every response is a compact line of newline-delimited JSON
+        Lines,
+    };
+
+    explicit JsonPrintDriver(std::ostream& output, Layout layout = Layout::Array)
+            : PrintDriver(output)
+            , layout_(layout)
+            , writer_(output) {
     }
 
     void Flush() const override {
-        json::Print(json::Document(json::Node(std::move(array_))), GetOutput());
-    }
-
-    void Initialize() {
-        using PrintableStopInfo = std::tuple<int, std::string_view, StopInfo>;
-        using PrintableBusInfo = std::tuple<int, std::string_view, BusInfo>;
-        using PrintableMap = std::tuple<int, svg::Document>;
-        using PrintableRoute = std::tuple<int, queries::Handler::RouteResult>;
-
-        RegisterPrintOperation<PrintableStopInfo>([this](std::ostream&, const void* object) {
-            const auto [id, _, stop_info] = *reinterpret_cast<const PrintableStopInfo*>(object);
-            array_.emplace_back(StopInfoAsJson(id, stop_info));
-        });
-        RegisterPrintOperation<PrintableBusInfo>([this](std::ostream&, const void* object) {
-            const auto [id, _, bus_info] = *reinterpret_cast<const PrintableBusInfo*>(object);
-            array_.emplace_back(BusInfoAsJson(id, bus_info));
-        });
-        RegisterPrintOperation<PrintableMap>([this](std::ostream&, const void* object) {
-            const auto& [id, document] = *reinterpret_cast<const PrintableMap*>(object);
-            array_.emplace_back(SvgAsJson(id, document));
-        });
-        RegisterPrintOperation<PrintableRoute>([this](std::ostream&, const void* object) {
-            const auto& [id, route_result] = *reinterpret_cast<const PrintableRoute*>(object);
-            array_.emplace_back(RouteAsJson(id, route_result));
-        });
+        if (layout_ == Layout::Array) {
+            writer_.Close();
+        } else {
+            GetOutput().flush();
+        }
+    }
+
+    void Write(const json::Node& node) const {
+        if (layout_ == Layout::Array) {
+            writer_.Write(node);
+        } else {
+            json::PrintCompact(node, GetOutput());
+            GetOutput().put('\n');
+        }
+    }
+
+    using PrintDriver::Print;
+
+    void Print(const StopInfoResponse& response) const override {
+        Write(StopInfoAsJson(response.id, response.info));
+    }
+
+    void Print(const BusInfoResponse& response) const override {
+        Write(BusInfoAsJson(response.id, response.info));
+    }
+
+    void Print(const MapResponse& response) const override {
+        Write(SvgAsJson(response.id, response.map, response.encoding));
+    }
+
+    void Print(const RouteResponse& response) const override {
+        Write(RouteAsJson(response.id, response.route, response.map, response.encoding));
+    }
+
+    void Print(const NearestStopsResponse& response) const override {
+        Write(NearestStopsAsJson(response.id, response.neighbours));
+    }
+
+    void Print(const StopsInBoxResponse& response) const override {
+        Write(StopsInBoxAsJson(response.id, response.stops));
     }
 
 private:
-    mutable json::Array array_;
+    Layout layout_;
+    // Responses are printed as soon as they are ready
+    mutable json::ArrayWriter writer_;
 };
 
 void ProcessQueries(from::Parser::Result parse_result, queries::Handler& handler, into::Json into) {
-    static const JsonPrintDriver driver(into.output);
-    const Printer printer(driver);
-    parse_result.ProcessModifyQueries(handler, printer);
-    parse_result.ProcessResponseQueries(handler, printer);
+    const JsonPrintDriver driver(into.output);
+    try {
+        const Printer printer(driver);
+        parse_result.ProcessModifyQueries(handler, printer);
+        parse_result.ProcessResponseQueries(handler, printer);
+    } catch (...) {
+        // Responses are printed as soon as they are ready, so the printer has closed the array of those
+        // before the failed query, and they are flushed before the error stops the process
+        into.output.flush();
+        throw;
+    }
+}
+
+// JsonLineProcessor
+
+JsonLineProcessor::JsonLineProcessor(queries::Handler& handler, std::ostream& output)
+        : reloadable_handler_(&handler)
+        , handler_(handler)
+        , driver_(std::make_unique<JsonPrintDriver>(output, JsonPrintDriver::Layout::Lines)) {
+}
+
+JsonLineProcessor::JsonLineProcessor(const queries::Handler& handler, std::ostream& output)
+        : reloadable_handler_(nullptr)
+        , handler_(handler)
+        , driver_(std::make_unique<JsonPrintDriver>(output, JsonPrintDriver::Layout::Lines)) {
+}
+
+JsonLineProcessor::~JsonLineProcessor() = default;
+
+void JsonLineProcessor::ProcessLine(std::string_view line) {
+    if (line.find_first_not_of(" \t\r"sv) == std::string_view::npos) {
+        return;
+    }
+
+    // A malformed line is answered with an error and does not stop the stream
+    const Printer printer(*driver_);
+    try {
+        auto parse_result = from::ReadLineQueries(line);
+        if (reloadable_handler_ != nullptr) {
+            parse_result.ProcessStreamQueries(*reloadable_handler_, printer);
+        } else {
+            parse_result.ProcessReadQueries(handler_, printer);
+        }
+    } catch (const std::exception&) {
+        driver_->Write(ErrorAsJson(FindRequestId(line), GetErrorMessage(std::current_exception())));
+    }
+}
+
+void ProcessStream(from::Json from, queries::Handler& handler, into::Json into) {
+    JsonLineProcessor processor(handler, into.output);
+    std::string line;
+    while (std::getline(from.input, line)) {
+        processor.ProcessLine(line);
+    }
+}
+
+void ProcessStream(from::JsonText from, queries::Handler& handler, into::Json into) {
+    JsonLineProcessor processor(handler, into.output);
+    std::string_view text = from.text;
+    while (!text.empty()) {
+        const std::size_t line_end = std::min(text.find('\n'), text.size());
+        processor.ProcessLine(text.substr(0, line_end));
+        text.remove_prefix(std::min(line_end + 1, text.size()));
+    }
 }
 
 } // namespace into
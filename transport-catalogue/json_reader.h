@@ -15,7 +15,13 @@ struct Json {
     std::istream& input;
 };
 
+/// JSON queries that are already in memory, e.g. a memory-mapped input file
+struct JsonText {
+    std::string_view text;
+};
+
 [[nodiscard]] Parser::Result ReadQueries(from::Json from);
+[[nodiscard]] Parser::Result ReadQueries(from::JsonText from);
 
 } // namespace from
 
@@ -27,6 +33,36 @@ struct Json {
 
 void ProcessQueries(from::Parser::Result parse_result, queries::Handler& handler, into::Json into);
 
+class JsonPrintDriver;
+
+/// Answers lines of newline-delimited JSON with lines of compact JSON.
+/// A line is a single stat request or a dictionary of requests, whose serialization settings (re)load the base
+/// and whose base requests add stops and buses to it
+class JsonLineProcessor final {
+public:
+    JsonLineProcessor(queries::Handler& handler, std::ostream& output);
+
+    /// Lines with settings or base requests are answered with an error, so that processors may share the base
+    /// between threads
+    JsonLineProcessor(const queries::Handler& handler, std::ostream& output);
+
+    ~JsonLineProcessor();
+
+    /// Errors are answered with {"error_message": ...} lines, which have the request_id of a line with a single
+    /// request. Blank lines are skipped
+    void ProcessLine(std::string_view line);
+
+private:
+    /// Null if the base is shared and may not be reloaded
+    queries::Handler* reloadable_handler_;
+    const queries::Handler& handler_;
+    std::unique_ptr<JsonPrintDriver> driver_;
+};
+
+/// Answer every line of newline-delimited JSON as soon as it is read
+void ProcessStream(from::Json from, queries::Handler& handler, into::Json into);
+void ProcessStream(from::JsonText from, queries::Handler& handler, into::Json into);
+
 } // namespace into
 
 } // namespace transport_catalogue
\ No newline at end of file
@@ -0,0 +1,290 @@
+#include "json_view.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace json::view {
+
+using namespace std::string_literals;
+
+// Arena
+
+Arena::Arena(std::size_t block_size)
+        : block_size_(block_size) {
+}
+
+void* Arena::Allocate(std::size_t size, std::size_t alignment) {
+    while (block_index_ < blocks_.size()) {
+        Block& block = blocks_[block_index_];
+        const auto address = reinterpret_cast<std::uintptr_t>(block.data.get()) + used_;
+        const std::size_t padding = (alignment - address % alignment) % alignment;
+        if (used_ + padding + size <= block.size) {
+            used_ += padding + size;
+            return block.data.get() + used_ - size;
+        }
+        ++block_index_;
+        used_ = 0;
+    }
+
+    // Memory from operator new[] is aligned for any fundamental type
+    const std::size_t new_block_size = std::max(block_size_, size);
+    blocks_.push_back(Block{std::make_unique<std::byte[]>(new_block_size), new_block_size});
+    block_index_ = blocks_.size() - 1;
+    used_ = size;
+    return blocks_.back().data.get();
+}
+
+std::string_view Arena::CopyString(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+    auto* data = AllocateArray<char>(str.size());
+    std::memcpy(data, str.data(), str.size());
+    return {data, str.size()};
+}
+
+void Arena::Reset() noexcept {
+    block_index_ = 0;
+    used_ = 0;
+}
+
+// Array
+
+Array::Array(const Node* data, std::size_t size) noexcept
+        : data_(data)
+        , size_(size) {
+}
+
+const Node* Array::begin() const noexcept {
+    return data_;
+}
+
+const Node* Array::end() const noexcept {
+    return data_ + size_;
+}
+
+std::size_t Array::size() const noexcept {
+    return size_;
+}
+
+bool Array::empty() const noexcept {
+    return size_ == 0;
+}
+
+const Node& Array::operator[](std::size_t index) const noexcept {
+    return data_[index];
+}
+
+// Dict
+
+Dict::Dict(const Member* data, std::size_t size) noexcept
+        : data_(data)
+        , size_(size) {
+}
+
+const Member* Dict::begin() const noexcept {
+    return data_;
+}
+
+const Member* Dict::end() const noexcept {
+    return data_ + size_;
+}
+
+std::size_t Dict::size() const noexcept {
+    return size_;
+}
+
+bool Dict::empty() const noexcept {
+    return size_ == 0;
+}
+
+const Member* Dict::find(std::string_view key) const noexcept {
+    return std::find_if(begin(), end(), [key](const Member& member) {
+        return member.first == key;
+    });
+}
+
+const Node& Dict::at(std::string_view key) const {
+    if (const Member* member = find(key); member != end()) {
+        return member->second;
+    }
+    throw std::out_of_range("No such key '"s + std::string(key) + "' in the dictionary"s);
+}
+
+// Node
+
+bool Node::IsNull() const noexcept {
+    return std::holds_alternative<std::nullptr_t>(*this);
+}
+
+bool Node::IsBool() const noexcept {
+    return std::holds_alternative<bool>(*this);
+}
+
+bool Node::IsInt() const noexcept {
+    return std::holds_alternative<int>(*this);
+}
+
+bool Node::IsDouble() const noexcept {
+    return std::holds_alternative<double>(*this) || IsInt();
+}
+
+bool Node::IsPureDouble() const noexcept {
+    return std::holds_alternative<double>(*this);
+}
+
+bool Node::IsString() const noexcept {
+    return std::holds_alternative<std::string_view>(*this);
+}
+
+bool Node::IsArray() const noexcept {
+    return std::holds_alternative<Array>(*this);
+}
+
+bool Node::IsDict() const noexcept {
+    return std::holds_alternative<Dict>(*this);
+}
+
+bool Node::AsBool() const {
+    return TryGetAs<bool>();
+}
+
+int Node::AsInt() const {
+    return TryGetAs<int>();
+}
+
+double Node::AsDouble() const {
+    if (IsInt()) {
+        return TryGetAs<int>();
+    }
+    return TryGetAs<double>();
+}
+
+std::string_view Node::AsString() const {
+    return TryGetAs<std::string_view>();
+}
+
+Array Node::AsArray() const {
+    return TryGetAs<Array>();
+}
+
+Dict Node::AsDict() const {
+    return TryGetAs<Dict>();
+}
+
+// NodeBuilder
+
+NodeBuilder::NodeBuilder(Arena& arena, std::string_view stable_input) noexcept
+        : arena_(arena)
+        , stable_input_(stable_input) {
+}
+
+void NodeBuilder::Null() {
+    AddNode(Node());
+}
+
+void NodeBuilder::Bool(bool value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::Int(int value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::Double(double value) {
+    AddNode(Node(value));
+}
+
+void NodeBuilder::String(std::string_view value) {
+    AddNode(Node(Store(value)));
+}
+
+void NodeBuilder::StartArray() {
+    frames_.push_back(Frame{elements_.size(), key_});
+    is_dict_frames_.push_back(false);
+}
+
+void NodeBuilder::EndArray() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    is_dict_frames_.pop_back();
+
+    const std::size_t size = elements_.size() - frame.first;
+    auto* data = arena_.AllocateArray<Node>(size);
+    std::uninitialized_copy(elements_.begin() + frame.first, elements_.end(), data);
+    elements_.resize(frame.first);
+
+    key_ = frame.key;
+    AddNode(Node(Array(data, size)));
+}
+
+void NodeBuilder::StartDict() {
+    frames_.push_back(Frame{members_.size(), key_});
+    is_dict_frames_.push_back(true);
+}
+
+void NodeBuilder::Key(std::string_view key) {
+    key_ = Store(key);
+}
+
+void NodeBuilder::EndDict() {
+    const Frame frame = frames_.back();
+    frames_.pop_back();
+    is_dict_frames_.pop_back();
+
+    const std::size_t size = members_.size() - frame.first;
+    auto* data = arena_.AllocateArray<Member>(size);
+    std::uninitialized_copy(members_.begin() + frame.first, members_.end(), data);
+    members_.resize(frame.first);
+
+    key_ = frame.key;
+    AddNode(Node(Dict(data, size)));
+}
+
+bool NodeBuilder::HasNode() const noexcept {
+    return root_.has_value();
+}
+
+Node NodeBuilder::ReleaseNode() {
+    Node root = root_.value();
+    root_.reset();
+    return root;
+}
+
+std::string_view NodeBuilder::Store(std::string_view str) {
+    const std::less_equal<const char*> less_equal;
+    if (less_equal(stable_input_.data(), str.data())
+            && less_equal(str.data() + str.size(), stable_input_.data() + stable_input_.size())) {
+        return str;
+    }
+    return arena_.CopyString(str);
+}
+
+void NodeBuilder::AddNode(Node node) {
+    if (frames_.empty()) {
+        root_ = node;
+    } else if (is_dict_frames_.back()) {
+        members_.emplace_back(key_, node);
+    } else {
+        elements_.push_back(node);
+    }
+}
+
+// Document
+
+const Node& Document::GetRoot() const noexcept {
+    return root_;
+}
+
+Document Load(std::string_view text) {
+    Document document;
+    NodeBuilder builder(document.arena_, text);
+    Parse(text, builder);
+    document.root_ = builder.ReleaseNode();
+    return document;
+}
+
+} // namespace json::view
\ No newline at end of file
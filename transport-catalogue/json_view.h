@@ -0,0 +1,182 @@
+/// \file
+/// Read-only JSON document whose strings are views into the input and whose nodes live in an arena
+
+#pragma once
+
+#include "json.h"
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json::view {
+
+/// Bump allocator for trivially destructible objects that are all freed at once
+class Arena final {
+public:
+    static constexpr std::size_t default_block_size = 1 << 16;
+
+    explicit Arena(std::size_t block_size = default_block_size);
+
+    [[nodiscard]] void* Allocate(std::size_t size, std::size_t alignment);
+
+    template<typename T>
+    [[nodiscard]] T* AllocateArray(std::size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>);
+        return static_cast<T*>(Allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    [[nodiscard]] std::string_view CopyString(std::string_view str);
+
+    /// Free all the objects at once while keeping the memory for next allocations
+    void Reset() noexcept;
+
+private:
+    struct Block {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size;
+    };
+
+    std::size_t block_size_;
+    std::vector<Block> blocks_;
+    std::size_t block_index_ = 0;
+    std::size_t used_ = 0;
+};
+
+class Node;
+
+/// Elements are stored contiguously in an arena
+class Array final {
+public:
+    Array() noexcept = default;
+    Array(const Node* data, std::size_t size) noexcept;
+
+    [[nodiscard]] const Node* begin() const noexcept;
+    [[nodiscard]] const Node* end() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+    [[nodiscard]] const Node& operator[](std::size_t index) const noexcept;
+
+private:
+    const Node* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+using Member = std::pair<std::string_view, Node>;
+
+/// Members are stored contiguously in an arena in the order of the input.
+/// Lookup is linear, which is faster than a tree for objects of a few keys.
+/// Like for json::Dict, the first of duplicate keys wins
+class Dict final {
+public:
+    Dict() noexcept = default;
+    Dict(const Member* data, std::size_t size) noexcept;
+
+    [[nodiscard]] const Member* begin() const noexcept;
+    [[nodiscard]] const Member* end() const noexcept;
+    [[nodiscard]] std::size_t size() const noexcept;
+    [[nodiscard]] bool empty() const noexcept;
+
+    [[nodiscard]] const Member* find(std::string_view key) const noexcept;
+    [[nodiscard]] const Node& at(std::string_view key) const;
+
+private:
+    const Member* data_ = nullptr;
+    std::size_t size_ = 0;
+};
+
+using Value = std::variant<std::nullptr_t, bool, int, double, std::string_view, Array, Dict>;
+
+class Node final : private Value {
+public:
+    using Value::variant;
+
+    [[nodiscard]] bool IsNull() const noexcept;
+    [[nodiscard]] bool IsBool() const noexcept;
+    [[nodiscard]] bool IsInt() const noexcept;
+    [[nodiscard]] bool IsDouble() const noexcept;
+    [[nodiscard]] bool IsPureDouble() const noexcept;
+    [[nodiscard]] bool IsString() const noexcept;
+    [[nodiscard]] bool IsArray() const noexcept;
+    [[nodiscard]] bool IsDict() const noexcept;
+
+    [[nodiscard]] bool AsBool() const;
+    [[nodiscard]] int AsInt() const;
+    [[nodiscard]] double AsDouble() const;
+    [[nodiscard]] std::string_view AsString() const;
+    [[nodiscard]] Array AsArray() const;
+    [[nodiscard]] Dict AsDict() const;
+
+private:
+    template<typename R>
+    [[nodiscard]] R TryGetAs() const {
+        if (auto value_ptr = std::get_if<R>(this)) {
+            return *value_ptr;
+        }
+        using namespace std::string_literals;
+        throw std::logic_error("Node doesn't contain such type"s);
+    }
+};
+
+/// Builds nodes in an arena from events. Strings lying inside \p stable_input are kept as views,
+/// others (escaped strings or strings from temporary chunks) are copied into the arena
+class NodeBuilder final : public EventHandler {
+public:
+    explicit NodeBuilder(Arena& arena, std::string_view stable_input = {}) noexcept;
+
+    void Null() override;
+    void Bool(bool value) override;
+    void Int(int value) override;
+    void Double(double value) override;
+    void String(std::string_view value) override;
+
+    void StartArray() override;
+    void EndArray() override;
+
+    void StartDict() override;
+    void Key(std::string_view key) override;
+    void EndDict() override;
+
+    /// Whether the outermost value has been completed
+    [[nodiscard]] bool HasNode() const noexcept;
+    [[nodiscard]] Node ReleaseNode();
+
+private:
+    struct Frame {
+        std::size_t first;
+        std::string_view key;
+    };
+
+    Arena& arena_;
+    std::string_view stable_input_;
+
+    std::vector<Node> elements_;
+    std::vector<Member> members_;
+    std::vector<Frame> frames_;
+    std::vector<bool> is_dict_frames_;
+    std::string_view key_;
+    std::optional<Node> root_;
+
+    [[nodiscard]] std::string_view Store(std::string_view str);
+    void AddNode(Node node);
+};
+
+class Document final {
+public:
+    [[nodiscard]] const Node& GetRoot() const noexcept;
+
+private:
+    Arena arena_;
+    Node root_;
+
+    friend Document Load(std::string_view text);
+};
+
+/// Strings of the document refer to \p text, so it must outlive the document
+[[nodiscard]] Document Load(std::string_view text);
+
+} // namespace json::view
\ No newline at end of file
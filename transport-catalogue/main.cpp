@@ -1,30 +1,93 @@
 #include "request_handler.h"
+#include "mapped_file.h"
+#include "server.h"
+#include "snapshot.h"
+#include "tests/unit_tests.h"
 
+#include <csignal>
 #include <iostream>
 #include <string_view>
 
 using namespace std::string_view_literals;
 
 void PrintUsage(std::ostream& output = std::cerr) {
-    output << "Usage: transport_catalogue [make_base|process_requests]\n"sv;
+    output << "Usage: transport_catalogue [make_base|process_requests|process_stream|test]\n"sv
+           << "       transport_catalogue serve <socket path|port>\n"sv;
 }
 
+namespace {
+
+transport_catalogue::server::Server* running_server = nullptr;
+
+extern "C" void StopRunningServer(int) {
+    if (running_server != nullptr) {
+        running_server->Stop();
+    }
+}
+
+extern "C" void ReloadRunningServer(int) {
+    if (running_server != nullptr) {
+        running_server->RequestReload();
+    }
+}
+
+} // namespace
+
 int main(int argc, char* argv[]) {
     using namespace transport_catalogue;
 
-    if (argc != 2) {
+    const std::string_view mode = (argc > 1) ? std::string_view(argv[1]) : std::string_view{};
+    const bool is_serve_mode = (mode == "serve"sv);
+    if (argc != (is_serve_mode ? 3 : 2)) {
         PrintUsage();
         return 1;
     }
 
-    const std::string_view mode(argv[1]);
+    if (mode == "test"sv) {
+        unit_tests::RunAll();
+        return 0;
+    }
 
     TransportCatalogue database;
     renderer::MapRenderer renderer;
     router::TransportRouter router;
 
     queries::Handler handler(database, renderer, router);
-    const auto result = handler.ProcessQueries(mode, from::Json{std::cin}, into::Json{std::cout});
+
+    // An input redirected from a file is parsed right from the page cache, other inputs are read by chunks
+    constexpr int stdin_fd = 0;
+    const auto mapped_input = mapped_file::MappedFile::Map(stdin_fd);
+
+    // The serialization settings on the input point to the base that is served until SIGINT or SIGTERM.
+    // SIGHUP reloads the base file, e.g. after make_base has rebuilt it
+    if (is_serve_mode) {
+        auto snapshot = mapped_input
+                        ? queries::Snapshot::Load(from::JsonText{mapped_input->GetView()})
+                        : queries::Snapshot::Load(from::Json{std::cin});
+        queries::SnapshotHolder snapshots(std::move(snapshot), [](std::exception_ptr error) {
+            try {
+                if (error) {
+                    std::rethrow_exception(error);
+                }
+                std::cerr << "Base is reloaded\n"sv;
+            } catch (const std::exception& exception) {
+                std::cerr << "Failed to reload the base: "sv << exception.what() << '\n';
+            }
+        });
+
+        server::Server server(snapshots, server::Settings{server::Endpoint::Parse(argv[2])});
+        running_server = &server;
+        std::signal(SIGINT, StopRunningServer);
+        std::signal(SIGTERM, StopRunningServer);
+        std::signal(SIGHUP, ReloadRunningServer);
+        server.Run();
+        running_server = nullptr;
+        return 0;
+    }
+
+    const auto result = mapped_input
+                        ? handler.ProcessQueries(mode, from::JsonText{mapped_input->GetView()}, into::Json{std::cout})
+                        : handler.ProcessQueries(mode, from::Json{std::cin}, into::Json{std::cout});
     if (!result && result.IsIncorrectMode()) {
         PrintUsage();
         return 1;
@@ -1,6 +1,9 @@
 #include "map_renderer.h"
 
+#include <array>
+#include <cmath>
 #include <iterator>
+#include <limits>
 
 namespace transport_catalogue::renderer {
 
@@ -17,10 +20,74 @@ svg::Point SphereProjector::operator()(geo::Coordinates coords) const {
             ((max_lat_ - coords.lat) * zoom_factor_ + padding_).Get()};
 }
 
+double SphereProjector::GetZoomFactor() const noexcept {
+    return zoom_factor_;
+}
+
+namespace {
+
+[[nodiscard]] double ComputeDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) noexcept {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length_squared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (length_squared > 0.0) {
+        t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0.0, 1.0);
+    }
+    return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+}
+
+} // namespace
+
+std::vector<double> ComputeSignificance(const std::vector<svg::Point>& points) {
+    constexpr double infinity = std::numeric_limits<double>::infinity();
+
+    std::vector<double> significance(points.size(), infinity);
+    if (points.size() < 3) {
+        return significance;
+    }
+
+    struct Range {
+        std::size_t first;
+        std::size_t last;
+        double parent_significance;
+    };
+
+    // A point is dropped together with the point that splits its range, so it is not more significant than that one
+    std::vector<Range> ranges{{0, points.size() - 1, infinity}};
+    while (!ranges.empty()) {
+        const Range range = ranges.back();
+        ranges.pop_back();
+
+        std::size_t farthest = range.first;
+        double max_distance = -1.0;
+        for (std::size_t i = range.first + 1; i < range.last; ++i) {
+            const double distance = ComputeDistanceToSegment(points[i], points[range.first], points[range.last]);
+            if (distance > max_distance) {
+                farthest = i;
+                max_distance = distance;
+            }
+        }
+
+        const double farthest_significance = std::min(max_distance, range.parent_significance);
+        significance[farthest] = farthest_significance;
+        if (farthest - range.first > 1) {
+            ranges.push_back({range.first, farthest, farthest_significance});
+        }
+        if (range.last - farthest > 1) {
+            ranges.push_back({farthest, range.last, farthest_significance});
+        }
+    }
+
+    return significance;
+}
+
 // MapRenderer
 
 void MapRenderer::Initialize(Settings settings) {
     settings_ = std::move(settings);
+    // Templates are copied from each other below, so attributes of previous settings must not leak into them
+    templates_ = {};
 
     templates_.route_
         .SetFillColor(svg::color::None)
@@ -82,97 +149,308 @@ SphereProjector MapRenderer::MakeProjector(const std::vector<StopPtr>& sorted_ac
              settings_->width, settings_->height, settings_->padding };
 }
 
-void MapRenderer::RenderRoutes(svg::Document& document, const SphereProjector& projector,
-                               const std::vector<BusPtr>& sorted_buses) const {
-    auto color_iter = settings_->color_palette.cbegin();
-    auto color_end = settings_->color_palette.cend();
+svg::Document MapRenderer::RenderFragments(const std::vector<BusPtr>& added_buses, MapFragments& fragments) const {
+    if (!settings_.has_value()) {
+        throw std::runtime_error("MapRenderer must be initialized"s);
+    }
 
-    for (BusPtr bus_ptr : sorted_buses) {
+    auto& bus_fragments = fragments.buses_;
+    auto& stop_fragments = fragments.stops_;
+    const std::optional<spatial::BoundingBox> previous_box = fragments.box_;
+    for (BusPtr bus_ptr : added_buses) {
         if (bus_ptr->stops.empty()) {
             continue;
         }
+        bus_fragments.emplace(bus_ptr->name, MapFragments::BusFragment{bus_ptr, std::nullopt, std::nullopt, {}});
+
+        for (StopPtr stop_ptr : bus_ptr->stops) {
+            if (!stop_fragments.emplace(stop_ptr->name, MapFragments::StopFragment{stop_ptr, std::nullopt, {}, {}}).second) {
+                continue;
+            }
+            const geo::Coordinates coordinates = stop_ptr->coordinates;
+            auto& box = fragments.box_;
+            if (!box.has_value()) {
+                box = spatial::BoundingBox{coordinates, coordinates};
+            }
+            box->min = {std::min(box->min.lat, coordinates.lat), std::min(box->min.lng, coordinates.lng)};
+            box->max = {std::max(box->max.lat, coordinates.lat), std::max(box->max.lng, coordinates.lng)};
+        }
+    }
+
+    // The projection depends only on the extreme coordinates of the stops
+    const bool is_projection_changed = previous_box.has_value() != fragments.box_.has_value()
+            || (previous_box.has_value()
+                && (previous_box->min != fragments.box_->min || previous_box->max != fragments.box_->max));
+    std::vector<geo::Coordinates> corners;
+    if (fragments.box_.has_value()) {
+        corners = {fragments.box_->min, fragments.box_->max};
+    }
+    const SphereProjector projector(corners.cbegin(), corners.cend(),
+                                    settings_->width, settings_->height, settings_->padding);
+
+    std::size_t color_index = 0;
+    std::size_t label_count = 0;
+    for (auto& [_, fragment] : bus_fragments) {
+        const auto& color = GetColor(color_index);
+        if (is_projection_changed || !fragment.route.has_value()) {
+            fragment.route = MakeRoute(fragment.bus, color, projector);
+            fragment.labels = MakeBusLabels(fragment.bus, color, projector);
+        } else if (fragment.color_index != color_index) {
+            // Buses after an added one only change their colors
+            fragment.route->SetStrokeColor(color);
+            for (std::size_t i = 1; i < fragment.labels.size(); i += 2) {
+                fragment.labels[i].SetFillColor(color);
+            }
+        }
+        fragment.color_index = color_index++;
+        label_count += fragment.labels.size();
+    }
+
+    for (auto& [_, fragment] : stop_fragments) {
+        if (is_projection_changed || !fragment.circle.has_value()) {
+            const svg::Point point = projector(fragment.stop->coordinates);
+            fragment.circle = svg::Circle(templates_.stop_).SetCenter(point);
+            fragment.underlayer_name = svg::Text(templates_.underlayer_stop_name_)
+                    .SetPosition(point)
+                    .SetData(fragment.stop->name);
+            fragment.name = svg::Text(templates_.stop_name_)
+                    .SetPosition(point)
+                    .SetData(fragment.stop->name);
+        }
+    }
+
+    svg::Document document;
+    document.Reserve(bus_fragments.size() + label_count + stop_fragments.size() * 3);
+    for (const auto& [_, fragment] : bus_fragments) {
+        document.AddReference(*fragment.route);
+    }
+    for (const auto& [_, fragment] : bus_fragments) {
+        for (const auto& label : fragment.labels) {
+            document.AddReference(label);
+        }
+    }
+    for (const auto& [_, fragment] : stop_fragments) {
+        document.AddReference(*fragment.circle);
+    }
+    for (const auto& [_, fragment] : stop_fragments) {
+        document.AddReference(fragment.underlayer_name);
+        document.AddReference(fragment.name);
+    }
+
+    return document;
+}
+
+svg::Document MapRenderer::RenderViewport(const ViewportContent& content) const {
+    if (!settings_.has_value()) {
+        throw std::runtime_error("MapRenderer must be initialized"s);
+    }
+
+    const std::array corners{content.box.min, content.box.max};
+    const SphereProjector projector(corners.cbegin(), corners.cend(),
+                                    settings_->width, settings_->height, settings_->padding);
 
-        const auto& stops = bus_ptr->stops;
-        auto route = templates_.route_;
+    std::size_t object_count = content.stops.size() * 3 + content.walks.size();
+    for (const auto& route : content.routes) {
+        object_count += route.runs.size() + route.label_positions.size() * 2;
+    }
+    svg::Document document;
+    document.Reserve(object_count);
+
+    RenderWalks(document, projector, content.walks);
+    RenderRouteRuns(document, projector, content.routes);
+    RenderBusLabels(document, projector, content.routes);
+    const std::vector<svg::Point> stop_points = ProjectStops(projector, content.stops);
+    RenderStops(document, stop_points);
+    RenderStopNames(document, content.stops, stop_points);
+
+    return document;
+}
+
+geo::Degree MapRenderer::GetSimplificationTolerance(spatial::BoundingBox box) const {
+    if (!settings_.has_value()) {
+        throw std::runtime_error("MapRenderer must be initialized"s);
+    }
+    if (IsZero(settings_->simplification_tolerance)) {
+        return geo::Degree{0.0};
+    }
+
+    const std::array corners{box.min, box.max};
+    const SphereProjector projector(corners.cbegin(), corners.cend(),
+                                    settings_->width, settings_->height, settings_->padding);
+    if (IsZero(projector.GetZoomFactor())) {
+        return geo::Degree{0.0};
+    }
+    return geo::Degree{settings_->simplification_tolerance / projector.GetZoomFactor()};
+}
+
+const svg::color::Color& MapRenderer::GetColor(std::size_t color_index) const {
+    return settings_->color_palette[color_index % settings_->color_palette.size()];
+}
 
-        if (color_iter == color_end) {
-            color_iter = settings_->color_palette.cbegin();
+svg::Polyline MapRenderer::MakeRoute(BusPtr bus_ptr, const svg::color::Color& color,
+                                     const SphereProjector& projector) const {
+    const auto& stops = bus_ptr->stops;
+    auto route = templates_.route_;
+    route.SetStrokeColor(color);
+
+    std::vector<svg::Point> points;
+    points.reserve(stops.size());
+    for (StopPtr stop_ptr : stops) {
+        points.push_back(projector(stop_ptr->coordinates));
+    }
+
+    // The way back of a half route is simplified the same way as the way there
+    std::vector<bool> is_kept(points.size(), true);
+    if (!IsZero(settings_->simplification_tolerance)) {
+        const auto significance = ComputeSignificance(points);
+        for (std::size_t i = 0; i < points.size(); ++i) {
+            is_kept[i] = significance[i] > settings_->simplification_tolerance;
         }
-        route.SetStrokeColor(*color_iter);
+    }
 
-        for (StopPtr stop_ptr : stops) {
-            route.AddPoint(projector(stop_ptr->coordinates));
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        if (is_kept[i]) {
+            route.AddPoint(points[i]);
         }
-        if (bus_ptr->route_type == Bus::RouteType::Half) {
-            for (auto iter = ++stops.crbegin(); iter != stops.crend(); ++iter) {
-                route.AddPoint(projector((*iter)->coordinates));
+    }
+    if (bus_ptr->route_type == Bus::RouteType::Half) {
+        for (std::size_t i = points.size() - 1; i-- > 0;) {
+            if (is_kept[i]) {
+                route.AddPoint(points[i]);
             }
         }
+    }
 
-        document.Add(std::move(route));
+    return route;
+}
 
-        ++color_iter;
+std::vector<svg::Text> MapRenderer::MakeBusLabels(BusPtr bus_ptr, const svg::color::Color& color,
+                                                  const SphereProjector& projector) const {
+    const auto& stops = bus_ptr->stops;
+    std::vector<svg::Text> labels;
+    labels.reserve(4);
+
+    labels.push_back(svg::Text(templates_.underlayer_bus_name)
+            .SetData(bus_ptr->name)
+            .SetPosition(projector(stops.front()->coordinates)));
+    labels.push_back(svg::Text(templates_.bus_name_)
+            .SetData(bus_ptr->name)
+            .SetPosition(projector(stops.front()->coordinates))
+            .SetFillColor(color));
+
+    if (bus_ptr->route_type == Bus::RouteType::Half && stops.front() != stops.back()) {
+        labels.push_back(svg::Text(templates_.underlayer_bus_name)
+                .SetData(bus_ptr->name)
+                .SetPosition(projector(stops.back()->coordinates)));
+        labels.push_back(svg::Text(templates_.bus_name_)
+                .SetData(bus_ptr->name)
+                .SetPosition(projector(stops.back()->coordinates))
+                .SetFillColor(color));
+    }
+
+    return labels;
+}
+
+void MapRenderer::RenderRoutes(svg::Document& document, const SphereProjector& projector,
+                               const std::vector<BusPtr>& sorted_buses) const {
+    std::size_t color_index = 0;
+    for (BusPtr bus_ptr : sorted_buses) {
+        if (!bus_ptr->stops.empty()) {
+            document.Add(MakeRoute(bus_ptr, GetColor(color_index++), projector));
+        }
     }
 }
 
 void MapRenderer::RenderBusNames(svg::Document& document, const SphereProjector& projector,
                                  const std::vector<BusPtr>& sorted_buses) const {
-    auto color_iter = settings_->color_palette.cbegin();
-    auto color_end = settings_->color_palette.cend();
-
+    std::size_t color_index = 0;
     for (BusPtr bus_ptr : sorted_buses) {
         if (bus_ptr->stops.empty()) {
             continue;
         }
+        for (auto& label : MakeBusLabels(bus_ptr, GetColor(color_index++), projector)) {
+            document.Add(std::move(label));
+        }
+    }
+}
 
-        const auto& stops = bus_ptr->stops;
-
-        if (color_iter == color_end) {
-            color_iter = settings_->color_palette.cbegin();
+void MapRenderer::RenderWalks(svg::Document& document, const SphereProjector& projector,
+                              const std::vector<std::vector<geo::Coordinates>>& walks) const {
+    for (const auto& walk : walks) {
+        auto polyline = templates_.route_;
+        polyline.SetStrokeColor("black"s).SetStrokeWidth(settings_->line_width / 2);
+        for (const geo::Coordinates coordinates : walk) {
+            polyline.AddPoint(projector(coordinates));
         }
+        document.Add(std::move(polyline));
+    }
+}
 
+void MapRenderer::RenderRouteRuns(svg::Document& document, const SphereProjector& projector,
+                                  const std::vector<ViewportContent::Route>& routes) const {
+    const auto& palette = settings_->color_palette;
 
-        document.Add(svg::Text(templates_.underlayer_bus_name)
-                .SetData(bus_ptr->name)
-                .SetPosition(projector(stops.front()->coordinates)));
+    for (const auto& route : routes) {
+        for (const auto& run : route.runs) {
+            auto polyline = templates_.route_;
+            if (!palette.empty()) {
+                polyline.SetStrokeColor(palette[route.color_index % palette.size()]);
+            }
+            for (const geo::Coordinates coordinates : run) {
+                polyline.AddPoint(projector(coordinates));
+            }
+            document.Add(std::move(polyline));
+        }
+    }
+}
 
-        document.Add(svg::Text(templates_.bus_name_)
-                .SetData(bus_ptr->name)
-                .SetPosition(projector(stops.front()->coordinates))
-                .SetFillColor(*color_iter));
+void MapRenderer::RenderBusLabels(svg::Document& document, const SphereProjector& projector,
+                                  const std::vector<ViewportContent::Route>& routes) const {
+    const auto& palette = settings_->color_palette;
 
-        if (bus_ptr->route_type == Bus::RouteType::Half && stops.front() != stops.back()) {
+    for (const auto& route : routes) {
+        for (const geo::Coordinates position : route.label_positions) {
             document.Add(svg::Text(templates_.underlayer_bus_name)
-                    .SetData(bus_ptr->name)
-                    .SetPosition(projector(stops.back()->coordinates)));
-
-            document.Add(svg::Text(templates_.bus_name_)
-                    .SetData(bus_ptr->name)
-                    .SetPosition(projector(stops.back()->coordinates))
-                    .SetFillColor(*color_iter));
+                    .SetData(route.bus->name)
+                    .SetPosition(projector(position)));
+
+            auto label = svg::Text(templates_.bus_name_)
+                    .SetData(route.bus->name)
+                    .SetPosition(projector(position));
+            if (!palette.empty()) {
+                label.SetFillColor(palette[route.color_index % palette.size()]);
+            }
+            document.Add(std::move(label));
         }
+    }
+}
 
-        ++color_iter;
+std::vector<svg::Point> MapRenderer::ProjectStops(const SphereProjector& projector,
+                                                  const std::vector<StopPtr>& stops) {
+    std::vector<svg::Point> points;
+    points.reserve(stops.size());
+    for (StopPtr stop_ptr : stops) {
+        points.push_back(projector(stop_ptr->coordinates));
     }
+    return points;
 }
 
-void MapRenderer::RenderStops(svg::Document& document, const SphereProjector& projector,
-                              const std::vector<StopPtr>& sorted_active_stops) const {
-    for (StopPtr stop_ptr : sorted_active_stops) {
+void MapRenderer::RenderStops(svg::Document& document, const std::vector<svg::Point>& stop_points) const {
+    for (const svg::Point point : stop_points) {
         document.Add(svg::Circle(templates_.stop_)
-                .SetCenter(projector(stop_ptr->coordinates)));
+                .SetCenter(point));
     }
 }
 
-void MapRenderer::RenderStopNames(svg::Document& document, const SphereProjector& projector,
-                                  const std::vector<StopPtr>& sorted_active_stops) const {
-    for (StopPtr stop_ptr : sorted_active_stops) {
+void MapRenderer::RenderStopNames(svg::Document& document, const std::vector<StopPtr>& sorted_active_stops,
+                                  const std::vector<svg::Point>& stop_points) const {
+    for (std::size_t i = 0; i < sorted_active_stops.size(); ++i) {
         document.Add(svg::Text(templates_.underlayer_stop_name_)
-                .SetPosition(projector(stop_ptr->coordinates))
-                .SetData(stop_ptr->name));
+                .SetPosition(stop_points[i])
+                .SetData(sorted_active_stops[i]->name));
         document.Add(svg::Text(templates_.stop_name_)
-                 .SetPosition(projector(stop_ptr->coordinates))
-                 .SetData(stop_ptr->name));
+                 .SetPosition(stop_points[i])
+                 .SetData(sorted_active_stops[i]->name));
     }
 }
 
@@ -6,13 +6,17 @@
 #include "geo.h"
 #include "domain.h"
 #include "svg.h"
+#include "spatial_index.h"
 
 #include <algorithm>
 #include <cstdlib>
 #include <functional>
 #include <iostream>
+#include <map>
+#include <memory>
 #include <numeric>
 #include <optional>
+#include <string_view>
 #include <vector>
 #include <unordered_set>
 
@@ -69,6 +73,9 @@ public:
 
     svg::Point operator()(geo::Coordinates coords) const;
 
+    /// Pixels per degree
+    [[nodiscard]] double GetZoomFactor() const noexcept;
+
 private:
     geo::Degree padding_;
     geo::Degree min_lng_;
@@ -76,6 +83,10 @@ private:
     double zoom_factor_ = 0;
 };
 
+/// Douglas-Peucker significance of every point of a polyline: simplification with a tolerance
+/// keeps exactly the points whose significance exceeds it. The ends are always kept
+[[nodiscard]] std::vector<double> ComputeSignificance(const std::vector<svg::Point>& points);
+
 struct Settings {
     double width, height;
     double padding;
@@ -86,6 +97,14 @@ struct Settings {
     svg::Point bus_label_offset, stop_label_offset;
     svg::color::Color underlayer_color;
     std::vector<svg::color::Color> color_palette;
+    /// Largest distance in pixels between a simplified route and its stops; zero disables simplification
+    double simplification_tolerance = 0.0;
+};
+
+/// Format of rendered maps in responses
+enum class ImageFormat {
+    Svg,
+    Png,
 };
 
 struct Templates {
@@ -100,6 +119,61 @@ struct Templates {
     svg::Text stop_name_;
 };
 
+/// Parts of the map that intersect a geographic box, which is rendered to the whole canvas
+struct ViewportContent {
+    struct Route {
+        BusPtr bus;
+        /// Index of the bus among the buses of the whole map, so its color is the same on every viewport
+        std::size_t color_index;
+        /// Runs of consecutive route points whose segments intersect the box
+        std::vector<std::vector<geo::Coordinates>> runs;
+        std::vector<geo::Coordinates> label_positions;
+    };
+
+    spatial::BoundingBox box;
+    /// Sorted by bus names
+    std::vector<Route> routes;
+    /// Sorted by stop names
+    std::vector<StopPtr> stops;
+    /// Walks between stops, e.g. of an itinerary, drawn under the routes
+    std::vector<std::vector<geo::Coordinates>> walks;
+};
+
+class MapRenderer;
+
+/// Objects of every bus and stop of the map kept between renders of a database that only grows,
+/// so that adding a bus renders only its own objects and recolors the buses after it.
+/// Everything is rendered again when new stops change the projection of the map.
+/// Must be reset when the database or the render settings are replaced
+class MapFragments final {
+private:
+    friend MapRenderer;
+
+    // Documents rendered from fragments refer to their objects instead of copying them.
+    // Objects are empty until rendered
+
+    struct BusFragment {
+        BusPtr bus;
+        std::optional<std::size_t> color_index;
+        std::optional<svg::Polyline> route;
+        /// Underlayer and colored label at each end of the route
+        std::vector<svg::Text> labels;
+    };
+
+    struct StopFragment {
+        StopPtr stop;
+        std::optional<svg::Circle> circle;
+        svg::Text underlayer_name;
+        svg::Text name;
+    };
+
+    std::unordered_set<BusPtr> known_buses_;
+    std::multimap<std::string_view, BusFragment> buses_;
+    /// Stops on routes, of which one per name is drawn
+    std::map<std::string_view, StopFragment> stops_;
+    std::optional<spatial::BoundingBox> box_;
+};
+
 class MapRenderer final {
 public:
     void Initialize(Settings settings);
@@ -165,29 +239,69 @@ public:
         SphereProjector projector = MakeProjector(sorted_active_stops);
 
         svg::Document document;
+        // A route, at most four labels of a bus, and a circle with two labels of a stop
+        document.Reserve(sorted_buses.size() * 5 + sorted_active_stops.size() * 3);
 
         RenderRoutes(document, projector, sorted_buses);
         RenderBusNames(document, projector, sorted_buses);
-        RenderStops(document, projector, sorted_active_stops);
-        RenderStopNames(document, projector, sorted_active_stops);
+        const std::vector<svg::Point> stop_points = ProjectStops(projector, sorted_active_stops);
+        RenderStops(document, stop_points);
+        RenderStopNames(document, sorted_active_stops, stop_points);
 
         return document;
     }
 
+    /// Same as Render, but only the fragments affected by buses added since the previous render are rendered.
+    /// The document refers to objects of \p fragments, so it must be used before they change
+    template<typename BusesIter>
+    [[nodiscard]] svg::Document Render(BusesIter bus_first, BusesIter bus_last, MapFragments& fragments) const {
+        std::vector<BusPtr> added_buses;
+        for (; bus_first != bus_last; ++bus_first) {
+            const BusPtr bus_ptr = &*bus_first;
+            if (fragments.known_buses_.insert(bus_ptr).second) {
+                added_buses.push_back(bus_ptr);
+            }
+        }
+        return RenderFragments(added_buses, fragments);
+    }
+
+    [[nodiscard]] svg::Document RenderViewport(const ViewportContent& content) const;
+
+    /// Simplification tolerance of routes in a viewport of \p box, so routes are simplified more
+    /// at lower zoom levels and look the same on every level
+    [[nodiscard]] geo::Degree GetSimplificationTolerance(spatial::BoundingBox box) const;
+
 private:
     std::optional<Settings> settings_;
     Templates templates_;
 
     SphereProjector MakeProjector(const std::vector<StopPtr>& sorted_active_stops) const;
 
+    [[nodiscard]] svg::Document RenderFragments(const std::vector<BusPtr>& added_buses, MapFragments& fragments) const;
+
+    [[nodiscard]] const svg::color::Color& GetColor(std::size_t color_index) const;
+    [[nodiscard]] svg::Polyline MakeRoute(BusPtr bus_ptr, const svg::color::Color& color,
+                                          const SphereProjector& projector) const;
+    [[nodiscard]] std::vector<svg::Text> MakeBusLabels(BusPtr bus_ptr, const svg::color::Color& color,
+                                                       const SphereProjector& projector) const;
+
     void RenderRoutes(svg::Document& document, const SphereProjector& projector,
                       const std::vector<BusPtr>& sorted_buses) const;
     void RenderBusNames(svg::Document& document, const SphereProjector& projector,
                         const std::vector<BusPtr>& sorted_buses) const;
-    void RenderStops(svg::Document& document, const SphereProjector& projector,
-                     const std::vector<StopPtr>& sorted_active_stops) const;
-    void RenderStopNames(svg::Document& document, const SphereProjector& projector,
-                         const std::vector<StopPtr>& sorted_active_stops) const;
+    void RenderWalks(svg::Document& document, const SphereProjector& projector,
+                     const std::vector<std::vector<geo::Coordinates>>& walks) const;
+    void RenderRouteRuns(svg::Document& document, const SphereProjector& projector,
+                         const std::vector<ViewportContent::Route>& routes) const;
+    void RenderBusLabels(svg::Document& document, const SphereProjector& projector,
+                         const std::vector<ViewportContent::Route>& routes) const;
+    /// Stop layers share the projected points instead of projecting every stop for each of them
+    [[nodiscard]] static std::vector<svg::Point> ProjectStops(const SphereProjector& projector,
+                                                              const std::vector<StopPtr>& stops);
+
+    void RenderStops(svg::Document& document, const std::vector<svg::Point>& stop_points) const;
+    void RenderStopNames(svg::Document& document, const std::vector<StopPtr>& sorted_active_stops,
+                         const std::vector<svg::Point>& stop_points) const;
 };
 
 } // namespace transport_catalogue::renderer
\ No newline at end of file
@@ -0,0 +1,286 @@
+#include "map_viewport.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace transport_catalogue::renderer {
+
+using namespace std::string_literals;
+
+namespace {
+
+[[nodiscard]] bool IntersectsSegment(spatial::BoundingBox box, geo::Coordinates from, geo::Coordinates to) noexcept {
+    return std::min(from.lat, to.lat) <= box.max.lat && box.min.lat <= std::max(from.lat, to.lat)
+        && std::min(from.lng, to.lng) <= box.max.lng && box.min.lng <= std::max(from.lng, to.lng);
+}
+
+/// Stops a bus passes from \p from to \p to through \p span_count spans
+[[nodiscard]] std::vector<geo::Coordinates> GetLegPoints(BusPtr bus_ptr, StopPtr from, StopPtr to,
+                                                       std::size_t span_count) {
+    // A half route is driven there and back
+    std::vector<StopPtr> stops = bus_ptr->stops;
+    if (bus_ptr->route_type == Bus::RouteType::Half && !stops.empty()) {
+        stops.insert(stops.end(), std::next(bus_ptr->stops.rbegin()), bus_ptr->stops.rend());
+    }
+
+    std::vector<geo::Coordinates> points;
+    for (std::size_t first = 0; first + span_count < stops.size(); ++first) {
+        if (stops[first] == from && stops[first + span_count] == to) {
+            points.reserve(span_count + 1);
+            for (std::size_t i = first; i <= first + span_count; ++i) {
+                points.push_back(stops[i]->coordinates);
+            }
+            return points;
+        }
+    }
+    return {from->coordinates, to->coordinates};
+}
+
+} // namespace
+
+// Tile
+
+bool Tile::operator==(const Tile& rhs) const noexcept {
+    return zoom == rhs.zoom && x == rhs.x && y == rhs.y;
+}
+
+bool Tile::operator!=(const Tile& rhs) const noexcept {
+    return !(*this == rhs);
+}
+
+std::size_t TileHasher::operator()(const Tile& tile) const noexcept {
+    // Coordinates of tiles fit into max_zoom bits
+    return (static_cast<std::size_t>(tile.zoom) << 58)
+        ^ (static_cast<std::size_t>(tile.x) << Tile::max_zoom)
+        ^ static_cast<std::size_t>(tile.y);
+}
+
+// MapLayout
+
+MapLayout::MapLayout(const TransportCatalogue& database) {
+    for (const Bus& bus : database.GetAllBuses()) {
+        if (!bus.stops.empty()) {
+            sorted_buses_.push_back(&bus);
+        }
+    }
+    std::sort(sorted_buses_.begin(), sorted_buses_.end(), [](BusPtr lhs, BusPtr rhs) noexcept {
+        return lhs->name < rhs->name;
+    });
+
+    bool is_first_stop = true;
+    for (std::size_t i = 0; i < sorted_buses_.size(); ++i) {
+        const BusPtr bus_ptr = sorted_buses_[i];
+        color_indices_.emplace(bus_ptr, i);
+
+        for (StopPtr stop_ptr : bus_ptr->stops) {
+            const geo::Coordinates coordinates = stop_ptr->coordinates;
+            if (std::exchange(is_first_stop, false)) {
+                box_ = {coordinates, coordinates};
+            }
+            box_.min = {std::min(box_.min.lat, coordinates.lat), std::min(box_.min.lng, coordinates.lng)};
+            box_.max = {std::max(box_.max.lat, coordinates.lat), std::max(box_.max.lng, coordinates.lng)};
+        }
+    }
+}
+
+const std::vector<BusPtr>& MapLayout::GetBuses() const noexcept {
+    return sorted_buses_;
+}
+
+std::size_t MapLayout::GetColorIndex(BusPtr bus_ptr) const {
+    return color_indices_.at(bus_ptr);
+}
+
+spatial::BoundingBox MapLayout::GetBox() const noexcept {
+    return box_;
+}
+
+ViewportContent MapLayout::SelectItinerary(const router::TransportRouter::Result& route,
+                                           std::optional<geo::Coordinates> from,
+                                           std::optional<geo::Coordinates> to) const {
+    ViewportContent content;
+    content.box = box_;
+    if (!route) {
+        return content;
+    }
+
+    std::vector<StopPtr> stops;
+    const auto& start_walk = route.GetStartWalk();
+    if (start_walk && from) {
+        if (start_walk->stop != nullptr) {
+            content.walks.push_back({*from, start_walk->stop->coordinates});
+        } else if (to) {
+            content.walks.push_back({*from, *to});
+        }
+    }
+    for (const auto edge_id : route) {
+        const auto item = route.GetItem(edge_id);
+        if (!item.IsBusItem() && !item.IsWalkItem()) {
+            continue;
+        }
+
+        StopPtr from_stop = &route.GetStopBy(route.GetVertexId(edge_id));
+        StopPtr to_stop = &route.GetStopBy(route.GetTargetVertexId(edge_id));
+        stops.push_back(from_stop);
+        stops.push_back(to_stop);
+
+        if (item.IsWalkItem()) {
+            content.walks.push_back({from_stop->coordinates, to_stop->coordinates});
+            continue;
+        }
+
+        const BusPtr bus_ptr = &route.GetBusBy(edge_id);
+        ViewportContent::Route leg{bus_ptr, GetColorIndex(bus_ptr), {}, {from_stop->coordinates}};
+        leg.runs.push_back(GetLegPoints(bus_ptr, from_stop, to_stop, item.GetBusItem().span_count));
+        content.routes.push_back(std::move(leg));
+    }
+    if (const auto& finish_walk = route.GetFinishWalk(); finish_walk && finish_walk->stop != nullptr && to) {
+        content.walks.push_back({finish_walk->stop->coordinates, *to});
+    }
+
+    std::sort(stops.begin(), stops.end(), [](StopPtr lhs, StopPtr rhs) noexcept {
+        return lhs->name < rhs->name;
+    });
+    stops.erase(std::unique(stops.begin(), stops.end()), stops.end());
+    content.stops = std::move(stops);
+
+    return content;
+}
+
+// ViewportSelector
+
+ViewportSelector::ViewportSelector(const TransportCatalogue& database)
+        : database_(database)
+        , layout_(database) {
+    for (const BusPtr bus_ptr : layout_.GetBuses()) {
+        const auto& stops = bus_ptr->stops;
+        std::vector<svg::Point> points;
+        points.reserve(stops.size());
+        for (StopPtr stop_ptr : stops) {
+            // Longitude and latitude are scaled equally by the projection of the map
+            points.push_back({stop_ptr->coordinates.lng.Get(), stop_ptr->coordinates.lat.Get()});
+        }
+        significances_.emplace(bus_ptr, ComputeSignificance(points));
+
+        for (auto iter = stops.begin(); iter != stops.end(); ++iter) {
+            auto& buses = stop_buses_[*iter];
+            if (buses.empty() || buses.back() != bus_ptr) {
+                buses.push_back(bus_ptr);
+            }
+
+            if (iter != stops.begin()) {
+                const geo::Coordinates coordinates = (*iter)->coordinates;
+                const geo::Coordinates previous = (*std::prev(iter))->coordinates;
+                max_segment_lat_extent_ = std::max(max_segment_lat_extent_,
+                                                   std::max(previous.lat, coordinates.lat) - std::min(previous.lat, coordinates.lat));
+                max_segment_lng_extent_ = std::max(max_segment_lng_extent_,
+                                                   std::max(previous.lng, coordinates.lng) - std::min(previous.lng, coordinates.lng));
+            }
+        }
+    }
+}
+
+spatial::BoundingBox ViewportSelector::GetBox(const Viewport& viewport) const {
+    if (const auto* tile = std::get_if<Tile>(&viewport)) {
+        return GetTileBox(*tile);
+    }
+    return std::get<spatial::BoundingBox>(viewport);
+}
+
+ViewportContent ViewportSelector::Select(spatial::BoundingBox box, geo::Degree tolerance) const {
+    ViewportContent content;
+    content.box = box;
+
+    for (StopPtr stop_ptr : database_.FindStopsInBox(box)) {
+        if (stop_buses_.count(stop_ptr) != 0) {
+            content.stops.push_back(stop_ptr);
+        }
+    }
+
+    // A simplified route crossing the box has stops closer than the tolerance to it
+    const geo::Degree lat_margin = max_segment_lat_extent_ + tolerance;
+    const geo::Degree lng_margin = max_segment_lng_extent_ + tolerance;
+    const spatial::BoundingBox extended_box{
+            {box.min.lat - lat_margin, box.min.lng - lng_margin},
+            {box.max.lat + lat_margin, box.max.lng + lng_margin}};
+    std::vector<BusPtr> candidate_buses;
+    for (StopPtr stop_ptr : database_.FindStopsInBox(extended_box)) {
+        if (const auto iter = stop_buses_.find(stop_ptr); iter != stop_buses_.end()) {
+            candidate_buses.insert(candidate_buses.end(), iter->second.begin(), iter->second.end());
+        }
+    }
+    std::sort(candidate_buses.begin(), candidate_buses.end(), [](BusPtr lhs, BusPtr rhs) noexcept {
+        return lhs->name < rhs->name;
+    });
+    candidate_buses.erase(std::unique(candidate_buses.begin(), candidate_buses.end()), candidate_buses.end());
+
+    for (BusPtr bus_ptr : candidate_buses) {
+        auto route = SelectRoute(bus_ptr, box, tolerance);
+        if (!route.runs.empty() || !route.label_positions.empty()) {
+            content.routes.push_back(std::move(route));
+        }
+    }
+
+    return content;
+}
+
+spatial::BoundingBox ViewportSelector::GetTileBox(Tile tile) const {
+    if (tile.zoom < 0 || tile.zoom > Tile::max_zoom) {
+        throw std::invalid_argument("Tile zoom must be from 0 to "s + std::to_string(Tile::max_zoom));
+    }
+    const int tile_count = 1 << tile.zoom;
+    if (tile.x < 0 || tile.x >= tile_count || tile.y < 0 || tile.y >= tile_count) {
+        throw std::invalid_argument("Tile is out of the map at zoom "s + std::to_string(tile.zoom));
+    }
+
+    const spatial::BoundingBox map_box = layout_.GetBox();
+    const geo::Degree lng_step = (map_box.max.lng - map_box.min.lng) / static_cast<double>(tile_count);
+    const geo::Degree lat_step = (map_box.max.lat - map_box.min.lat) / static_cast<double>(tile_count);
+    return {{map_box.max.lat - lat_step * static_cast<double>(tile.y + 1), map_box.min.lng + lng_step * static_cast<double>(tile.x)},
+            {map_box.max.lat - lat_step * static_cast<double>(tile.y), map_box.min.lng + lng_step * static_cast<double>(tile.x + 1)}};
+}
+
+ViewportContent::Route ViewportSelector::SelectRoute(BusPtr bus_ptr, spatial::BoundingBox box,
+                                                     geo::Degree tolerance) const {
+    ViewportContent::Route route{bus_ptr, layout_.GetColorIndex(bus_ptr), {}, {}};
+
+    const auto& stops = bus_ptr->stops;
+    const auto& significance = significances_.at(bus_ptr);
+    std::vector<geo::Coordinates> points;
+    points.reserve(stops.size());
+    for (std::size_t i = 0; i < stops.size(); ++i) {
+        if (significance[i] > tolerance.Get()) {
+            points.push_back(stops[i]->coordinates);
+        }
+    }
+
+    // The way back of a half route retraces the way there, so it is not drawn again
+    bool is_run_open = false;
+    for (std::size_t i = 1; i < points.size(); ++i) {
+        const geo::Coordinates from = points[i - 1];
+        const geo::Coordinates to = points[i];
+        if (!IntersectsSegment(box, from, to)) {
+            is_run_open = false;
+            continue;
+        }
+        if (!std::exchange(is_run_open, true)) {
+            route.runs.push_back({from});
+        }
+        route.runs.back().push_back(to);
+    }
+
+    if (box.Contains(stops.front()->coordinates)) {
+        route.label_positions.push_back(stops.front()->coordinates);
+    }
+    if (bus_ptr->route_type == Bus::RouteType::Half && stops.front() != stops.back()
+            && box.Contains(stops.back()->coordinates)) {
+        route.label_positions.push_back(stops.back()->coordinates);
+    }
+
+    return route;
+}
+
+} // namespace transport_catalogue::renderer
\ No newline at end of file
@@ -0,0 +1,96 @@
+/// \file
+/// Selecting parts of the map that intersect viewports and map tiles
+
+#pragma once
+
+#include "geo.h"
+#include "domain.h"
+#include "map_renderer.h"
+#include "spatial_index.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace transport_catalogue::renderer {
+
+/// Tile 0/0/0 is the bounding box of all stops on routes, i.e. the area of the whole map,
+/// and every zoom level splits each tile of the previous one into four. Columns go eastwards, rows go southwards
+struct Tile {
+    int zoom;
+    int x;
+    int y;
+
+    static constexpr int max_zoom = 24;
+    /// The longer side of PNG tiles in pixels, whatever the canvas size is; SVG tiles keep the canvas size
+    static constexpr double png_size = 256.0;
+
+    [[nodiscard]] bool operator==(const Tile& rhs) const noexcept;
+    [[nodiscard]] bool operator!=(const Tile& rhs) const noexcept;
+};
+
+struct TileHasher {
+    [[nodiscard]] std::size_t operator()(const Tile& tile) const noexcept;
+};
+
+/// A geographic box or a tile of the map
+using Viewport = std::variant<spatial::BoundingBox, Tile>;
+
+/// The box and the bus colors of the whole map, shared by its viewports and the itineraries that overlay it.
+/// Cheap to build, since routes are neither indexed nor simplified
+class MapLayout final {
+public:
+    explicit MapLayout(const TransportCatalogue& database);
+
+    /// Buses with stops sorted by names, in the order of their colors
+    [[nodiscard]] const std::vector<BusPtr>& GetBuses() const noexcept;
+    [[nodiscard]] std::size_t GetColorIndex(BusPtr bus_ptr) const;
+    /// The bounding box of all stops on routes, i.e. tile 0/0/0
+    [[nodiscard]] spatial::BoundingBox GetBox() const noexcept;
+
+    /// Bus legs, walks and the stops where they start and finish of \p route in the box of the whole map,
+    /// so the itinerary overlays the map. Only stops of the itinerary are visited.
+    /// Walks from \p from and to \p to are drawn for routes between addresses
+    [[nodiscard]] ViewportContent SelectItinerary(const router::TransportRouter::Result& route,
+                                                  std::optional<geo::Coordinates> from = std::nullopt,
+                                                  std::optional<geo::Coordinates> to = std::nullopt) const;
+
+private:
+    std::vector<BusPtr> sorted_buses_;
+    std::unordered_map<BusPtr, std::size_t> color_indices_;
+    spatial::BoundingBox box_;
+};
+
+/// Finds what intersects viewports of a database that doesn't change while the selector lives.
+/// Candidate stops are found by the spatial index of the database in the viewport extended
+/// by the largest extent of route segments, so every segment that intersects the viewport has both ends among them
+class ViewportSelector final {
+public:
+    explicit ViewportSelector(const TransportCatalogue& database);
+
+    [[nodiscard]] spatial::BoundingBox GetBox(const Viewport& viewport) const;
+
+    /// Routes are simplified so that they stay closer than \p tolerance to their stops
+    [[nodiscard]] ViewportContent Select(spatial::BoundingBox box, geo::Degree tolerance = geo::Degree{0.0}) const;
+
+private:
+    const TransportCatalogue& database_;
+    MapLayout layout_;
+
+    std::unordered_map<StopPtr, std::vector<BusPtr>> stop_buses_;
+    /// Significance of stops of routes for simplification, computed once for all zoom levels
+    std::unordered_map<BusPtr, std::vector<double>> significances_;
+
+    geo::Degree max_segment_lat_extent_{0.0};
+    geo::Degree max_segment_lng_extent_{0.0};
+
+    [[nodiscard]] spatial::BoundingBox GetTileBox(Tile tile) const;
+    [[nodiscard]] ViewportContent::Route SelectRoute(BusPtr bus_ptr, spatial::BoundingBox box, geo::Degree tolerance) const;
+};
+
+} // namespace transport_catalogue::renderer
\ No newline at end of file
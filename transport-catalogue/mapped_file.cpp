@@ -0,0 +1,71 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MAPPED_FILE_HAS_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace mapped_file {
+
+std::optional<MappedFile> MappedFile::Map([[maybe_unused]] int fd) {
+#ifdef MAPPED_FILE_HAS_MMAP
+    struct stat file_stat{};
+    if (fstat(fd, &file_stat) != 0 || !S_ISREG(file_stat.st_mode) || file_stat.st_size <= 0) {
+        return std::nullopt;
+    }
+
+    const auto size = static_cast<std::size_t>(file_stat.st_size);
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+        return std::nullopt;
+    }
+    // The file is read once from the beginning to the end
+    madvise(data, size, MADV_SEQUENTIAL);
+
+    return MappedFile(static_cast<const char*>(data), size);
+#else
+    return std::nullopt;
+#endif
+}
+
+MappedFile::MappedFile(const char* data, std::size_t size) noexcept
+        : data_(data)
+        , size_(size) {
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr))
+        , size_(std::exchange(other.size_, 0)) {
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        Unmap();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile() {
+    Unmap();
+}
+
+std::string_view MappedFile::GetView() const noexcept {
+    return {data_, size_};
+}
+
+void MappedFile::Unmap() noexcept {
+#ifdef MAPPED_FILE_HAS_MMAP
+    if (data_ != nullptr) {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+    size_ = 0;
+}
+
+} // namespace mapped_file
\ No newline at end of file
@@ -0,0 +1,35 @@
+/// \file
+/// Read-only memory mapping of a file, so large inputs are parsed without copying them
+
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace mapped_file {
+
+class MappedFile final {
+public:
+    /// Map a regular file opened as \p fd. Pipes, terminals and systems without mmap give std::nullopt
+    [[nodiscard]] static std::optional<MappedFile> Map(int fd);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    ~MappedFile();
+
+    [[nodiscard]] std::string_view GetView() const noexcept;
+
+private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+
+    MappedFile(const char* data, std::size_t size) noexcept;
+
+    void Unmap() noexcept;
+};
+
+} // namespace mapped_file
\ No newline at end of file
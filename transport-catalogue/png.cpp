@@ -0,0 +1,109 @@
+#include "png.h"
+#include "deflate.h"
+
+#include <array>
+#include <cstdlib>
+#include <stdexcept>
+#include <string_view>
+
+namespace png {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+constexpr std::size_t bytes_per_pixel = 4;
+
+void WriteBigEndian(std::string& output, std::uint32_t value) {
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        output.push_back(static_cast<char>((value >> shift) & 0xFF));
+    }
+}
+
+void WriteChunk(std::string& output, std::string_view type, std::string_view data) {
+    WriteBigEndian(output, static_cast<std::uint32_t>(data.size()));
+    const std::size_t type_position = output.size();
+    output += type;
+    output += data;
+    WriteBigEndian(output, deflate::Crc32(std::string_view(output).substr(type_position)));
+}
+
+[[nodiscard]] std::uint8_t Paeth(int left, int up, int up_left) noexcept {
+    const int estimate = left + up - up_left;
+    const int left_distance = std::abs(estimate - left);
+    const int up_distance = std::abs(estimate - up);
+    const int up_left_distance = std::abs(estimate - up_left);
+    if (left_distance <= up_distance && left_distance <= up_left_distance) {
+        return static_cast<std::uint8_t>(left);
+    }
+    return static_cast<std::uint8_t>(up_distance <= up_left_distance ? up : up_left);
+}
+
+/// Rows are filtered with the filter whose output has the smallest sum of absolute values, as libpng does by default
+void FilterRow(std::string& output, const std::uint8_t* row, const std::uint8_t* previous_row, std::size_t row_size) {
+    constexpr std::size_t filter_count = 5;
+    std::array<std::string, filter_count> candidates;
+    std::array<std::uint64_t, filter_count> costs{};
+    for (std::size_t filter = 0; filter < filter_count; ++filter) {
+        auto& candidate = candidates[filter];
+        candidate.resize(row_size);
+        for (std::size_t i = 0; i < row_size; ++i) {
+            const int left = i >= bytes_per_pixel ? row[i - bytes_per_pixel] : 0;
+            const int up = previous_row != nullptr ? previous_row[i] : 0;
+            const int up_left = previous_row != nullptr && i >= bytes_per_pixel ? previous_row[i - bytes_per_pixel] : 0;
+            int predicted = 0;
+            switch (filter) {
+                case 1: predicted = left; break;
+                case 2: predicted = up; break;
+                case 3: predicted = (left + up) / 2; break;
+                case 4: predicted = Paeth(left, up, up_left); break;
+                default: break;
+            }
+            const auto value = static_cast<std::int8_t>(static_cast<std::uint8_t>(row[i] - predicted));
+            candidate[i] = static_cast<char>(value);
+            costs[filter] += static_cast<std::uint64_t>(std::abs(static_cast<int>(value)));
+        }
+    }
+
+    std::size_t best = 0;
+    for (std::size_t filter = 1; filter < filter_count; ++filter) {
+        if (costs[filter] < costs[best]) {
+            best = filter;
+        }
+    }
+    output.push_back(static_cast<char>(best));
+    output += candidates[best];
+}
+
+} // namespace
+
+std::string Encode(std::size_t width, std::size_t height, const std::vector<std::uint8_t>& rgba) {
+    if (width == 0 || height == 0 || width > 0x7FFFFFFF || height > 0x7FFFFFFF) {
+        throw std::invalid_argument("PNG images must be from 1 to 2^31 - 1 pixels wide and high"s);
+    }
+    if (rgba.size() != width * height * bytes_per_pixel) {
+        throw std::invalid_argument("PNG image data must have four bytes per pixel"s);
+    }
+
+    const std::size_t row_size = width * bytes_per_pixel;
+    std::string filtered;
+    filtered.reserve((row_size + 1) * height);
+    for (std::size_t y = 0; y < height; ++y) {
+        FilterRow(filtered, rgba.data() + y * row_size, y > 0 ? rgba.data() + (y - 1) * row_size : nullptr, row_size);
+    }
+
+    std::string header;
+    WriteBigEndian(header, static_cast<std::uint32_t>(width));
+    WriteBigEndian(header, static_cast<std::uint32_t>(height));
+    // 8 bits per channel, truecolor with alpha, deflate, adaptive filtering, no interlace
+    header += "\x08\x06\x00\x00\x00"sv;
+
+    std::string output = "\x89PNG\r\n\x1A\n"s;
+    WriteChunk(output, "IHDR"sv, header);
+    WriteChunk(output, "IDAT"sv, deflate::CompressZlib(filtered));
+    WriteChunk(output, "IEND"sv, {});
+    return output;
+}
+
+} // namespace png
\ No newline at end of file
@@ -0,0 +1,16 @@
+/// \file
+/// Encoding of RGBA images into PNG files
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace png {
+
+/// Encode \p width by \p height pixels of 8-bit red, green, blue and straight alpha, row by row from the top
+[[nodiscard]] std::string Encode(std::size_t width, std::size_t height, const std::vector<std::uint8_t>& rgba);
+
+} // namespace png
\ No newline at end of file
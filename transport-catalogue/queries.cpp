@@ -3,8 +3,9 @@
 #include "geo.h"
 #include "domain.h"
 #include "request_handler.h"
+#include "responses.h"
 
-#include <tuple>
+#include <algorithm>
 #include <unordered_map>
 #include <vector>
 
@@ -28,6 +29,30 @@ void PrintDriver::PrintObject(std::type_index type, const void* object) const {
     type_to_print_operation_.at(type)(GetOutput(), object);
 }
 
+void PrintDriver::Print(const StopInfoResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
+void PrintDriver::Print(const BusInfoResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
+void PrintDriver::Print(const MapResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
+void PrintDriver::Print(const RouteResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
+void PrintDriver::Print(const NearestStopsResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
+void PrintDriver::Print(const StopsInBoxResponse& response) const {
+    PrintObject(typeid(response), &response);
+}
+
 // Printer
 
 Printer::Printer(const PrintDriver& driver) noexcept
@@ -72,6 +97,10 @@ int ResponseQuery::GetId() const noexcept {
     return id_;
 }
 
+void ResponseQuery::ProcessAndPrint(Handler& handler, const into::Printer& printer) const {
+    Respond(handler, printer);
+}
+
 // NamedEntity
 
 NamedEntity::NamedEntity(std::string name)
@@ -93,11 +122,14 @@ public:
     }
 
     ~StopCreation() {
-        postponed_operation();
+        // Queries that have not been processed have nothing to finish
+        if (postponed_operation) {
+            postponed_operation();
+        }
     }
 
     void Process(Handler& handler) const override {
-        handler.AddStop(Stop{std::string(GetName()), coordinates_});
+        handler.AddStop(Stop{std::string(GetName()), coordinates_, {}});
 
         postponed_operation = [this, &handler] {
             for (const auto& [to_stop_name, distance] : distances_) {
@@ -133,7 +165,10 @@ public:
     }
 
     ~BusCreation() {
-        postponed_operation();
+        // Queries that have not been processed have nothing to finish
+        if (postponed_operation) {
+            postponed_operation();
+        }
     }
 
     void Process(Handler& handler) const override {
@@ -217,8 +252,8 @@ public:
             : ResponseQuery(id), NamedEntity(std::move(name)) {
     }
 
-    void ProcessAndPrint(Handler& handler, const into::Printer& printer) const override {
-        printer.Print(std::make_tuple(GetId(), GetName(), handler.GetStopInfo(GetName())));
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        printer.Print(into::StopInfoResponse{GetId(), GetName(), handler.GetStopInfo(GetName())});
     }
 
     class Factory : public QueryFactory {
@@ -237,8 +272,8 @@ public:
             : ResponseQuery(id), NamedEntity(std::move(name)) {
     }
 
-    void ProcessAndPrint(Handler& handler, const into::Printer& printer) const override {
-        printer.Print(std::make_tuple(GetId(), GetName(), handler.GetBusInfo(GetName())));
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        printer.Print(into::BusInfoResponse{GetId(), GetName(), handler.GetBusInfo(GetName())});
     }
 
     class Factory : public QueryFactory {
@@ -253,31 +288,80 @@ public:
 
 class MapRenderer : public ResponseQuery {
 public:
-    using ResponseQuery::ResponseQuery;
+    MapRenderer(int id, renderer::ImageFormat format, into::Encoding encoding) noexcept
+            : ResponseQuery(id)
+            , format_(format)
+            , encoding_(encoding) {
+    }
 
-    void ProcessAndPrint(Handler& handler, const into::Printer& printer) const override {
-        printer.Print(std::make_tuple(GetId(), handler.RenderMap()));
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto rendered_map = handler.GetRenderedMap(format_);
+        printer.Print(into::MapResponse{GetId(), *rendered_map, encoding_});
     }
 
     class Factory : public QueryFactory {
     public:
         [[nodiscard]] std::unique_ptr<Query> Construct(const from::Parser& parser) const override {
             return std::make_unique<MapRenderer>(
-                    parser.Get<int>("id"sv));
+                    parser.Get<int>("id"sv),
+                    parser.Get<renderer::ImageFormat>("format"sv),
+                    parser.Get<into::Encoding>("encoding"sv));
+        }
+    };
+
+private:
+    renderer::ImageFormat format_;
+    into::Encoding encoding_;
+};
+
+class MapViewport : public ResponseQuery {
+public:
+    MapViewport(int id, renderer::Viewport viewport, renderer::ImageFormat format, into::Encoding encoding) noexcept
+            : ResponseQuery(id)
+            , viewport_(viewport)
+            , format_(format)
+            , encoding_(encoding) {
+    }
+
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto rendered_viewport = handler.GetRenderedViewport(viewport_, format_);
+        printer.Print(into::MapResponse{GetId(), *rendered_viewport, encoding_});
+    }
+
+    class Factory : public QueryFactory {
+    public:
+        [[nodiscard]] std::unique_ptr<Query> Construct(const from::Parser& parser) const override {
+            return std::make_unique<MapViewport>(
+                    parser.Get<int>("id"sv),
+                    parser.Get<renderer::Viewport>("viewport"sv),
+                    parser.Get<renderer::ImageFormat>("format"sv),
+                    parser.Get<into::Encoding>("encoding"sv));
         }
     };
+
+private:
+    renderer::Viewport viewport_;
+    renderer::ImageFormat format_;
+    into::Encoding encoding_;
 };
 
 class Route : public ResponseQuery {
 public:
-    Route(int id, std::string from_stop, std::string to_stop)
+    Route(int id, std::string from_stop, std::string to_stop, bool with_map, into::Encoding encoding)
             : ResponseQuery(id)
             , from_stop_(std::move(from_stop))
-            , to_stop_(std::move(to_stop)) {
+            , to_stop_(std::move(to_stop))
+            , with_map_(with_map)
+            , encoding_(encoding) {
     }
 
-    void ProcessAndPrint(Handler& handler, const into::Printer& printer) const override {
-        printer.Print(std::make_tuple(GetId(), handler.GetRouteBetweenStops(from_stop_, to_stop_)));
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto route = handler.GetRouteBetweenStops(from_stop_, to_stop_);
+        std::optional<RenderedMap> itinerary;
+        if (with_map_ && route) {
+            itinerary.emplace(handler.RenderItinerary(route));
+        }
+        printer.Print(into::RouteResponse{GetId(), route, itinerary ? &*itinerary : nullptr, encoding_});
     }
 
     class Factory : public QueryFactory {
@@ -286,13 +370,108 @@ public:
             return std::make_unique<Route>(
                     parser.Get<int>("id"sv),
                     parser.Get<std::string>("from"sv),
-                    parser.Get<std::string>("to"sv));
+                    parser.Get<std::string>("to"sv),
+                    parser.Get<bool>("with_map"sv),
+                    parser.Get<into::Encoding>("encoding"sv));
         }
     };
 
 private:
     std::string from_stop_;
     std::string to_stop_;
+    bool with_map_;
+    into::Encoding encoding_;
+};
+
+class AddressRoute : public ResponseQuery {
+public:
+    AddressRoute(int id, geo::Coordinates from, geo::Coordinates to, bool with_map, into::Encoding encoding) noexcept
+            : ResponseQuery(id)
+            , from_(from)
+            , to_(to)
+            , with_map_(with_map)
+            , encoding_(encoding) {
+    }
+
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto route = handler.GetRouteBetweenPoints(from_, to_);
+        std::optional<RenderedMap> itinerary;
+        if (with_map_ && route) {
+            itinerary.emplace(handler.RenderItinerary(route, from_, to_));
+        }
+        printer.Print(into::RouteResponse{GetId(), route, itinerary ? &*itinerary : nullptr, encoding_});
+    }
+
+    class Factory : public QueryFactory {
+    public:
+        [[nodiscard]] std::unique_ptr<Query> Construct(const from::Parser& parser) const override {
+            return std::make_unique<AddressRoute>(
+                    parser.Get<int>("id"sv),
+                    parser.Get<geo::Coordinates>("from_point"sv),
+                    parser.Get<geo::Coordinates>("to_point"sv),
+                    parser.Get<bool>("with_map"sv),
+                    parser.Get<into::Encoding>("encoding"sv));
+        }
+    };
+
+private:
+    geo::Coordinates from_;
+    geo::Coordinates to_;
+    bool with_map_;
+    into::Encoding encoding_;
+};
+
+class NearestStops : public ResponseQuery {
+public:
+    NearestStops(int id, geo::Coordinates coordinates, int count)
+            : ResponseQuery(id)
+            , coordinates_(coordinates)
+            , count_(count) {
+    }
+
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto neighbours = handler.FindNearestStops(coordinates_, count_);
+        printer.Print(into::NearestStopsResponse{GetId(), neighbours});
+    }
+
+    class Factory : public QueryFactory {
+    public:
+        [[nodiscard]] std::unique_ptr<Query> Construct(const from::Parser& parser) const override {
+            return std::make_unique<NearestStops>(
+                    parser.Get<int>("id"sv),
+                    parser.Get<geo::Coordinates>("coordinates"sv),
+                    parser.Get<int>("count"sv));
+        }
+    };
+
+private:
+    geo::Coordinates coordinates_;
+    std::size_t count_;
+};
+
+class StopsInBox : public ResponseQuery {
+public:
+    StopsInBox(int id, spatial::BoundingBox box) noexcept
+            : ResponseQuery(id)
+            , box_(box) {
+    }
+
+    void Respond(const Handler& handler, const into::Printer& printer) const override {
+        const auto stops = handler.FindStopsInBox(box_);
+        printer.Print(into::StopsInBoxResponse{GetId(), stops});
+    }
+
+    class Factory : public QueryFactory {
+    public:
+        [[nodiscard]] std::unique_ptr<Query> Construct(const from::Parser& parser) const override {
+            return std::make_unique<StopsInBox>(
+                    parser.Get<int>("id"sv),
+                    parser.Get<spatial::BoundingBox>("box"sv));
+        }
+    };
+
+private:
+    spatial::BoundingBox box_;
 };
 
 // QueryFactory
@@ -306,7 +485,11 @@ const QueryFactory& QueryFactory::GetFactory(std::type_index index) {
     static const StopInfoQuery::Factory stop_info;
     static const BusInfoQuery::Factory bus_info;
     static const MapRenderer::Factory renderer;
+    static const MapViewport::Factory map_viewport;
     static const Route::Factory router;
+    static const AddressRoute::Factory address_router;
+    static const NearestStops::Factory nearest_stops;
+    static const StopsInBox::Factory stops_in_box;
 
     static const std::unordered_map<std::type_index, const QueryFactory&> factories = {
             {std::type_index(typeid(Stop)), stop_creation},
@@ -317,7 +500,11 @@ const QueryFactory& QueryFactory::GetFactory(std::type_index index) {
             {std::type_index(typeid(queries::Handler::StopInfo)), stop_info},
             {std::type_index(typeid(queries::Handler::BusInfo)), bus_info},
             {std::type_index(typeid(renderer::MapRenderer)), renderer},
+            {std::type_index(typeid(renderer::Viewport)), map_viewport},
             {std::type_index(typeid(router::TransportRouter)), router},
+            {std::type_index(typeid(geo::Coordinates)), address_router},
+            {std::type_index(typeid(spatial::Neighbour)), nearest_stops},
+            {std::type_index(typeid(spatial::BoundingBox)), stops_in_box},
     };
     return factories.at(index);
 }
@@ -351,6 +538,55 @@ void Parser::Result::ProcessResponseQueries(queries::Handler& handler, const int
     }
 }
 
+void Parser::Result::ProcessStreamQueries(queries::Handler& handler, const into::Printer& printer) {
+    // Serialization settings reload the base, and the other settings of the line then apply to the loaded one
+    const auto is_serialization_setup = [](const std::unique_ptr<queries::Query>& query) {
+        const auto& query_ref = *query;
+        return typeid(query_ref) == typeid(queries::SerializationSetup);
+    };
+    if (std::any_of(setup_queries_.begin(), setup_queries_.end(), is_serialization_setup)) {
+        for (const auto& query : setup_queries_) {
+            if (is_serialization_setup(query)) {
+                query->ProcessAndPrint(handler, printer);
+            }
+        }
+        handler.Deserialize();
+    }
+    for (const auto& query : setup_queries_) {
+        if (!is_serialization_setup(query)) {
+            query->ProcessAndPrint(handler, printer);
+        }
+    }
+
+    if (!modify_queries_.empty()) {
+        for (const auto& query : modify_queries_) {
+            query->ProcessAndPrint(handler, printer);
+        }
+        // Distances and buses are added when the queries are destroyed
+        modify_queries_.clear();
+        handler.UpdateRouter();
+    }
+
+    for (const auto& query : response_queries_) {
+        query->ProcessAndPrint(handler, printer);
+    }
+}
+
+void Parser::Result::ProcessReadQueries(const queries::Handler& handler, const into::Printer& printer) const {
+    using namespace std::string_literals;
+    if (!modify_queries_.empty()) {
+        throw std::invalid_argument("The base cannot be changed while it is in use"s);
+    }
+    if (!setup_queries_.empty()) {
+        throw std::invalid_argument("Settings cannot be changed while the base is in use"s);
+    }
+
+    // Only response queries are pushed into the list
+    for (const auto& query : response_queries_) {
+        static_cast<const queries::ResponseQuery&>(*query).Respond(handler, printer);
+    }
+}
+
 void Parser::Result::PushBack(std::unique_ptr<queries::Query>&& query_ptr) {
     using namespace std::string_view_literals;
 
@@ -362,7 +598,11 @@ void Parser::Result::PushBack(std::unique_ptr<queries::Query>&& query_ptr) {
     } else if (query_type == typeid(queries::StopInfoQuery)
             || query_type == typeid(queries::BusInfoQuery)
             || query_type == typeid(queries::MapRenderer)
-            || query_type == typeid(queries::Route)) {
+            || query_type == typeid(queries::MapViewport)
+            || query_type == typeid(queries::Route)
+            || query_type == typeid(queries::AddressRoute)
+            || query_type == typeid(queries::NearestStops)
+            || query_type == typeid(queries::StopsInBox)) {
         response_queries_.push_back(std::move(query_ptr));
     } else if (query_type == typeid(queries::MapRendererSetup)
             || query_type == typeid(queries::TransportRouterSetup)
@@ -374,6 +614,10 @@ void Parser::Result::PushBack(std::unique_ptr<queries::Query>&& query_ptr) {
     }
 }
 
+bool Parser::Result::HasSetupQueries() const noexcept {
+    return !setup_queries_.empty();
+}
+
 Parser::Result& Parser::GetResult() noexcept {
     return result_;
 }
@@ -14,6 +14,13 @@ namespace transport_catalogue {
 
 namespace into {
 
+struct StopInfoResponse;
+struct BusInfoResponse;
+struct MapResponse;
+struct RouteResponse;
+struct NearestStopsResponse;
+struct StopsInBoxResponse;
+
 class PrintDriver {
 public:
     using PrintOperation = std::function<void(std::ostream&, const void*)>;
@@ -28,6 +35,16 @@ public:
         type_to_print_operation_.emplace(std::type_index(typeid(T)), std::move(op));
     }
 
+    /// Responses of the built-in queries take one virtual call without looking up the operation.
+    /// By default they are printed with the operations registered for their types
+    virtual void Print(const StopInfoResponse& response) const;
+    virtual void Print(const BusInfoResponse& response) const;
+    virtual void Print(const MapResponse& response) const;
+    virtual void Print(const RouteResponse& response) const;
+    virtual void Print(const NearestStopsResponse& response) const;
+    virtual void Print(const StopsInBoxResponse& response) const;
+
+    /// Other types, e.g. responses of plugins, are printed with registered operations
     template<typename T>
     void Print(const T& value) const {
         const auto type = std::type_index(typeid(std::decay_t<T>));
@@ -88,7 +105,16 @@ public:
         void ProcessModifyQueries(queries::Handler& handler, const into::Printer& printer);
         void ProcessResponseQueries(queries::Handler& handler, const into::Printer& printer);
 
+        /// Answer queries with the resident base, which is deserialized again only if there are serialization
+        /// settings. Other settings apply to the resident base, and modify queries add to it before it is queried
+        void ProcessStreamQueries(queries::Handler& handler, const into::Printer& printer);
+
+        /// Answer response queries with a base shared between threads, which no query may change
+        void ProcessReadQueries(const queries::Handler& handler, const into::Printer& printer) const;
+
         void PushBack(std::unique_ptr<queries::Query>&& query_ptr);
+
+        [[nodiscard]] bool HasSetupQueries() const noexcept;
     private:
         using Queries = std::vector<std::unique_ptr<queries::Query>>;
 
@@ -134,6 +160,11 @@ class ResponseQuery : public Query {
 public:
     explicit ResponseQuery(int id) noexcept;
     [[nodiscard]] int GetId() const noexcept;
+
+    /// Response queries only read the base, so threads may answer them with a shared handler
+    virtual void Respond(const Handler& handler, const into::Printer& printer) const = 0;
+
+    void ProcessAndPrint(Handler& handler, const into::Printer& printer) const override;
 private:
     int id_;
 };
@@ -0,0 +1,467 @@
+#include "raster.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace raster {
+
+using namespace std::string_view_literals;
+
+namespace {
+
+/// Straight color components from 0 to 1
+struct Paint {
+    float red = 0.0f;
+    float green = 0.0f;
+    float blue = 0.0f;
+    float alpha = 1.0f;
+};
+
+constexpr Paint black{};
+
+[[nodiscard]] Paint FromRgb(std::uint8_t red, std::uint8_t green, std::uint8_t blue, double opacity = 1.0) noexcept {
+    return {red / 255.0f, green / 255.0f, blue / 255.0f, static_cast<float>(std::clamp(opacity, 0.0, 1.0))};
+}
+
+/// Colors that are not painted give std::nullopt. Unknown color names are painted black
+[[nodiscard]] std::optional<Paint> GetPaint(const svg::color::Color& color) {
+    struct Visitor {
+        std::optional<Paint> operator()(std::monostate) const {
+            return std::nullopt;
+        }
+
+        std::optional<Paint> operator()(const std::string& name) const {
+            static const std::unordered_map<std::string_view, svg::color::Rgb> named_colors{
+                    {"black"sv, {0, 0, 0}},         {"white"sv, {255, 255, 255}},   {"red"sv, {255, 0, 0}},
+                    {"green"sv, {0, 128, 0}},       {"blue"sv, {0, 0, 255}},        {"yellow"sv, {255, 255, 0}},
+                    {"orange"sv, {255, 165, 0}},    {"purple"sv, {128, 0, 128}},    {"brown"sv, {165, 42, 42}},
+                    {"gray"sv, {128, 128, 128}},    {"grey"sv, {128, 128, 128}},    {"silver"sv, {192, 192, 192}},
+                    {"pink"sv, {255, 192, 203}},    {"cyan"sv, {0, 255, 255}},      {"aqua"sv, {0, 255, 255}},
+                    {"magenta"sv, {255, 0, 255}},   {"fuchsia"sv, {255, 0, 255}},   {"lime"sv, {0, 255, 0}},
+                    {"navy"sv, {0, 0, 128}},        {"maroon"sv, {128, 0, 0}},      {"olive"sv, {128, 128, 0}},
+                    {"teal"sv, {0, 128, 128}},      {"gold"sv, {255, 215, 0}},      {"violet"sv, {238, 130, 238}},
+                    {"indigo"sv, {75, 0, 130}},     {"coral"sv, {255, 127, 80}},    {"salmon"sv, {250, 128, 114}},
+                    {"crimson"sv, {220, 20, 60}},   {"darkgreen"sv, {0, 100, 0}},   {"darkblue"sv, {0, 0, 139}},
+                    {"darkred"sv, {139, 0, 0}},     {"lightgray"sv, {211, 211, 211}}, {"darkgray"sv, {169, 169, 169}}};
+            if (name == "none"sv || name == "transparent"sv) {
+                return std::nullopt;
+            }
+            const auto iter = named_colors.find(name);
+            if (iter == named_colors.end()) {
+                return black;
+            }
+            return FromRgb(iter->second.red, iter->second.green, iter->second.blue);
+        }
+
+        std::optional<Paint> operator()(svg::color::Rgb rgb) const {
+            return FromRgb(rgb.red, rgb.green, rgb.blue);
+        }
+
+        std::optional<Paint> operator()(svg::color::Rgba rgba) const {
+            return FromRgb(rgba.red, rgba.green, rgba.blue, rgba.opacity);
+        }
+    };
+
+    return std::visit(Visitor{}, color);
+}
+
+/// Shapes are drawn by covering pixels and then painting the covered ones,
+/// so the overlapping parts of a shape, e.g. joins of a polyline, are blended once
+class Canvas final {
+public:
+    Canvas(std::size_t width, std::size_t height, double scale)
+            : width_(static_cast<long>(width))
+            , height_(static_cast<long>(height))
+            , scale_(scale)
+            , pixels_(width * height * 4, 0.0f)
+            , coverage_(width * height, 0.0f) {
+    }
+
+    [[nodiscard]] long GetWidth() const noexcept {
+        return width_;
+    }
+
+    [[nodiscard]] long GetHeight() const noexcept {
+        return height_;
+    }
+
+    /// Shapes are given in document units, which are scaled into pixels
+    [[nodiscard]] double Scale(double length) const noexcept {
+        return length * scale_;
+    }
+
+    [[nodiscard]] svg::Point Scale(svg::Point point) const noexcept {
+        return {point.x * scale_, point.y * scale_};
+    }
+
+    /// Coverage of a pixel is the largest coverage of the parts of the shape
+    void Cover(long x, long y, float coverage) {
+        if (x < 0 || y < 0 || x >= width_ || y >= height_ || coverage <= 0.0f) {
+            return;
+        }
+        const std::size_t index = static_cast<std::size_t>(y * width_ + x);
+        if (coverage_[index] == 0.0f) {
+            covered_.push_back(index);
+        }
+        coverage_[index] = std::max(coverage_[index], std::min(coverage, 1.0f));
+    }
+
+    /// Blend \p paint over the covered pixels and clear the coverage
+    void Fill(std::optional<Paint> paint) {
+        for (const std::size_t index : covered_) {
+            if (paint.has_value()) {
+                const float alpha = paint->alpha * coverage_[index];
+                float* pixel = &pixels_[index * 4];
+                // Pixels are kept premultiplied by alpha
+                pixel[0] = paint->red * alpha + pixel[0] * (1.0f - alpha);
+                pixel[1] = paint->green * alpha + pixel[1] * (1.0f - alpha);
+                pixel[2] = paint->blue * alpha + pixel[2] * (1.0f - alpha);
+                pixel[3] = alpha + pixel[3] * (1.0f - alpha);
+            }
+            coverage_[index] = 0.0f;
+        }
+        covered_.clear();
+    }
+
+    [[nodiscard]] Image ToImage() const {
+        Image image{static_cast<std::size_t>(width_), static_cast<std::size_t>(height_), {}};
+        image.rgba.resize(pixels_.size());
+        for (std::size_t i = 0; i < pixels_.size(); i += 4) {
+            const float alpha = pixels_[i + 3];
+            if (alpha <= 0.0f) {
+                continue;
+            }
+            for (std::size_t channel = 0; channel < 3; ++channel) {
+                image.rgba[i + channel] = ToByte(pixels_[i + channel] / alpha);
+            }
+            image.rgba[i + 3] = ToByte(alpha);
+        }
+        return image;
+    }
+
+private:
+    long width_;
+    long height_;
+    double scale_;
+    std::vector<float> pixels_;
+    std::vector<float> coverage_;
+    std::vector<std::size_t> covered_;
+
+    [[nodiscard]] static std::uint8_t ToByte(float value) noexcept {
+        return static_cast<std::uint8_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * 255.0f));
+    }
+};
+
+[[nodiscard]] double ComputeDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) noexcept {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length_squared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (length_squared > 0.0) {
+        t = std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0.0, 1.0);
+    }
+    return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+}
+
+/// Horizontal extent at \p y of the points closer than \p radius to the segment, i.e. of a capsule,
+/// which is the union of the discs at the ends and the rectangle along the segment
+[[nodiscard]] std::optional<std::pair<double, double>> GetCapsuleSpan(svg::Point from, svg::Point to,
+                                                                     double radius, double y) noexcept {
+    double left = std::numeric_limits<double>::infinity();
+    double right = -left;
+    for (const svg::Point end : {from, to}) {
+        const double dy = y - end.y;
+        if (std::abs(dy) <= radius) {
+            const double half_chord = std::sqrt(radius * radius - dy * dy);
+            left = std::min(left, end.x - half_chord);
+            right = std::max(right, end.x + half_chord);
+        }
+    }
+
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length_squared = dx * dx + dy * dy;
+    if (length_squared > 0.0) {
+        double low = -std::numeric_limits<double>::infinity();
+        double high = -low;
+        // Intersect the line with the strip min <= coefficient * x + constant <= max
+        const auto clip = [&low, &high](double coefficient, double constant, double min, double max) {
+            if (coefficient == 0.0) {
+                if (constant < min || constant > max) {
+                    low = std::numeric_limits<double>::infinity();
+                }
+                return;
+            }
+            const double first = (min - constant) / coefficient;
+            const double second = (max - constant) / coefficient;
+            low = std::max(low, std::min(first, second));
+            high = std::min(high, std::max(first, second));
+        };
+        // Projection onto the segment and distance to its line
+        clip(dx, (y - from.y) * dy - from.x * dx, 0.0, length_squared);
+        const double bound = radius * std::sqrt(length_squared);
+        clip(dy, -(y - from.y) * dx - from.x * dy, -bound, bound);
+        if (low <= high) {
+            left = std::min(left, low);
+            right = std::max(right, high);
+        }
+    }
+
+    if (left > right) {
+        return std::nullopt;
+    }
+    return std::pair{left, right};
+}
+
+/// Pixel centers are sampled, and coverage falls linearly over a pixel across the edge
+void CoverCapsule(Canvas& canvas, svg::Point from, svg::Point to, double radius) {
+    const double outer_radius = radius + 0.5;
+    const long first_row = std::max(0L, static_cast<long>(std::floor(std::min(from.y, to.y) - outer_radius)));
+    const long last_row = std::min(canvas.GetHeight() - 1,
+                                   static_cast<long>(std::ceil(std::max(from.y, to.y) + outer_radius)));
+    for (long row = first_row; row <= last_row; ++row) {
+        const double y = row + 0.5;
+        const auto span = GetCapsuleSpan(from, to, outer_radius, y);
+        if (!span.has_value()) {
+            continue;
+        }
+        const long first_column = std::max(0L, static_cast<long>(std::ceil(span->first - 0.5)));
+        const long last_column = std::min(canvas.GetWidth() - 1, static_cast<long>(std::floor(span->second - 0.5)));
+        for (long column = first_column; column <= last_column; ++column) {
+            const double distance = ComputeDistanceToSegment({column + 0.5, y}, from, to);
+            canvas.Cover(column, row, static_cast<float>(outer_radius - distance));
+        }
+    }
+}
+
+void CoverRing(Canvas& canvas, svg::Point center, double radius, double half_width) {
+    const double outer_radius = radius + half_width + 0.5;
+    const long first_row = std::max(0L, static_cast<long>(std::floor(center.y - outer_radius)));
+    const long last_row = std::min(canvas.GetHeight() - 1, static_cast<long>(std::ceil(center.y + outer_radius)));
+    for (long row = first_row; row <= last_row; ++row) {
+        const double y = row + 0.5;
+        const auto span = GetCapsuleSpan(center, center, outer_radius, y);
+        if (!span.has_value()) {
+            continue;
+        }
+        const long first_column = std::max(0L, static_cast<long>(std::ceil(span->first - 0.5)));
+        const long last_column = std::min(canvas.GetWidth() - 1, static_cast<long>(std::floor(span->second - 0.5)));
+        for (long column = first_column; column <= last_column; ++column) {
+            const double distance = std::hypot(column + 0.5 - center.x, y - center.y);
+            canvas.Cover(column, row, static_cast<float>(half_width + 0.5 - std::abs(distance - radius)));
+        }
+    }
+}
+
+void CoverRectangle(Canvas& canvas, long left, long top, long right, long bottom) {
+    for (long row = std::max(0L, top); row < std::min(canvas.GetHeight(), bottom); ++row) {
+        for (long column = std::max(0L, left); column < std::min(canvas.GetWidth(), right); ++column) {
+            canvas.Cover(column, row, 1.0f);
+        }
+    }
+}
+
+// Bitmap font
+
+constexpr int glyph_width = 5;
+constexpr int glyph_height = 7;
+/// Glyphs and the space after them in dots
+constexpr int glyph_advance = 6;
+/// Dots per font size, so the glyphs are about as high as capital letters of proportional fonts
+constexpr double dots_per_em = 10.0;
+
+/// Columns of dots from the left, the lowest bit of a column is its top dot
+using Glyph = std::array<std::uint8_t, glyph_width>;
+
+constexpr std::array<Glyph, 95> ascii_glyphs{{
+        {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+        {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+        {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00},
+        {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x08, 0x2A, 0x1C, 0x2A, 0x08}, {0x08, 0x08, 0x3E, 0x08, 0x08},
+        {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+        {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00},
+        {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4B, 0x31}, {0x18, 0x14, 0x12, 0x7F, 0x10},
+        {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+        {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x36, 0x36, 0x00, 0x00},
+        {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+        {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3E},
+        {0x7E, 0x11, 0x11, 0x11, 0x7E}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22},
+        {0x7F, 0x41, 0x41, 0x22, 0x1C}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01},
+        {0x3E, 0x41, 0x49, 0x49, 0x7A}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00},
+        {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40},
+        {0x7F, 0x02, 0x0C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E},
+        {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46},
+        {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7F, 0x01, 0x01}, {0x3F, 0x40, 0x40, 0x40, 0x3F},
+        {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63},
+        {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x00},
+        {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7F, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+        {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+        {0x7F, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7F},
+        {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7E, 0x09, 0x01, 0x02}, {0x0C, 0x52, 0x52, 0x52, 0x3E},
+        {0x7F, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7D, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3D, 0x00},
+        {0x7F, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7F, 0x40, 0x00}, {0x7C, 0x04, 0x18, 0x04, 0x78},
+        {0x7C, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7C, 0x14, 0x14, 0x14, 0x08},
+        {0x08, 0x14, 0x14, 0x18, 0x7C}, {0x7C, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+        {0x04, 0x3F, 0x44, 0x40, 0x20}, {0x3C, 0x40, 0x40, 0x20, 0x7C}, {0x1C, 0x20, 0x40, 0x20, 0x1C},
+        {0x3C, 0x40, 0x30, 0x40, 0x3C}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0C, 0x50, 0x50, 0x50, 0x3C},
+        {0x44, 0x64, 0x54, 0x4C, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7F, 0x00, 0x00},
+        {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}}};
+
+constexpr Glyph missing_glyph{0x7F, 0x41, 0x41, 0x41, 0x7F};
+
+[[nodiscard]] const Glyph& GetGlyph(char32_t code_point) {
+    static const std::unordered_map<char32_t, Glyph> cyrillic_glyphs{
+            {U'Б', {0x7F, 0x49, 0x49, 0x49, 0x31}}, {U'Г', {0x7F, 0x01, 0x01, 0x01, 0x01}}, {U'Д', {0x60, 0x3E, 0x21, 0x3F, 0x60}},
+            {U'Ж', {0x63, 0x14, 0x7F, 0x14, 0x63}}, {U'З', {0x22, 0x41, 0x49, 0x49, 0x36}}, {U'И', {0x7F, 0x10, 0x08, 0x04, 0x7F}},
+            {U'Й', {0x7E, 0x10, 0x09, 0x04, 0x7E}}, {U'Л', {0x40, 0x3E, 0x01, 0x01, 0x7F}}, {U'П', {0x7F, 0x01, 0x01, 0x01, 0x7F}},
+            {U'Ф', {0x0C, 0x12, 0x7F, 0x12, 0x0C}}, {U'Ц', {0x3F, 0x20, 0x20, 0x3F, 0x60}}, {U'Ч', {0x07, 0x08, 0x08, 0x08, 0x7F}},
+            {U'Ш', {0x7F, 0x40, 0x7F, 0x40, 0x7F}}, {U'Щ', {0x3F, 0x20, 0x3F, 0x20, 0x7F}}, {U'Ъ', {0x01, 0x7F, 0x48, 0x48, 0x30}},
+            {U'Ы', {0x7F, 0x48, 0x78, 0x00, 0x7F}}, {U'Ь', {0x7F, 0x48, 0x48, 0x48, 0x30}}, {U'Э', {0x22, 0x41, 0x49, 0x49, 0x3E}},
+            {U'Ю', {0x7F, 0x08, 0x3E, 0x41, 0x3E}}, {U'Я', {0x46, 0x29, 0x19, 0x09, 0x7F}}, {U'б', {0x3C, 0x4A, 0x49, 0x49, 0x31}},
+            {U'в', {0x7C, 0x54, 0x54, 0x54, 0x28}}, {U'г', {0x7C, 0x04, 0x04, 0x04, 0x04}}, {U'д', {0x60, 0x38, 0x24, 0x3C, 0x60}},
+            {U'ж', {0x44, 0x28, 0x7C, 0x28, 0x44}}, {U'з', {0x28, 0x44, 0x54, 0x54, 0x28}}, {U'и', {0x7C, 0x20, 0x10, 0x08, 0x7C}},
+            {U'й', {0x7C, 0x20, 0x12, 0x08, 0x7C}}, {U'л', {0x40, 0x38, 0x04, 0x04, 0x7C}}, {U'м', {0x7C, 0x08, 0x10, 0x08, 0x7C}},
+            {U'н', {0x7C, 0x10, 0x10, 0x10, 0x7C}}, {U'п', {0x7C, 0x04, 0x04, 0x04, 0x7C}}, {U'т', {0x04, 0x04, 0x7C, 0x04, 0x04}},
+            {U'ф', {0x18, 0x24, 0x7F, 0x24, 0x18}}, {U'ц', {0x3C, 0x20, 0x20, 0x3C, 0x60}}, {U'ч', {0x0C, 0x10, 0x10, 0x10, 0x7C}},
+            {U'ш', {0x7C, 0x40, 0x7C, 0x40, 0x7C}}, {U'щ', {0x3C, 0x20, 0x3C, 0x20, 0x7C}}, {U'ъ', {0x04, 0x7C, 0x48, 0x48, 0x30}},
+            {U'ы', {0x7C, 0x48, 0x78, 0x00, 0x7C}}, {U'ь', {0x7C, 0x48, 0x48, 0x48, 0x30}}, {U'э', {0x28, 0x44, 0x54, 0x54, 0x38}},
+            {U'ю', {0x7C, 0x10, 0x38, 0x44, 0x38}}, {U'я', {0x48, 0x34, 0x14, 0x14, 0x7C}}};
+    // Other Cyrillic letters look like Latin ones
+    static const std::unordered_map<char32_t, char> lookalikes{
+            {U'А', 'A'}, {U'В', 'B'}, {U'Е', 'E'}, {U'Ё', 'E'}, {U'К', 'K'}, {U'М', 'M'}, {U'Н', 'H'},
+            {U'О', 'O'}, {U'Р', 'P'}, {U'С', 'C'}, {U'Т', 'T'}, {U'У', 'Y'}, {U'Х', 'X'}, {U'а', 'a'},
+            {U'е', 'e'}, {U'ё', 'e'}, {U'к', 'k'}, {U'о', 'o'}, {U'р', 'p'}, {U'с', 'c'}, {U'у', 'y'},
+            {U'х', 'x'}};
+    if (const auto iter = cyrillic_glyphs.find(code_point); iter != cyrillic_glyphs.end()) {
+        return iter->second;
+    }
+    if (const auto iter = lookalikes.find(code_point); iter != lookalikes.end()) {
+        code_point = static_cast<char32_t>(iter->second);
+    }
+    if (code_point >= U' ' && code_point <= U'~') {
+        return ascii_glyphs[code_point - U' '];
+    }
+    return missing_glyph;
+}
+
+/// Invalid bytes are decoded as themselves, so they are drawn as missing glyphs
+[[nodiscard]] std::vector<char32_t> DecodeUtf8(std::string_view text) {
+    std::vector<char32_t> code_points;
+    code_points.reserve(text.size());
+    for (std::size_t i = 0; i < text.size();) {
+        const auto lead = static_cast<unsigned char>(text[i]);
+        std::size_t length = 1;
+        char32_t code_point = lead;
+        if (lead >= 0xF0) {
+            length = 4;
+            code_point = lead & 0x07;
+        } else if (lead >= 0xE0) {
+            length = 3;
+            code_point = lead & 0x0F;
+        } else if (lead >= 0xC0) {
+            length = 2;
+            code_point = lead & 0x1F;
+        }
+        if (length > 1 && i + length <= text.size()) {
+            for (std::size_t j = 1; j < length; ++j) {
+                code_point = (code_point << 6) | (static_cast<unsigned char>(text[i + j]) & 0x3F);
+            }
+        } else {
+            length = 1;
+            code_point = lead;
+        }
+        code_points.push_back(code_point);
+        i += length;
+    }
+    return code_points;
+}
+
+/// Glyphs are drawn crisp, with whole pixels per dot, each dot grown by \p grow pixels on every side
+void CoverText(Canvas& canvas, const svg::Text& text, long grow) {
+    const long dot_size = std::max(1L, std::lround(canvas.Scale(text.GetFontSize()) / dots_per_em));
+    // Bold dots overlap the next column
+    const long dot_width = text.GetFontWeight() == "bold"sv ? dot_size + (dot_size + 1) / 2 : dot_size;
+
+    long left = std::lround(canvas.Scale(text.GetPosition().x + text.GetOffset().x));
+    const long top = std::lround(canvas.Scale(text.GetPosition().y + text.GetOffset().y)) - glyph_height * dot_size;
+    for (const char32_t code_point : DecodeUtf8(text.GetData())) {
+        const Glyph& glyph = GetGlyph(code_point);
+        for (int column = 0; column < glyph_width; ++column) {
+            for (int row = 0; row < glyph_height; ++row) {
+                if (((glyph[column] >> row) & 1) == 0) {
+                    continue;
+                }
+                const long dot_left = left + column * dot_size;
+                const long dot_top = top + row * dot_size;
+                CoverRectangle(canvas, dot_left - grow, dot_top - grow,
+                               dot_left + dot_width + grow, dot_top + dot_size + grow);
+            }
+        }
+        left += glyph_advance * dot_size;
+    }
+}
+
+// Shapes
+
+void Draw(Canvas& canvas, const svg::Circle& circle) {
+    const svg::Point center = canvas.Scale(circle.GetCenter());
+    const double radius = canvas.Scale(circle.GetRadius());
+    CoverCapsule(canvas, center, center, radius);
+    canvas.Fill(circle.GetFillColor().has_value() ? GetPaint(*circle.GetFillColor()) : black);
+
+    if (circle.GetStrokeColor().has_value() && circle.GetStrokeWidth().has_value()) {
+        CoverRing(canvas, center, radius, canvas.Scale(*circle.GetStrokeWidth()) / 2.0);
+        canvas.Fill(GetPaint(*circle.GetStrokeColor()));
+    }
+}
+
+void Draw(Canvas& canvas, const svg::Polyline& polyline) {
+    const auto& points = polyline.GetPoints();
+    if (points.empty() || !polyline.GetStrokeColor().has_value()) {
+        return;
+    }
+    const auto paint = GetPaint(*polyline.GetStrokeColor());
+    if (!paint.has_value()) {
+        return;
+    }
+
+    const double radius = canvas.Scale(polyline.GetStrokeWidth().value_or(1.0)) / 2.0;
+    svg::Point from = canvas.Scale(points.front());
+    CoverCapsule(canvas, from, from, radius);
+    for (std::size_t i = 1; i < points.size(); ++i) {
+        const svg::Point to = canvas.Scale(points[i]);
+        CoverCapsule(canvas, from, to, radius);
+        from = to;
+    }
+    canvas.Fill(paint);
+}
+
+/// The stroke is drawn under the fill, so it outlines the glyphs without covering them
+void Draw(Canvas& canvas, const svg::Text& text) {
+    if (text.GetStrokeColor().has_value()) {
+        const long grow = std::max(1L, std::lround(canvas.Scale(text.GetStrokeWidth().value_or(1.0)) / 2.0));
+        CoverText(canvas, text, grow);
+        canvas.Fill(GetPaint(*text.GetStrokeColor()));
+    }
+    CoverText(canvas, text, 0);
+    canvas.Fill(text.GetFillColor().has_value() ? GetPaint(*text.GetFillColor()) : black);
+}
+
+} // namespace
+
+Image Rasterize(const svg::Document& document, std::size_t width, std::size_t height, double scale) {
+    Canvas canvas(width, height, scale);
+    document.ForEachShape([&canvas](const auto& shape) {
+        Draw(canvas, shape);
+    });
+    return canvas.ToImage();
+}
+
+} // namespace raster
\ No newline at end of file
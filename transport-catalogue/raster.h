@@ -0,0 +1,28 @@
+/// \file
+/// Software rasterization of SVG documents, e.g. into PNG tiles for clients that can't draw large SVGs
+
+#pragma once
+
+#include "svg.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace raster {
+
+/// Pixels of 8-bit red, green, blue and straight alpha, row by row from the top
+struct Image {
+    std::size_t width = 0;
+    std::size_t height = 0;
+    std::vector<std::uint8_t> rgba;
+};
+
+/// Draw the circles, polylines and texts of \p document with anti-aliasing on a transparent canvas.
+/// Polylines are only stroked, with round caps and joins. Texts use a built-in 5x7 bitmap font
+/// of ASCII and Cyrillic glyphs; other characters are drawn as boxes.
+/// Coordinates and sizes of \p document are multiplied by \p scale, e.g. to draw a large canvas into a small tile
+[[nodiscard]] Image Rasterize(const svg::Document& document, std::size_t width, std::size_t height,
+                              double scale = 1.0);
+
+} // namespace raster
\ No newline at end of file
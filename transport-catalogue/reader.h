@@ -19,4 +19,11 @@ void ProcessQueries(From from, queries::Handler& handler) {
     parse_result.ProcessModifyQueries(handler, VoidPrintDriver::GetDriver());
 }
 
+/// Apply settings and deserialize the base they refer to without serializing anything
+template<typename From>
+void LoadBase(From from, queries::Handler& handler) {
+    auto parse_result = ReadQueries(from);
+    parse_result.ProcessStreamQueries(handler, VoidPrintDriver::GetDriver());
+}
+
 } // namespace transport_catalogue::from
\ No newline at end of file
@@ -1,9 +1,102 @@
 #include "request_handler.h"
+#include "thread_pool.h"
+#include "raster.h"
+#include "png.h"
+#include "deflate.h"
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
 
 namespace transport_catalogue::queries {
 
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace {
+
+[[nodiscard]] std::string EncodeBase64(std::string_view data) {
+    static constexpr std::string_view alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"sv;
+
+    std::string encoded;
+    encoded.reserve((data.size() + 2) / 3 * 4);
+    for (std::size_t i = 0; i < data.size(); i += 3) {
+        const std::size_t count = std::min<std::size_t>(3, data.size() - i);
+        std::uint32_t group = 0;
+        for (std::size_t j = 0; j < 3; ++j) {
+            group = (group << 8) | (j < count ? static_cast<unsigned char>(data[i + j]) : 0);
+        }
+        for (std::size_t j = 0; j < 4; ++j) {
+            encoded.push_back(j <= count ? alphabet[(group >> (18 - 6 * j)) & 0x3F] : '=');
+        }
+    }
+    return encoded;
+}
+
+} // namespace
+
+RenderedMap::RenderedMap(const svg::Document& document, thread_pool::ThreadPool* pool)
+        : json_image(std::invoke([&document, pool] {
+            // Rendering numbers is the most expensive part, so parts of large documents are rendered concurrently
+            const std::size_t thread_count = (pool != nullptr) ? pool->GetThreadCount() : 1;
+            const std::size_t part_count = thread_count < 2
+                    ? 1
+                    : std::clamp<std::size_t>(document.GetObjectCount() / min_part_object_count, 1, thread_count * 2);
+
+            std::vector<std::string> parts(part_count);
+            const auto render_part = [&document, &parts](std::size_t index) {
+                json::EscapingBuffer buffer(parts[index]);
+                std::ostream output(&buffer);
+                document.RenderPart(output, index, parts.size());
+            };
+            if (part_count == 1) {
+                render_part(0);
+                return json::EscapedString::FromEscaped(std::move(parts.front()));
+            }
+
+            pool->ParallelFor(part_count, render_part);
+
+            std::string escaped;
+            escaped.reserve(std::accumulate(parts.begin(), parts.end(), std::size_t(0),
+                                            [](std::size_t size, const std::string& part) {
+                                                return size + part.size();
+                                            }));
+            for (const auto& part : parts) {
+                escaped += part;
+            }
+            return json::EscapedString::FromEscaped(std::move(escaped));
+        })) {
+}
+
+RenderedMap::RenderedMap(json::EscapedString json_image, bool is_png) noexcept
+        : json_image(std::move(json_image))
+        , is_png(is_png) {
+}
+
+RenderedMap RenderedMap::FromPng(std::string_view png) {
+    // Base64 has no characters that JSON escapes
+    return RenderedMap(json::EscapedString::FromEscaped(EncodeBase64(png)), true);
+}
+
+const json::EscapedString* RenderedMap::GetEncoded(into::Encoding encoding) const {
+    if (encoding == into::Encoding::Identity || is_png) {
+        return nullptr;
+    }
+
+    auto& encoded = (encoding == into::Encoding::Gzip) ? encoded_images_->gzip : encoded_images_->deflate;
+    std::call_once(encoded.compressed, [this, encoding, &encoded] {
+        // Maps are rendered straight into the escaped form, so the SVG itself exists only while it is compressed
+        const std::string svg = json::Unescape(json_image.GetEscaped());
+        encoded.image = json::EscapedString::FromEscaped(EncodeBase64(
+                (encoding == into::Encoding::Gzip) ? deflate::CompressGzip(svg) : deflate::CompressZlib(svg)));
+    });
+    return &*encoded.image;
+}
+
 Handler::Handler(TransportCatalogue& database,
                  renderer::MapRenderer& renderer,
                  router::TransportRouter& router) noexcept
@@ -24,10 +117,12 @@ bool Handler::Result::IsIncorrectMode() const noexcept {
 
 void Handler::AddStop(Stop stop) {
     database_.AddStop(std::move(stop));
+    ResetRenderedMaps();
 }
 
 void Handler::AddBus(Bus bus) {
     database_.AddBus(std::move(bus));
+    ResetRenderedMaps();
 }
 
 void Handler::SetDistanceBetweenStops(std::string_view from, std::string_view to, geo::Meter distance) {
@@ -63,10 +158,20 @@ std::optional<const Handler::StopInfo*> Handler::GetStopInfo(std::string_view st
     return database_.GetStopInfo(stop_name);
 }
 
+std::vector<spatial::Neighbour> Handler::FindNearestStops(geo::Coordinates point, std::size_t count) const {
+    return database_.FindNearestStops(point, count);
+}
+
+std::vector<StopPtr> Handler::FindStopsInBox(spatial::BoundingBox box) const {
+    return database_.FindStopsInBox(box);
+}
+
 // Map Renderer methods adapters
 
 void Handler::InitializeMapRenderer(renderer::Settings settings) {
     renderer_.Initialize(std::move(settings));
+    ResetRenderedMaps();
+    ResetMapFragments();
 }
 
 svg::Document Handler::RenderMap() const {
@@ -74,6 +179,149 @@ svg::Document Handler::RenderMap() const {
     return renderer_.Render(bus_range.begin(), bus_range.end());
 }
 
+std::shared_ptr<const RenderedMap> Handler::GetRenderedMap(renderer::ImageFormat format) const {
+    auto& rendered_map = format == renderer::ImageFormat::Png ? rendered_png_map_ : rendered_map_;
+    {
+        const std::lock_guard lock(rendered_map_mutex_);
+        if (rendered_map) {
+            return rendered_map;
+        }
+    }
+
+    // Maps are rendered without blocking viewports and tiles; a map rendered by several threads at once is cached
+    // by the first of them
+    std::shared_ptr<const RenderedMap> new_rendered_map;
+    if (format == renderer::ImageFormat::Png) {
+        new_rendered_map = MakeRenderedMap(RenderMap(), format);
+    } else {
+        // The document refers to the fragments, so they are not updated by others until it is rendered
+        const std::lock_guard fragments_lock(map_fragments_mutex_);
+        {
+            const std::lock_guard lock(rendered_map_mutex_);
+            if (rendered_map) {
+                return rendered_map;
+            }
+        }
+        const auto bus_range = database_.GetAllBuses();
+        new_rendered_map = MakeRenderedMap(renderer_.Render(bus_range.begin(), bus_range.end(), map_fragments_),
+                                           format);
+    }
+
+    const std::lock_guard lock(rendered_map_mutex_);
+    if (!rendered_map) {
+        rendered_map = std::move(new_rendered_map);
+    }
+    return rendered_map;
+}
+
+std::shared_ptr<const RenderedMap> Handler::GetRenderedViewport(const renderer::Viewport& viewport,
+                                                                renderer::ImageFormat format) const {
+    const auto* tile = std::get_if<renderer::Tile>(&viewport);
+    auto& rendered_tiles = format == renderer::ImageFormat::Png ? rendered_png_tiles_ : rendered_tiles_;
+
+    if (tile != nullptr) {
+        const std::lock_guard lock(rendered_map_mutex_);
+        if (format == renderer::ImageFormat::Png) {
+            if (const auto iter = stored_png_tiles_.find(*tile); iter != stored_png_tiles_.end()) {
+                return iter->second;
+            }
+        }
+        if (const auto iter = rendered_tiles.find(*tile); iter != rendered_tiles.end()) {
+            return iter->second;
+        }
+    }
+    const auto selector = GetViewportSelector();
+
+    // Viewports are rendered concurrently; a tile rendered by several threads at once is cached by the first of them
+    auto rendered_viewport = MakeRenderedMap(RenderViewport(*selector, viewport), format,
+                                             tile != nullptr ? GetPngTileScale() : 1.0);
+
+    if (tile != nullptr) {
+        const std::lock_guard lock(rendered_map_mutex_);
+        // The base might have changed while rendering
+        if (viewport_selector_ == selector) {
+            if (rendered_tiles.size() >= max_rendered_tile_count) {
+                rendered_tiles.clear();
+            }
+            return rendered_tiles.emplace(*tile, std::move(rendered_viewport)).first->second;
+        }
+    }
+    return rendered_viewport;
+}
+
+thread_pool::ThreadPool* Handler::GetRenderPool(const svg::Document& document) const {
+    // Workers of other pools, e.g. of the server, already render many maps at once
+    if (document.GetObjectCount() < RenderedMap::min_part_object_count || thread_pool::ThreadPool::IsWorkerThread()) {
+        return nullptr;
+    }
+    std::call_once(render_pool_created_, [this] {
+        render_pool_ = std::make_unique<thread_pool::ThreadPool>();
+    });
+    return render_pool_.get();
+}
+
+svg::Document Handler::RenderViewport(const renderer::ViewportSelector& selector,
+                                      const renderer::Viewport& viewport) const {
+    const auto box = selector.GetBox(viewport);
+    return renderer_.RenderViewport(selector.Select(box, renderer_.GetSimplificationTolerance(box)));
+}
+
+std::string Handler::RenderPng(const svg::Document& document, double scale) const {
+    const renderer::Settings& settings = renderer_.GetSettings().value();
+    const auto image = raster::Rasterize(
+            document,
+            std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(settings.width * scale))),
+            std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(settings.height * scale))),
+            scale);
+    return png::Encode(image.width, image.height, image.rgba);
+}
+
+double Handler::GetPngTileScale() const {
+    const renderer::Settings& settings = renderer_.GetSettings().value();
+    const double canvas_size = std::max(settings.width, settings.height);
+    return canvas_size > 0.0 ? renderer::Tile::png_size / canvas_size : 1.0;
+}
+
+std::shared_ptr<const RenderedMap> Handler::MakeRenderedMap(const svg::Document& document,
+                                                            renderer::ImageFormat format, double png_scale) const {
+    if (format == renderer::ImageFormat::Png) {
+        return std::make_shared<const RenderedMap>(RenderedMap::FromPng(RenderPng(document, png_scale)));
+    }
+    return std::make_shared<const RenderedMap>(document, GetRenderPool(document));
+}
+
+std::shared_ptr<const renderer::ViewportSelector> Handler::GetViewportSelector() const {
+    const std::lock_guard lock(rendered_map_mutex_);
+    if (!viewport_selector_) {
+        viewport_selector_ = std::make_shared<const renderer::ViewportSelector>(database_);
+    }
+    return viewport_selector_;
+}
+
+std::shared_ptr<const renderer::MapLayout> Handler::GetMapLayout() const {
+    const std::lock_guard lock(rendered_map_mutex_);
+    if (!map_layout_) {
+        map_layout_ = std::make_shared<const renderer::MapLayout>(database_);
+    }
+    return map_layout_;
+}
+
+void Handler::ResetRenderedMaps(std::shared_ptr<const RenderedMap> rendered_map) {
+    const std::lock_guard lock(rendered_map_mutex_);
+    rendered_map_ = std::move(rendered_map);
+    rendered_png_map_.reset();
+    viewport_selector_.reset();
+    map_layout_.reset();
+    rendered_tiles_.clear();
+    rendered_png_tiles_.clear();
+    stored_png_tiles_.clear();
+}
+
+void Handler::ResetMapFragments() {
+    const std::lock_guard lock(map_fragments_mutex_);
+    map_fragments_ = {};
+}
+
 // Transport Route methods adapters
 
 void Handler::InitializeRouterSettings(router::Settings settings) {
@@ -84,11 +332,31 @@ void Handler::InitializeRouter() {
     router_.InitializeRouter(database_);
 }
 
-Handler::RouteResult Handler::GetRouteBetweenStops(std::string_view from, std::string_view to) {
-    if (!router_.IsInitialized()) {
+void Handler::UpdateRouter() {
+    if (router_.IsInitialized()) {
         router_.InitializeRouter(database_);
     }
-    return router_.GetRouteBetweenStops(FindStopBy(from).value(), FindStopBy(to).value());
+}
+
+Handler::RouteResult Handler::GetRouteBetweenStops(std::string_view from, std::string_view to) const {
+    const router::TransportRouter& router = router_;
+    return router.GetRouteBetweenStops(FindStopBy(from).value(), FindStopBy(to).value());
+}
+
+Handler::RouteResult Handler::GetRouteBetweenPoints(geo::Coordinates from, geo::Coordinates to) const {
+    const router::TransportRouter& router = router_;
+    if (!router.IsInitialized()) {
+        throw std::logic_error("Router must be initialized before a route computation"s);
+    }
+    const auto walking_stop_count = router.GetSettings()->walking_stop_count;
+    return router.GetRouteBetweenPoints(from, database_.FindNearestStops(from, walking_stop_count),
+                                         to, database_.FindNearestStops(to, walking_stop_count));
+}
+
+RenderedMap Handler::RenderItinerary(const RouteResult& route,
+                                     std::optional<geo::Coordinates> from, std::optional<geo::Coordinates> to) const {
+    const auto document = renderer_.RenderViewport(GetMapLayout()->SelectItinerary(route, from, to));
+    return RenderedMap(document, GetRenderPool(document));
 }
 
 // Serialization methods adapters
@@ -97,19 +365,65 @@ void Handler::InitializeSerialization(serialization::Settings settings) {
     serializer_.Initialize(std::move(settings));
 }
 
+const std::optional<serialization::Settings>& Handler::GetSerializationSettings() const noexcept {
+    return serializer_.GetSettings();
+}
+
 void Handler::Serialize() {
-    serializer_.Serialize({database_, renderer_.GetSettings(), router_});
+    thread_pool::ThreadPool pool;
+    database_.PrecomputeStatistics(pool);
+    // The map is rendered beforehand, so that the first map query of a loaded base is as fast as the others
+    std::optional<std::string> svg;
+    if (renderer_.GetSettings().has_value()) {
+        std::ostringstream output;
+        RenderMap().Render(output);
+        svg = std::move(output).str();
+    }
+
+    std::vector<serialization::PngTile> png_tiles;
+    const auto& serialization_settings = serializer_.GetSettings();
+    if (renderer_.GetSettings().has_value() && serialization_settings.has_value()
+            && serialization_settings->png_tiles_max_zoom.has_value()) {
+        for (int zoom = 0; zoom <= *serialization_settings->png_tiles_max_zoom; ++zoom) {
+            for (int y = 0; y < (1 << zoom); ++y) {
+                for (int x = 0; x < (1 << zoom); ++x) {
+                    png_tiles.push_back({{zoom, x, y}, {}});
+                }
+            }
+        }
+        const renderer::ViewportSelector selector(database_);
+        const double scale = GetPngTileScale();
+        pool.ParallelFor(png_tiles.size(), [this, &selector, &png_tiles, scale](std::size_t index) {
+            auto& [tile, png] = png_tiles[index];
+            png = RenderPng(RenderViewport(selector, tile), scale);
+        });
+    }
+
+    serializer_.Serialize({database_, renderer_.GetSettings(), router_, svg, std::move(png_tiles)});
 }
 
 void Handler::Deserialize() {
     auto received_data = serializer_.Deserialize();
     database_ = std::move(received_data.database);
+    ResetMapFragments();
     if (received_data.render_settings.has_value()) {
         InitializeMapRenderer(std::move(received_data.render_settings.value()));
     }
     if (received_data.transport_router.has_value()) {
         router_.ReplaceBy(std::move(received_data.transport_router.value()));
     }
+    // Route queries only read the router, so a base saved with settings alone gets its router now
+    if (!router_.IsInitialized() && router_.GetSettings().has_value()) {
+        router_.InitializeRouter(database_);
+    }
+    ResetRenderedMaps(received_data.rendered_map.has_value()
+                     ? std::make_shared<const RenderedMap>(json::EscapedString(received_data.rendered_map.value()))
+                     : nullptr);
+
+    const std::lock_guard lock(rendered_map_mutex_);
+    for (const auto& [tile, png] : received_data.png_tiles) {
+        stored_png_tiles_.emplace(tile, std::make_shared<const RenderedMap>(RenderedMap::FromPng(png)));
+    }
 }
 
 } // namespace transport_catalogue::queries
\ No newline at end of file
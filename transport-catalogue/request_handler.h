@@ -7,20 +7,63 @@
 #include "domain.h"
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "map_viewport.h"
 #include "transport_router.h"
 #include "serialization.h"
 #include "reader.h"
 #include "input_reader.h"
 #include "stat_reader.h"
 #include "json_reader.h"
+#include "responses.h"
+#include "thread_pool.h"
 
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <optional>
+#include <string>
 #include <string_view>
+#include <unordered_map>
 #include <variant>
 
 namespace transport_catalogue::queries {
 
+/// The map of a base rendered once and printed as is by every later query
+struct RenderedMap {
+    /// SVG or Base64 of PNG, rendered straight into the escaped form, since maps are printed inside JSON
+    json::EscapedString json_image;
+
+    /// PNG images are compressed already, so they are never encoded again
+    bool is_png = false;
+
+    /// Documents of fewer objects are rendered in one part
+    static constexpr std::size_t min_part_object_count = 4096;
+
+    /// Parts of a large document are rendered concurrently by \p pool, if any
+    explicit RenderedMap(const svg::Document& document, thread_pool::ThreadPool* pool = nullptr);
+    explicit RenderedMap(json::EscapedString json_image, bool is_png = false) noexcept;
+
+    [[nodiscard]] static RenderedMap FromPng(std::string_view png);
+
+    /// Base64 of the SVG compressed with \p encoding, or nullptr if the map is printed as is.
+    /// Compressed on the first call and shared by later ones. Safe to call from several threads
+    [[nodiscard]] const json::EscapedString* GetEncoded(into::Encoding encoding) const;
+
+private:
+    /// Compressed by the first thread that asks for it, while the others wait
+    struct EncodedImage {
+        std::once_flag compressed;
+        std::optional<json::EscapedString> image;
+    };
+
+    struct EncodedImages {
+        EncodedImage deflate;
+        EncodedImage gzip;
+    };
+
+    std::unique_ptr<EncodedImages> encoded_images_ = std::make_unique<EncodedImages>();
+};
+
 class Handler final {
 public:
     enum class Error {
@@ -51,6 +94,13 @@ public:
     template<typename From, typename Into>
     Handler::Result ProcessQueries(std::string_view mode, From from, Into into);
 
+    template<typename From, typename Into>
+    void ProcessStream(From from, Into into);
+
+    /// Deserialize the base that settings of \p from refer to
+    template<typename From>
+    void LoadBase(From from);
+
     // Transport Catalogue methods adapters
 
     void AddStop(Stop stop);
@@ -74,24 +124,47 @@ public:
     [[nodiscard]] std::optional<const BusInfo*> GetBusInfo(std::string_view bus_name) const;
     [[nodiscard]] std::optional<const StopInfo*> GetStopInfo(std::string_view stop_name) const;
 
+    [[nodiscard]] std::vector<spatial::Neighbour> FindNearestStops(geo::Coordinates point, std::size_t count) const;
+    [[nodiscard]] std::vector<StopPtr> FindStopsInBox(spatial::BoundingBox box) const;
+
     // Map Renderer methods adapters
 
     void InitializeMapRenderer(renderer::Settings settings);
 
     [[nodiscard]] svg::Document RenderMap() const;
 
+    /// Render the map on the first call and share it until the base or the render settings change.
+    /// Adding buses re-renders only the fragments of the map they affect. Safe to call from several threads
+    [[nodiscard]] std::shared_ptr<const RenderedMap> GetRenderedMap(
+            renderer::ImageFormat format = renderer::ImageFormat::Svg) const;
+
+    /// Render only what intersects \p viewport to the whole canvas. Tiles are cached like the whole map,
+    /// and PNG tiles stored in the base are never rendered again
+    [[nodiscard]] std::shared_ptr<const RenderedMap> GetRenderedViewport(
+            const renderer::Viewport& viewport, renderer::ImageFormat format = renderer::ImageFormat::Svg) const;
+
     // Transport Route methods adapters
 
     void InitializeRouterSettings(router::Settings settings);
     void InitializeRouter();
+    /// Rebuild the router, if it has been built, after stops or buses are added
+    void UpdateRouter();
 
     using RouteResult = router::TransportRouter::Result;
 
-    [[nodiscard]] RouteResult GetRouteBetweenStops(std::string_view from, std::string_view to);
+    /// The router is built with the routing settings or when the base is deserialized, never by route queries
+    [[nodiscard]] RouteResult GetRouteBetweenStops(std::string_view from, std::string_view to) const;
+    [[nodiscard]] RouteResult GetRouteBetweenPoints(geo::Coordinates from, geo::Coordinates to) const;
+
+    /// Render only the buses, walks and stops of \p route, projected like the whole map so that it overlays it
+    [[nodiscard]] RenderedMap RenderItinerary(const RouteResult& route,
+                                              std::optional<geo::Coordinates> from = std::nullopt,
+                                              std::optional<geo::Coordinates> to = std::nullopt) const;
 
     // Serialization methods adapters
 
     void InitializeSerialization(serialization::Settings settings);
+    [[nodiscard]] const std::optional<serialization::Settings>& GetSerializationSettings() const noexcept;
 
     void Serialize();
     void Deserialize();
@@ -102,11 +175,52 @@ private:
     router::TransportRouter& router_;
 
     serialization::Serializer serializer_;
+
+    static constexpr std::size_t max_rendered_tile_count = 4096;
+
+    mutable std::mutex rendered_map_mutex_;
+    mutable std::shared_ptr<const RenderedMap> rendered_map_;
+    mutable std::shared_ptr<const RenderedMap> rendered_png_map_;
+    /// Locked before rendered_map_mutex_ if both are needed
+    mutable std::mutex map_fragments_mutex_;
+    mutable renderer::MapFragments map_fragments_;
+    mutable std::shared_ptr<const renderer::ViewportSelector> viewport_selector_;
+    mutable std::shared_ptr<const renderer::MapLayout> map_layout_;
+    using TileCache = std::unordered_map<renderer::Tile, std::shared_ptr<const RenderedMap>, renderer::TileHasher>;
+    mutable TileCache rendered_tiles_;
+    mutable TileCache rendered_png_tiles_;
+    /// Loaded from the base, so they are not evicted
+    TileCache stored_png_tiles_;
+
+    [[nodiscard]] svg::Document RenderViewport(const renderer::ViewportSelector& selector,
+                                               const renderer::Viewport& viewport) const;
+    /// Rasterize \p document to the canvas size of the render settings multiplied by \p scale
+    [[nodiscard]] std::string RenderPng(const svg::Document& document, double scale = 1.0) const;
+    /// The scale that fits the canvas into a PNG tile
+    [[nodiscard]] double GetPngTileScale() const;
+    [[nodiscard]] std::shared_ptr<const RenderedMap> MakeRenderedMap(const svg::Document& document,
+                                                                     renderer::ImageFormat format,
+                                                                     double png_scale = 1.0) const;
+
+    [[nodiscard]] std::shared_ptr<const renderer::ViewportSelector> GetViewportSelector() const;
+    /// Itineraries need only the layout of the map, which is much cheaper to build than the selector
+    [[nodiscard]] std::shared_ptr<const renderer::MapLayout> GetMapLayout() const;
+
+    /// Created by the first render of a large document outside of other pools
+    mutable std::once_flag render_pool_created_;
+    mutable std::unique_ptr<thread_pool::ThreadPool> render_pool_;
+
+    /// Nullptr if \p document should be rendered on the calling thread
+    [[nodiscard]] thread_pool::ThreadPool* GetRenderPool(const svg::Document& document) const;
+    void ResetRenderedMaps(std::shared_ptr<const RenderedMap> rendered_map = nullptr);
+    /// Fragments refer to the buses and stops of the database and are rendered with the current settings
+    void ResetMapFragments();
 };
 
 template<typename StopContainer>
 void Handler::AddBus(std::string name, const StopContainer& stop_names, Bus::RouteType route_type) {
     database_.AddBus(std::move(name), stop_names, route_type);
+    ResetRenderedMaps();
 }
 
 template<typename From>
@@ -119,6 +233,16 @@ void Handler::ProcessQueries(From from, Into into) {
     into::ProcessQueries(ReadQueries(from), *this, into);
 }
 
+template<typename From, typename Into>
+void Handler::ProcessStream(From from, Into into) {
+    into::ProcessStream(from, *this, into);
+}
+
+template<typename From>
+void Handler::LoadBase(From from) {
+    from::LoadBase(from, *this);
+}
+
 template<typename From, typename Into>
 Handler::Result Handler::ProcessQueries(std::string_view mode, From from, Into into) {
     using namespace std::string_view_literals;
@@ -127,6 +251,8 @@ Handler::Result Handler::ProcessQueries(std::string_view mode, From from, Into i
         ProcessQueries(from);
     } else if (mode == "process_requests"sv) {
         ProcessQueries(from, into);
+    } else if (mode == "process_stream"sv) {
+        ProcessStream(from, into);
     } else {
         return Error::IncorrectMode;
     }
@@ -0,0 +1,70 @@
+/// \file
+/// Responses of the built-in stat queries, which print drivers turn into output
+
+#pragma once
+
+#include "domain.h"
+#include "svg.h"
+#include "spatial_index.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace transport_catalogue::queries {
+
+struct RenderedMap;
+
+} // namespace transport_catalogue::queries
+
+namespace transport_catalogue::into {
+
+/// Compression of map fields for clients that pay for bandwidth. Compressed maps are printed in Base64
+enum class Encoding {
+    Identity,
+    /// A zlib stream, like HTTP Content-Encoding: deflate
+    Deflate,
+    Gzip,
+};
+
+// Responses refer to the results of queries, which live until the response is printed
+
+struct StopInfoResponse {
+    int id;
+    std::string_view name;
+    std::optional<const TransportCatalogue::StopInfo*> info;
+};
+
+struct BusInfoResponse {
+    int id;
+    std::string_view name;
+    std::optional<const TransportCatalogue::BusInfo*> info;
+};
+
+struct MapResponse {
+    int id;
+    const queries::RenderedMap& map;
+    Encoding encoding = Encoding::Identity;
+};
+
+struct RouteResponse {
+    int id;
+    const router::TransportRouter::Result& route;
+    /// The itinerary alone, if it was asked for
+    const queries::RenderedMap* map = nullptr;
+    Encoding encoding = Encoding::Identity;
+};
+
+struct NearestStopsResponse {
+    int id;
+    const std::vector<spatial::Neighbour>& neighbours;
+};
+
+struct StopsInBoxResponse {
+    int id;
+    const std::vector<StopPtr>& stops;
+};
+
+} // namespace transport_catalogue::into
\ No newline at end of file
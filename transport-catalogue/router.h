@@ -41,6 +41,22 @@ public:
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    struct Endpoint {
+        VertexId vertex;
+        Weight weight;
+    };
+
+    struct MultiRouteInfo {
+        RouteInfo route;
+        std::size_t source_index;
+        std::size_t target_index;
+    };
+
+    /// Find the best route from any of \p sources to any of \p targets, where the weights of endpoints are
+    /// added to the weight of a route between them; only the winning route is reconstructed
+    std::optional<MultiRouteInfo> BuildRoute(const std::vector<Endpoint>& sources,
+                                             const std::vector<Endpoint>& targets) const;
+
 private:
     void InitializeRoutesInternalData(const Graph& graph) {
         const size_t vertex_count = graph.GetVertexCount();
@@ -155,4 +171,34 @@ std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(Ver
     return RouteInfo{weight, std::move(edges)};
 }
 
+template<typename Weight>
+std::optional<typename Router<Weight>::MultiRouteInfo> Router<Weight>::BuildRoute(
+        const std::vector<Endpoint>& sources, const std::vector<Endpoint>& targets) const {
+    std::optional<Weight> best_weight;
+    std::size_t best_source_index = 0;
+    std::size_t best_target_index = 0;
+
+    for (std::size_t source_index = 0; source_index < sources.size(); ++source_index) {
+        const auto& source = sources[source_index];
+        const auto& row = routes_internal_data_.at(source.vertex);
+        for (std::size_t target_index = 0; target_index < targets.size(); ++target_index) {
+            const auto& target = targets[target_index];
+            if (const auto& route_internal_data = row.at(target.vertex)) {
+                const Weight weight = source.weight + route_internal_data->weight + target.weight;
+                if (!best_weight || weight < *best_weight) {
+                    best_weight = weight;
+                    best_source_index = source_index;
+                    best_target_index = target_index;
+                }
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+    auto route = BuildRoute(sources[best_source_index].vertex, targets[best_target_index].vertex);
+    return MultiRouteInfo{std::move(route.value()), best_source_index, best_target_index};
+}
+
 }  // namespace graph
\ No newline at end of file
@@ -32,6 +32,10 @@ void Serializer::Initialize(Settings settings) {
     settings_ = std::move(settings);
 }
 
+const std::optional<Settings>& Serializer::GetSettings() const noexcept {
+    return settings_;
+}
+
 [[nodiscard]] db_proto::Database GetProtoDatabase(const TransportCatalogue& database) {
     db_proto::Database proto_database;
 
@@ -53,7 +57,10 @@ void Serializer::Initialize(Settings settings) {
             index += 1;
         }
     }
+    std::unordered_map<BusPtr, std::int32_t> bus_ptr_to_index;
     for (const auto& bus : database.GetAllBuses()) {
+        bus_ptr_to_index.emplace(&bus, static_cast<std::int32_t>(bus_ptr_to_index.size()));
+
         db_proto::Bus proto_bus;
         proto_bus.set_name(bus.name);
 
@@ -78,6 +85,31 @@ void Serializer::Initialize(Settings settings) {
         *proto_database.add_distances() = std::move(proto_distance);
     }
 
+    for (StopPtr stop_ptr : database.GetStopIndex().GetPackedStops()) {
+        proto_database.add_packed_stop_indices(stop_ptr_to_index.at(stop_ptr));
+    }
+
+    for (const auto& stop : database.GetAllStops()) {
+        db_proto::StopInfo proto_stop_info;
+        proto_stop_info.set_stop_index(stop_ptr_to_index.at(&stop));
+        for (BusPtr bus_ptr : database.GetStopInfo(stop.name).value()->buses) {
+            proto_stop_info.add_bus_indices(bus_ptr_to_index.at(bus_ptr));
+        }
+        *proto_database.add_stop_infos() = std::move(proto_stop_info);
+    }
+
+    for (const auto& bus : database.GetAllBuses()) {
+        const auto& bus_info = *database.GetBusInfo(bus.name).value();
+
+        db_proto::BusInfo proto_bus_info;
+        proto_bus_info.set_bus_index(bus_ptr_to_index.at(&bus));
+        proto_bus_info.set_stops_count(bus_info.stops_count);
+        proto_bus_info.set_unique_stops_count(bus_info.unique_stops_count);
+        proto_bus_info.set_route_length(bus_info.length.route.Get());
+        proto_bus_info.set_geo_length(bus_info.length.geo.Get());
+        *proto_database.add_bus_infos() = std::move(proto_bus_info);
+    }
+
     return proto_database;
 }
 
@@ -136,6 +168,7 @@ template<typename ColorVariantType>
     for (const auto& color : settings.color_palette) {
         *proto_settings.add_color_palette() = std::visit(get_proto_color, color);
     }
+    proto_settings.set_simplification_tolerance(settings.simplification_tolerance);
 
     return proto_settings;
 }
@@ -144,6 +177,9 @@ template<typename ColorVariantType>
     router_proto::Settings proto_settings;
     proto_settings.set_bus_wait_time(settings.bus_wait_time.Get());
     proto_settings.set_bus_velocity(settings.bus_velocity.Get());
+    proto_settings.set_walking_velocity(settings.walking_velocity.Get());
+    proto_settings.set_walking_stop_count(settings.walking_stop_count);
+    proto_settings.set_max_walk_distance(settings.max_walk_distance.Get());
     return proto_settings;
 }
 
@@ -160,6 +196,10 @@ template<typename ColorVariantType>
         proto_bus_item.set_time(bus_item.time.Get());
         proto_bus_item.set_span_count(bus_item.span_count);
         *proto_weight.mutable_bus_item() = proto_bus_item;
+    } else if (item.IsWalkItem()) {
+        graph_proto::WalkItem proto_walk_item;
+        proto_walk_item.set_time(item.GetWalkItem().time.Get());
+        *proto_weight.mutable_walk_item() = proto_walk_item;
     } else {
         graph_proto::CombineItem proto_combine_item;
         proto_combine_item.set_time(item.GetTime().Get());
@@ -229,6 +269,16 @@ void Serializer::Serialize(SentData sent_data) const {
     if (sent_data.render_settings.has_value()) {
         *proto_catalogue.mutable_render_settings() = GetProtoMapRendererSettings(sent_data.render_settings.value());
     }
+    if (sent_data.rendered_map.has_value()) {
+        proto_catalogue.set_rendered_map(std::string(sent_data.rendered_map.value()));
+    }
+    for (auto& [tile, png] : sent_data.png_tiles) {
+        auto& proto_tile = *proto_catalogue.add_png_tiles();
+        proto_tile.set_zoom(tile.zoom);
+        proto_tile.set_x(tile.x);
+        proto_tile.set_y(tile.y);
+        proto_tile.set_png(std::move(png));
+    }
 
     if (const auto router_settings = sent_data.transport_router.GetSettings()) {
         router_proto::TransportRouter proto_transport_router;
@@ -278,6 +328,40 @@ void Serializer::Serialize(SentData sent_data) const {
         database.SetDistanceBetweenStops(from_stop_name, to_stop_name, distance_m);
     }
 
+    if (proto_database.packed_stop_indices_size() == proto_database.stops_size()) {
+        std::vector<StopPtr> packed_stops;
+        packed_stops.reserve(proto_database.packed_stop_indices_size());
+        for (const auto index : proto_database.packed_stop_indices()) {
+            packed_stops.push_back(database.FindStopBy(proto_database.stops().at(index).name()).value());
+        }
+        database.SetStopIndex(spatial::StopIndex::FromPacked(std::move(packed_stops)));
+    }
+
+    const auto get_stop_ptr = [&](std::int32_t index) {
+        return database.FindStopBy(proto_database.stops().at(index).name()).value();
+    };
+    const auto get_bus_ptr = [&](std::int32_t index) {
+        return database.FindBusBy(proto_database.buses().at(index).name()).value();
+    };
+
+    for (const auto& proto_stop_info : proto_database.stop_infos()) {
+        TransportCatalogue::StopInfo stop_info;
+        stop_info.buses.reserve(proto_stop_info.bus_indices_size());
+        for (const auto index : proto_stop_info.bus_indices()) {
+            stop_info.buses.push_back(get_bus_ptr(index));
+        }
+        database.SetStopInfo(get_stop_ptr(proto_stop_info.stop_index()), std::move(stop_info));
+    }
+
+    for (const auto& proto_bus_info : proto_database.bus_infos()) {
+        TransportCatalogue::BusInfo bus_info;
+        bus_info.stops_count = proto_bus_info.stops_count();
+        bus_info.unique_stops_count = proto_bus_info.unique_stops_count();
+        bus_info.length.route = geo::Meter{proto_bus_info.route_length()};
+        bus_info.length.geo = geo::Meter{proto_bus_info.geo_length()};
+        database.SetBusInfo(get_bus_ptr(proto_bus_info.bus_index()), bus_info);
+    }
+
     return database;
 }
 
@@ -340,6 +424,7 @@ void Serializer::Serialize(SentData sent_data) const {
     for (const auto& proto_color : proto_settings.color_palette()) {
         settings.color_palette.emplace_back(GetSvgColor(proto_color));
     }
+    settings.simplification_tolerance = proto_settings.simplification_tolerance();
 
     return settings;
 }
@@ -363,8 +448,13 @@ void Serializer::Serialize(SentData sent_data) const {
             item = router::TransportRouter::BusItem{time, span_count};
             break;
         }
+        case graph_proto::Weight::kWalkItem: {
+            const auto time = router::Minute{proto_weight.walk_item().time()};
+            item = router::TransportRouter::WalkItem{time};
+            break;
+        }
         case graph_proto::Weight::WEIGHT_NOT_SET: {
-            throw std::logic_error("Edge's weight must be either Combine, or Wait, or Bus item"s);
+            throw std::logic_error("Edge's weight must be either Combine, or Wait, or Bus, or Walk item"s);
         }
     }
     return item;
@@ -374,6 +464,11 @@ void Serializer::Serialize(SentData sent_data) const {
     router::Settings settings;
     settings.bus_wait_time = router::Minute{proto_settings.bus_wait_time()};
     settings.bus_velocity = router::KmPerHour{proto_settings.bus_velocity()};
+    if (proto_settings.walking_velocity() > 0.0) {
+        settings.walking_velocity = router::KmPerHour{proto_settings.walking_velocity()};
+        settings.walking_stop_count = proto_settings.walking_stop_count();
+    }
+    settings.max_walk_distance = geo::Meter{proto_settings.max_walk_distance()};
     return settings;
 }
 
@@ -418,15 +513,28 @@ Serializer::ReceivedData Serializer::Deserialize() const {
     }
 
     std::ifstream input(settings_->file, std::ios::binary);
+    if (!input) {
+        throw std::runtime_error("Failed to open "s + settings_->file.string());
+    }
 
     db_proto::TransportCatalogue proto_catalogue;
-    proto_catalogue.ParseFromIstream(&input);
+    if (!proto_catalogue.ParseFromIstream(&input)) {
+        throw std::runtime_error("Failed to parse "s + settings_->file.string());
+    }
 
     ReceivedData received_data{GetDatabase(proto_catalogue.database())};
 
     if (proto_catalogue.has_render_settings()) {
         received_data.render_settings = GetMapRendererSettings(*proto_catalogue.mutable_render_settings());
     }
+    if (proto_catalogue.has_rendered_map()) {
+        received_data.rendered_map = std::move(*proto_catalogue.mutable_rendered_map());
+    }
+    received_data.png_tiles.reserve(proto_catalogue.png_tiles_size());
+    for (auto& proto_tile : *proto_catalogue.mutable_png_tiles()) {
+        received_data.png_tiles.push_back({{proto_tile.zoom(), proto_tile.x(), proto_tile.y()},
+                                           std::move(*proto_tile.mutable_png())});
+    }
 
     if (proto_catalogue.has_transport_router()) {
         router::TransportRouter transport_router;
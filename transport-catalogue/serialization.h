@@ -2,26 +2,43 @@
 
 #include "transport_catalogue.h"
 #include "map_renderer.h"
+#include "map_viewport.h"
 #include "transport_router.h"
 
 #include <filesystem>
 #include <optional>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <vector>
 
 namespace transport_catalogue::serialization {
 
 struct Settings {
     std::filesystem::path file;
+    /// Tiles of zoom levels up to this one are rendered into PNG and stored in the base
+    std::optional<int> png_tiles_max_zoom = std::nullopt;
+
+    static constexpr int max_png_tiles_zoom = 5;
+};
+
+struct PngTile {
+    renderer::Tile tile;
+    std::string png;
 };
 
 class Serializer {
 public:
     void Initialize(Settings settings);
 
+    [[nodiscard]] const std::optional<Settings>& GetSettings() const noexcept;
+
     struct SentData {
         const TransportCatalogue& database;
         std::optional<std::reference_wrapper<const renderer::Settings>> render_settings;
         const router::TransportRouter& transport_router;
+        std::optional<std::string_view> rendered_map = std::nullopt;
+        std::vector<PngTile> png_tiles = {};
     };
 
     void Serialize(SentData sent_data) const;
@@ -30,6 +47,8 @@ public:
         TransportCatalogue database;
         std::optional<renderer::Settings> render_settings = std::nullopt;
         std::optional<router::TransportRouter> transport_router = std::nullopt;
+        std::optional<std::string> rendered_map = std::nullopt;
+        std::vector<PngTile> png_tiles = {};
     };
 
     [[nodiscard]] ReceivedData Deserialize() const;
@@ -0,0 +1,551 @@
+#include "server.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#if defined(__linux__)
+#define SERVER_HAS_EPOLL
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace transport_catalogue::server {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+// Endpoint
+
+Endpoint Endpoint::Parse(std::string_view text) {
+    if (text.empty()) {
+        throw std::invalid_argument("Endpoint must be a socket path or a port"s);
+    }
+
+    if (std::all_of(text.begin(), text.end(), [](char ch) { return '0' <= ch && ch <= '9'; })) {
+        unsigned long port = 0;
+        for (const char ch : text) {
+            port = port * 10 + static_cast<unsigned long>(ch - '0');
+            if (port > 65535) {
+                break;
+            }
+        }
+        if (port == 0 || port > 65535) {
+            throw std::invalid_argument("Port must be in [1, 65535]"s);
+        }
+        return Endpoint{static_cast<std::uint16_t>(port)};
+    }
+
+    return Endpoint{std::string(text)};
+}
+
+// LatencyHistogram
+
+void LatencyHistogram::Record(std::chrono::nanoseconds latency) noexcept {
+    const auto microseconds = static_cast<std::uint64_t>(
+            std::max<std::int64_t>(0, std::chrono::duration_cast<std::chrono::microseconds>(latency).count()));
+    buckets_[GetBucketIndex(microseconds)].fetch_add(1, std::memory_order_relaxed);
+
+    std::uint64_t max = max_microseconds_.load(std::memory_order_relaxed);
+    while (microseconds > max && !max_microseconds_.compare_exchange_weak(max, microseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencyHistogram::Summary LatencyHistogram::TakeSummary() noexcept {
+    std::array<std::uint64_t, bucket_count> counts{};
+    Summary summary;
+    for (std::size_t index = 0; index < bucket_count; ++index) {
+        counts[index] = buckets_[index].exchange(0, std::memory_order_relaxed);
+        summary.count += counts[index];
+    }
+    summary.max = std::chrono::microseconds(max_microseconds_.exchange(0, std::memory_order_relaxed));
+    if (summary.count == 0) {
+        return summary;
+    }
+
+    auto percentile = [&counts, &summary](std::uint64_t per_mille) {
+        // The rank of the percentile among recorded latencies, counting from one
+        const std::uint64_t rank = std::max<std::uint64_t>(1, (summary.count * per_mille + 999) / 1000);
+        std::uint64_t seen = 0;
+        for (std::size_t index = 0; index < bucket_count; ++index) {
+            seen += counts[index];
+            if (seen >= rank) {
+                return std::min(summary.max, std::chrono::microseconds(GetBucketUpperBound(index)));
+            }
+        }
+        return summary.max;
+    };
+    summary.p50 = percentile(500);
+    summary.p90 = percentile(900);
+    summary.p99 = percentile(990);
+    return summary;
+}
+
+std::size_t LatencyHistogram::GetBucketIndex(std::uint64_t microseconds) noexcept {
+    if (microseconds < 4) {
+        return static_cast<std::size_t>(microseconds);
+    }
+    // Four buckets per power of two are told apart by the two bits after the highest one
+    const auto exponent = static_cast<std::size_t>(63 - __builtin_clzll(microseconds));
+    return 4 * (exponent - 1) + static_cast<std::size_t>((microseconds >> (exponent - 2)) & 3);
+}
+
+std::uint64_t LatencyHistogram::GetBucketUpperBound(std::size_t index) noexcept {
+    if (index < 4) {
+        return index;
+    }
+    const std::size_t exponent = index / 4 + 1;
+    const std::uint64_t lower_bound = (4 + index % 4) << (exponent - 2);
+    return lower_bound + (std::uint64_t{1} << (exponent - 2)) - 1;
+}
+
+// Server
+
+namespace {
+
+constexpr std::uint64_t listen_id = 0;
+constexpr std::uint64_t wake_id = 1;
+
+/// A client that sends a longer line without a line break is disconnected
+constexpr std::size_t max_line_size = 64 * 1024 * 1024;
+/// Reading from a client stops while it has as many requests in progress
+constexpr std::size_t max_requests_in_progress = 1024;
+constexpr std::size_t read_chunk_size = 64 * 1024;
+
+[[noreturn]] void ThrowSystemError(const char* what) {
+    throw std::system_error(errno, std::generic_category(), what);
+}
+
+} // namespace
+
+#ifdef SERVER_HAS_EPOLL
+
+Server::Server(queries::SnapshotHolder& snapshots, Settings settings)
+        : snapshots_(snapshots)
+        , settings_(std::move(settings))
+        , next_connection_id_(wake_id + 1)
+        , last_report_time_(Clock::now())
+        , pool_(std::in_place, settings_.thread_count) {
+    try {
+        epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+        if (epoll_fd_ < 0) {
+            ThrowSystemError("epoll_create1");
+        }
+
+        wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd_ < 0) {
+            ThrowSystemError("eventfd");
+        }
+        epoll_event wake_event{};
+        wake_event.events = EPOLLIN;
+        wake_event.data.u64 = wake_id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &wake_event) != 0) {
+            ThrowSystemError("epoll_ctl");
+        }
+
+        Listen();
+    } catch (...) {
+        for (const int fd : {listen_fd_, wake_fd_, epoll_fd_}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        throw;
+    }
+}
+
+Server::~Server() {
+    pool_.reset();
+    for (auto& [id, connection] : connections_) {
+        close(connection.fd);
+    }
+    close(listen_fd_);
+    close(wake_fd_);
+    close(epoll_fd_);
+    if (const auto* path = std::get_if<std::string>(&settings_.endpoint.address)) {
+        unlink(path->c_str());
+    }
+}
+
+void Server::Listen() {
+    if (const auto* path = std::get_if<std::string>(&settings_.endpoint.address)) {
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (path->size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Socket path is too long: "s + *path);
+        }
+        std::memcpy(address.sun_path, path->c_str(), path->size() + 1);
+
+        // A socket left by a previous run would make bind fail
+        if (struct stat file_stat{}; stat(path->c_str(), &file_stat) == 0 && S_ISSOCK(file_stat.st_mode)) {
+            unlink(path->c_str());
+        }
+
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("bind");
+        }
+    } else {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(std::get<std::uint16_t>(settings_.endpoint.address));
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listen_fd_ < 0) {
+            ThrowSystemError("socket");
+        }
+        const int reuse_address = 1;
+        setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse_address, sizeof(reuse_address));
+        if (bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            ThrowSystemError("bind");
+        }
+    }
+
+    if (listen(listen_fd_, SOMAXCONN) != 0) {
+        ThrowSystemError("listen");
+    }
+
+    epoll_event listen_event{};
+    listen_event.events = EPOLLIN;
+    listen_event.data.u64 = listen_id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &listen_event) != 0) {
+        ThrowSystemError("epoll_ctl");
+    }
+}
+
+void Server::Run() {
+    constexpr int max_event_count = 64;
+    std::array<epoll_event, max_event_count> events{};
+
+    last_report_time_ = Clock::now();
+    while (!is_stopped_.load()) {
+        int timeout = -1;
+        if (settings_.report_interval.count() > 0) {
+            const auto until_report = last_report_time_ + settings_.report_interval - Clock::now();
+            timeout = static_cast<int>(std::max<std::int64_t>(
+                    0, std::chrono::duration_cast<std::chrono::milliseconds>(until_report).count()));
+        }
+
+        const int event_count = epoll_wait(epoll_fd_, events.data(), max_event_count, timeout);
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ThrowSystemError("epoll_wait");
+        }
+
+        for (int i = 0; i < event_count; ++i) {
+            const std::uint64_t id = events[i].data.u64;
+            if (id == listen_id) {
+                Accept();
+                continue;
+            }
+            if (id == wake_id) {
+                std::uint64_t wake_count;
+                [[maybe_unused]] const auto size = read(wake_fd_, &wake_count, sizeof(wake_count));
+                if (is_reload_requested_.exchange(false)) {
+                    snapshots_.RequestReload();
+                }
+                HandleCompletions();
+                continue;
+            }
+
+            const auto iter = connections_.find(id);
+            if (iter == connections_.end()) {
+                continue;
+            }
+            Connection& connection = iter->second;
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                CloseConnection(id);
+                continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                ReadRequests(id, connection);
+                if (connections_.count(id) == 0) {
+                    continue;
+                }
+            }
+            if ((events[i].events & EPOLLOUT) && !SendResponses(connection)) {
+                CloseConnection(id);
+                continue;
+            }
+            UpdateConnection(id, connection);
+        }
+
+        if (settings_.report_interval.count() > 0 && Clock::now() >= last_report_time_ + settings_.report_interval) {
+            Report();
+        }
+    }
+}
+
+void Server::Stop() noexcept {
+    is_stopped_.store(true);
+    Wake();
+}
+
+void Server::RequestReload() noexcept {
+    // Reloading locks a mutex, which signal handlers must not do, so the event loop requests it
+    is_reload_requested_.store(true);
+    Wake();
+}
+
+void Server::Wake() noexcept {
+    const std::uint64_t wake_count = 1;
+    [[maybe_unused]] const auto size = write(wake_fd_, &wake_count, sizeof(wake_count));
+}
+
+void Server::Accept() {
+    while (true) {
+        const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // Besides EAGAIN, errors of a single client such as ECONNABORTED must not stop the server
+            return;
+        }
+
+        // Responses are small and awaited by clients, so they are not delayed to be coalesced.
+        // Unix domain sockets do not support the option, which is fine
+        const int no_delay = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+        const ConnectionId id = next_connection_id_++;
+        Connection& connection = connections_[id];
+        connection.fd = fd;
+        connection.events = EPOLLIN;
+
+        epoll_event event{};
+        event.events = connection.events;
+        event.data.u64 = id;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+            close(fd);
+            connections_.erase(id);
+        }
+    }
+}
+
+void Server::ReadRequests(ConnectionId id, Connection& connection) {
+    while (!connection.is_input_closed && connection.responses.size() < max_requests_in_progress) {
+        const std::size_t old_size = connection.input.size();
+        connection.input.resize(old_size + read_chunk_size);
+        const auto size = recv(connection.fd, connection.input.data() + old_size, read_chunk_size, 0);
+        connection.input.resize(old_size + static_cast<std::size_t>(std::max<ssize_t>(0, size)));
+
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            CloseConnection(id);
+            return;
+        }
+        if (size == 0) {
+            connection.is_input_closed = true;
+        }
+
+        // Only the received part has to be searched for line breaks
+        std::size_t line_begin = 0;
+        for (std::size_t line_end = connection.input.find('\n', old_size); line_end != std::string::npos;
+             line_end = connection.input.find('\n', line_begin)) {
+            SubmitRequest(id, connection, connection.input.substr(line_begin, line_end - line_begin));
+            line_begin = line_end + 1;
+        }
+        connection.input.erase(0, line_begin);
+
+        if (connection.input.size() > max_line_size) {
+            CloseConnection(id);
+            return;
+        }
+    }
+
+    // The last line does not need a line break
+    if (connection.is_input_closed && !connection.input.empty()) {
+        SubmitRequest(id, connection, std::move(connection.input));
+        connection.input.clear();
+    }
+}
+
+void Server::SubmitRequest(ConnectionId id, Connection& connection, std::string line) {
+    connection.responses.emplace_back();
+    const std::uint64_t sequence = connection.next_request_sequence++;
+
+    pool_->Post([this, id, sequence, line = std::move(line), received_time = Clock::now()] {
+        // The snapshot stays alive until the request is processed, even if it is replaced meanwhile
+        const auto snapshot = snapshots_.Get();
+        std::ostringstream output;
+        into::JsonLineProcessor processor(snapshot->GetHandler(), output);
+        processor.ProcessLine(line);
+        latencies_.Record(Clock::now() - received_time);
+        Complete(Completion{id, sequence, output.str()});
+    });
+}
+
+void Server::Complete(Completion completion) {
+    bool is_first;
+    {
+        std::lock_guard guard(completions_mutex_);
+        is_first = completions_.empty();
+        completions_.push_back(std::move(completion));
+    }
+    // The event loop takes all completions at once, so it has to be woken up only for the first one
+    if (is_first) {
+        Wake();
+    }
+}
+
+void Server::HandleCompletions() {
+    std::vector<Completion> completions;
+    {
+        std::lock_guard guard(completions_mutex_);
+        completions.swap(completions_);
+    }
+
+    std::vector<ConnectionId> updated_ids;
+    for (auto& [id, sequence, response] : completions) {
+        // The client might have disconnected while its request was processed
+        const auto iter = connections_.find(id);
+        if (iter == connections_.end()) {
+            continue;
+        }
+        Connection& connection = iter->second;
+        connection.responses[sequence - connection.first_response_sequence] = std::move(response);
+
+        // Responses are sent in the order of requests
+        while (!connection.responses.empty() && connection.responses.front().has_value()) {
+            connection.output += *connection.responses.front();
+            connection.responses.pop_front();
+            ++connection.first_response_sequence;
+        }
+        updated_ids.push_back(id);
+    }
+
+    std::sort(updated_ids.begin(), updated_ids.end());
+    updated_ids.erase(std::unique(updated_ids.begin(), updated_ids.end()), updated_ids.end());
+    for (const ConnectionId id : updated_ids) {
+        Connection& connection = connections_.at(id);
+        if (!SendResponses(connection)) {
+            CloseConnection(id);
+            continue;
+        }
+        // Reading might have been paused by too many requests in progress
+        if (!connection.is_input_closed && connection.responses.size() < max_requests_in_progress) {
+            ReadRequests(id, connection);
+            if (connections_.count(id) == 0) {
+                continue;
+            }
+        }
+        UpdateConnection(id, connection);
+    }
+}
+
+bool Server::SendResponses(Connection& connection) {
+    while (connection.output_offset < connection.output.size()) {
+        const auto size = send(connection.fd, connection.output.data() + connection.output_offset,
+                               connection.output.size() - connection.output_offset, MSG_NOSIGNAL);
+        if (size < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        connection.output_offset += static_cast<std::size_t>(size);
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+    return true;
+}
+
+void Server::UpdateConnection(ConnectionId id, Connection& connection) {
+    const bool has_output = connection.output_offset < connection.output.size();
+    if (connection.is_input_closed && connection.responses.empty() && !has_output) {
+        CloseConnection(id);
+        return;
+    }
+
+    std::uint32_t events = 0;
+    if (!connection.is_input_closed && connection.responses.size() < max_requests_in_progress) {
+        events |= EPOLLIN;
+    }
+    if (has_output) {
+        events |= EPOLLOUT;
+    }
+    if (events == connection.events) {
+        return;
+    }
+
+    connection.events = events;
+    epoll_event event{};
+    event.events = events;
+    event.data.u64 = id;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event) != 0) {
+        CloseConnection(id);
+    }
+}
+
+void Server::CloseConnection(ConnectionId id) {
+    const auto iter = connections_.find(id);
+    if (iter == connections_.end()) {
+        return;
+    }
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, iter->second.fd, nullptr);
+    close(iter->second.fd);
+    connections_.erase(iter);
+}
+
+#else
+
+Server::Server(queries::SnapshotHolder& snapshots, Settings settings)
+        : snapshots_(snapshots)
+        , settings_(std::move(settings))
+        , next_connection_id_(wake_id + 1)
+        , last_report_time_(Clock::now())
+        , pool_(std::in_place, 1) {
+    throw std::runtime_error("Serving requires epoll, which the system does not support"s);
+}
+
+Server::~Server() = default;
+
+void Server::Run() {}
+
+void Server::Stop() noexcept {}
+
+void Server::RequestReload() noexcept {}
+
+#endif
+
+void Server::Report() {
+    const auto now = Clock::now();
+    const std::chrono::duration<double> elapsed = now - last_report_time_;
+    last_report_time_ = now;
+
+    const auto summary = latencies_.TakeSummary();
+    const double qps = (elapsed.count() > 0.0) ? static_cast<double>(summary.count) / elapsed.count() : 0.0;
+    std::cerr << std::fixed << std::setprecision(1)
+              << "connections: "sv << connections_.size()
+              << ", requests: "sv << summary.count
+              << ", QPS: "sv << qps
+              << ", latency us p50/p90/p99/max: "sv
+              << summary.p50.count() << '/' << summary.p90.count() << '/'
+              << summary.p99.count() << '/' << summary.max.count() << std::endl;
+}
+
+} // namespace transport_catalogue::server
\ No newline at end of file
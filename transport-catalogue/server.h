@@ -0,0 +1,152 @@
+/// \file
+/// Server that answers newline-delimited JSON queries of concurrent clients with one warm base
+
+#pragma once
+
+#include "snapshot.h"
+#include "thread_pool.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+namespace transport_catalogue::server {
+
+/// A Unix domain socket path or a TCP port on the loopback interface
+struct Endpoint {
+    std::variant<std::string, std::uint16_t> address;
+
+    /// A number is a port, anything else is a socket path
+    [[nodiscard]] static Endpoint Parse(std::string_view text);
+};
+
+struct Settings {
+    Endpoint endpoint;
+    /// Zero means as many workers as the hardware supports
+    std::size_t thread_count = 0;
+    /// How often throughput and latency are reported to std::cerr; zero disables reports
+    std::chrono::seconds report_interval{10};
+};
+
+/// Counts latencies in buckets of a quarter of a power of two of microseconds,
+/// so percentiles are accurate to 25% at any scale. Recording is lock-free
+class LatencyHistogram final {
+public:
+    struct Summary {
+        std::uint64_t count = 0;
+        std::chrono::microseconds p50{};
+        std::chrono::microseconds p90{};
+        std::chrono::microseconds p99{};
+        std::chrono::microseconds max{};
+    };
+
+    void Record(std::chrono::nanoseconds latency) noexcept;
+
+    /// Summarize latencies recorded since the previous call
+    [[nodiscard]] Summary TakeSummary() noexcept;
+
+private:
+    static constexpr std::size_t bucket_count = 256;
+
+    std::array<std::atomic<std::uint64_t>, bucket_count> buckets_{};
+    std::atomic<std::uint64_t> max_microseconds_ = 0;
+
+    [[nodiscard]] static std::size_t GetBucketIndex(std::uint64_t microseconds) noexcept;
+    [[nodiscard]] static std::uint64_t GetBucketUpperBound(std::size_t index) noexcept;
+};
+
+/// Every line a client sends is answered by lines of compact JSON in the order of requests,
+/// like in the process_stream mode. Lines are processed by a pool of workers with the current snapshot,
+/// so settings lines are answered with an error and the base is changed only by reloading snapshots
+class Server final {
+public:
+    /// Start listening on the endpoint of \p settings
+    Server(queries::SnapshotHolder& snapshots, Settings settings);
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    ~Server();
+
+    /// Serve clients until Stop is called
+    void Run();
+
+    /// Make Run return. Safe to call from other threads and from signal handlers
+    void Stop() noexcept;
+
+    /// Reload the base in the background without stopping queries. Safe to call from other threads and from signal handlers
+    void RequestReload() noexcept;
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using ConnectionId = std::uint64_t;
+
+    struct Connection {
+        int fd = -1;
+        /// Received bytes after the last complete line
+        std::string input;
+        /// Responses that are ready but not sent yet, starting at output_offset
+        std::string output;
+        std::size_t output_offset = 0;
+        /// Responses of requests in the order of receiving; std::nullopt is not processed yet
+        std::deque<std::optional<std::string>> responses;
+        std::uint64_t first_response_sequence = 0;
+        std::uint64_t next_request_sequence = 0;
+        bool is_input_closed = false;
+        std::uint32_t events = 0;
+    };
+
+    struct Completion {
+        ConnectionId id;
+        std::uint64_t sequence;
+        std::string response;
+    };
+
+    queries::SnapshotHolder& snapshots_;
+    Settings settings_;
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    /// Wakes up the event loop when workers complete requests or the server is stopped
+    int wake_fd_ = -1;
+    std::atomic<bool> is_stopped_ = false;
+    std::atomic<bool> is_reload_requested_ = false;
+
+    std::unordered_map<ConnectionId, Connection> connections_;
+    ConnectionId next_connection_id_;
+
+    std::mutex completions_mutex_;
+    std::vector<Completion> completions_;
+
+    LatencyHistogram latencies_;
+    Clock::time_point last_report_time_;
+
+    // Workers refer to the members above, so the pool is stopped before anything else is destroyed
+    std::optional<thread_pool::ThreadPool> pool_;
+
+    void Listen();
+    void Accept();
+    void ReadRequests(ConnectionId id, Connection& connection);
+    void SubmitRequest(ConnectionId id, Connection& connection, std::string line);
+    void Complete(Completion completion);
+    void HandleCompletions();
+    /// Return false if the connection is broken
+    [[nodiscard]] bool SendResponses(Connection& connection);
+    /// Close the connection if it has nothing more to do, otherwise wait for the events it needs
+    void UpdateConnection(ConnectionId id, Connection& connection);
+    void CloseConnection(ConnectionId id);
+    void Report();
+    void Wake() noexcept;
+};
+
+} // namespace transport_catalogue::server
\ No newline at end of file
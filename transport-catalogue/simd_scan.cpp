@@ -0,0 +1,176 @@
+#include "simd_scan.h"
+
+#include <cstddef>
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__AVX2__)
+#define SIMD_SCAN_AVX2
+#include <immintrin.h>
+#elif defined(__GNUC__) && (defined(__SSE2__) || defined(__x86_64__))
+#define SIMD_SCAN_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace simd_scan {
+
+namespace {
+
+[[nodiscard]] inline bool IsQuoteBackslashOrControl(char ch) noexcept {
+    return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+}
+
+[[nodiscard]] inline bool IsEscaped(char ch) noexcept {
+    return ch == '"' || ch == '\\' || ch == '\n' || ch == '\r';
+}
+
+[[nodiscard]] inline bool IsSpace(char ch) noexcept {
+    // \t, \n, \v, \f and \r are the consecutive codes from 9 to 13
+    return ch == ' ' || static_cast<unsigned char>(ch - '\t') <= '\r' - '\t';
+}
+
+#if defined(SIMD_SCAN_AVX2)
+
+using Vector = __m256i;
+constexpr std::size_t vector_size = 32;
+
+[[nodiscard]] inline Vector Load(const char* ptr) noexcept {
+    return _mm256_loadu_si256(reinterpret_cast<const Vector*>(ptr));
+}
+
+[[nodiscard]] inline Vector Splat(char ch) noexcept {
+    return _mm256_set1_epi8(ch);
+}
+
+[[nodiscard]] inline Vector Equal(Vector lhs, Vector rhs) noexcept {
+    return _mm256_cmpeq_epi8(lhs, rhs);
+}
+
+[[nodiscard]] inline Vector Or(Vector lhs, Vector rhs) noexcept {
+    return _mm256_or_si256(lhs, rhs);
+}
+
+/// Unsigned lhs <= rhs for every byte
+[[nodiscard]] inline Vector LessEqual(Vector lhs, Vector rhs) noexcept {
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(lhs, rhs), lhs);
+}
+
+[[nodiscard]] inline Vector Subtract(Vector lhs, Vector rhs) noexcept {
+    return _mm256_sub_epi8(lhs, rhs);
+}
+
+[[nodiscard]] inline unsigned int Mask(Vector vector) noexcept {
+    return static_cast<unsigned int>(_mm256_movemask_epi8(vector));
+}
+
+#elif defined(SIMD_SCAN_SSE2)
+
+using Vector = __m128i;
+constexpr std::size_t vector_size = 16;
+
+[[nodiscard]] inline Vector Load(const char* ptr) noexcept {
+    return _mm_loadu_si128(reinterpret_cast<const Vector*>(ptr));
+}
+
+[[nodiscard]] inline Vector Splat(char ch) noexcept {
+    return _mm_set1_epi8(ch);
+}
+
+[[nodiscard]] inline Vector Equal(Vector lhs, Vector rhs) noexcept {
+    return _mm_cmpeq_epi8(lhs, rhs);
+}
+
+[[nodiscard]] inline Vector Or(Vector lhs, Vector rhs) noexcept {
+    return _mm_or_si128(lhs, rhs);
+}
+
+/// Unsigned lhs <= rhs for every byte
+[[nodiscard]] inline Vector LessEqual(Vector lhs, Vector rhs) noexcept {
+    return _mm_cmpeq_epi8(_mm_min_epu8(lhs, rhs), lhs);
+}
+
+[[nodiscard]] inline Vector Subtract(Vector lhs, Vector rhs) noexcept {
+    return _mm_sub_epi8(lhs, rhs);
+}
+
+[[nodiscard]] inline unsigned int Mask(Vector vector) noexcept {
+    return static_cast<unsigned int>(_mm_movemask_epi8(vector));
+}
+
+#endif
+
+#if defined(SIMD_SCAN_AVX2) || defined(SIMD_SCAN_SSE2)
+#define SIMD_SCAN_VECTORIZED
+
+/// Scan whole vectors with \p vector_match, whose mask has bits set for matching bytes,
+/// and the tail shorter than a vector with \p scalar_match
+template<typename VectorMatch, typename ScalarMatch>
+[[nodiscard]] const char* Find(const char* first, const char* last,
+                               VectorMatch vector_match, ScalarMatch scalar_match) noexcept {
+    for (; static_cast<std::size_t>(last - first) >= vector_size; first += vector_size) {
+        if (const unsigned int mask = vector_match(Load(first)); mask != 0) {
+            return first + __builtin_ctz(mask);
+        }
+    }
+    for (; first != last; ++first) {
+        if (scalar_match(*first)) {
+            return first;
+        }
+    }
+    return last;
+}
+
+#endif
+
+} // namespace
+
+const char* FindQuoteBackslashOrControl(const char* first, const char* last) noexcept {
+#ifdef SIMD_SCAN_VECTORIZED
+    const Vector quote = Splat('"');
+    const Vector backslash = Splat('\\');
+    const Vector last_control = Splat(0x1F);
+    return Find(first, last, [&](Vector chars) {
+        return Mask(Or(Or(Equal(chars, quote), Equal(chars, backslash)), LessEqual(chars, last_control)));
+    }, IsQuoteBackslashOrControl);
+#else
+    for (; first != last && !IsQuoteBackslashOrControl(*first); ++first) {
+    }
+    return first;
+#endif
+}
+
+const char* FindEscaped(const char* first, const char* last) noexcept {
+#ifdef SIMD_SCAN_VECTORIZED
+    const Vector quote = Splat('"');
+    const Vector backslash = Splat('\\');
+    const Vector line_feed = Splat('\n');
+    const Vector carriage_return = Splat('\r');
+    return Find(first, last, [&](Vector chars) {
+        return Mask(Or(Or(Equal(chars, quote), Equal(chars, backslash)),
+                       Or(Equal(chars, line_feed), Equal(chars, carriage_return))));
+    }, IsEscaped);
+#else
+    for (; first != last && !IsEscaped(*first); ++first) {
+    }
+    return first;
+#endif
+}
+
+const char* SkipSpaces(const char* first, const char* last) noexcept {
+#ifdef SIMD_SCAN_VECTORIZED
+    const Vector space = Splat(' ');
+    const Vector tab = Splat('\t');
+    const Vector control_range = Splat('\r' - '\t');
+    return Find(first, last, [&](Vector chars) {
+        const Vector is_space = Or(Equal(chars, space), LessEqual(Subtract(chars, tab), control_range));
+        return ~Mask(is_space) & ((vector_size == 32) ? ~0u : 0xFFFFu);
+    }, [](char ch) {
+        return !IsSpace(ch);
+    });
+#else
+    for (; first != last && IsSpace(*first); ++first) {
+    }
+    return first;
+#endif
+}
+
+} // namespace simd_scan
\ No newline at end of file
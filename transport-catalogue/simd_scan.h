@@ -0,0 +1,18 @@
+/// \file
+/// Scanning of character ranges by 16 (SSE2) or 32 (AVX2) bytes at a time with a scalar fallback.
+/// The widest instruction set enabled for the compiler is used, e.g. -mavx2 turns on AVX2
+
+#pragma once
+
+namespace simd_scan {
+
+/// Return the first double quote, backslash or control character in [first, last) or last if there is none
+[[nodiscard]] const char* FindQuoteBackslashOrControl(const char* first, const char* last) noexcept;
+
+/// Return the first character that JSON output escapes (double quote, backslash, \n or \r) or last if there is none
+[[nodiscard]] const char* FindEscaped(const char* first, const char* last) noexcept;
+
+/// Return the first character that is not a whitespace (space, \t, \n, \v, \f or \r) or last if there is none
+[[nodiscard]] const char* SkipSpaces(const char* first, const char* last) noexcept;
+
+} // namespace simd_scan
\ No newline at end of file
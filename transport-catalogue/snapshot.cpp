@@ -0,0 +1,96 @@
+#include "snapshot.h"
+#include "thread_pool.h"
+
+#include <stdexcept>
+#include <utility>
+
+namespace transport_catalogue::queries {
+
+// Snapshot
+
+Snapshot::Snapshot() noexcept
+        : handler_(database_, renderer_, router_) {
+}
+
+std::shared_ptr<Snapshot> Snapshot::Reload(const Snapshot& previous) {
+    const auto& settings = previous.handler_.GetSerializationSettings();
+    if (!settings.has_value()) {
+        using namespace std::string_literals;
+        throw std::logic_error("Snapshot without serialization settings cannot be reloaded"s);
+    }
+
+    std::shared_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->handler_.InitializeSerialization(settings.value());
+    snapshot->handler_.Deserialize();
+    snapshot->PrepareForSharing();
+    return snapshot;
+}
+
+const Handler& Snapshot::GetHandler() const noexcept {
+    return handler_;
+}
+
+void Snapshot::PrepareForSharing() {
+    [[maybe_unused]] const auto& stop_index = database_.GetStopIndex();
+    thread_pool::ThreadPool pool;
+    database_.PrecomputeStatistics(pool);
+}
+
+// SnapshotHolder
+
+SnapshotHolder::SnapshotHolder(std::shared_ptr<Snapshot> snapshot, ReloadCallback on_reload)
+        : current_(std::move(snapshot))
+        , on_reload_(std::move(on_reload))
+        , loader_([this] {
+            Load();
+        }) {
+}
+
+SnapshotHolder::~SnapshotHolder() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopped_ = true;
+    }
+    has_request_.notify_one();
+    loader_.join();
+}
+
+std::shared_ptr<Snapshot> SnapshotHolder::Get() const {
+    return std::atomic_load(&current_);
+}
+
+void SnapshotHolder::RequestReload() {
+    {
+        std::lock_guard guard(mutex_);
+        is_reload_requested_ = true;
+    }
+    has_request_.notify_one();
+}
+
+void SnapshotHolder::Load() {
+    while (true) {
+        {
+            std::unique_lock lock(mutex_);
+            has_request_.wait(lock, [this] {
+                return is_stopped_ || is_reload_requested_;
+            });
+            if (is_stopped_) {
+                return;
+            }
+            is_reload_requested_ = false;
+        }
+
+        // Readers keep using the current snapshot while the new one is deserialized
+        std::exception_ptr error;
+        try {
+            std::atomic_store(&current_, Snapshot::Reload(*Get()));
+        } catch (...) {
+            error = std::current_exception();
+        }
+        if (on_reload_) {
+            on_reload_(error);
+        }
+    }
+}
+
+} // namespace transport_catalogue::queries
\ No newline at end of file
@@ -0,0 +1,90 @@
+/// \file
+/// Immutable snapshots of a deserialized base, which are swapped without stopping queries
+
+#pragma once
+
+#include "request_handler.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace transport_catalogue::queries {
+
+/// A deserialized base with its own handler. Nothing changes it after loading,
+/// so any number of threads may query it at the same time
+class Snapshot final {
+public:
+    /// Apply settings of \p from and deserialize the base they refer to
+    template<typename From>
+    [[nodiscard]] static std::shared_ptr<Snapshot> Load(From from);
+
+    /// Deserialize the base file of \p previous again, e.g. after it has been rebuilt
+    [[nodiscard]] static std::shared_ptr<Snapshot> Reload(const Snapshot& previous);
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    [[nodiscard]] const Handler& GetHandler() const noexcept;
+
+private:
+    // The handler refers to the members above it
+    TransportCatalogue database_;
+    renderer::MapRenderer renderer_;
+    router::TransportRouter router_;
+    Handler handler_;
+
+    Snapshot() noexcept;
+
+    /// Fill everything that queries would otherwise compute lazily, e.g. for a base
+    /// saved without the stop index or statistics, before the snapshot is shared
+    void PrepareForSharing();
+};
+
+/// Keeps the current snapshot. A reader holds its snapshot until it releases the handle,
+/// so queries in progress finish with the old base while new ones get the reloaded one
+class SnapshotHolder final {
+public:
+    /// Called on the loading thread after every reload with nullptr or the error that kept the old snapshot
+    using ReloadCallback = std::function<void(std::exception_ptr error)>;
+
+    explicit SnapshotHolder(std::shared_ptr<Snapshot> snapshot, ReloadCallback on_reload = {});
+
+    SnapshotHolder(const SnapshotHolder&) = delete;
+    SnapshotHolder& operator=(const SnapshotHolder&) = delete;
+
+    /// Wait for the reload in progress if any
+    ~SnapshotHolder();
+
+    [[nodiscard]] std::shared_ptr<Snapshot> Get() const;
+
+    /// Reload the base file of the current snapshot on a background thread and swap it in when it is ready.
+    /// Requests made during a reload are coalesced into one more reload
+    void RequestReload();
+
+private:
+    /// Accessed only with atomic operations for std::shared_ptr
+    std::shared_ptr<Snapshot> current_;
+    ReloadCallback on_reload_;
+
+    std::mutex mutex_;
+    std::condition_variable has_request_;
+    bool is_reload_requested_ = false;
+    bool is_stopped_ = false;
+    std::thread loader_;
+
+    void Load();
+};
+
+template<typename From>
+std::shared_ptr<Snapshot> Snapshot::Load(From from) {
+    std::shared_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->handler_.LoadBase(from);
+    snapshot->PrepareForSharing();
+    return snapshot;
+}
+
+} // namespace transport_catalogue::queries
\ No newline at end of file
@@ -0,0 +1,241 @@
+#include "spatial_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace transport_catalogue::spatial {
+
+// BoundingBox
+
+bool BoundingBox::Contains(geo::Coordinates coordinates) const noexcept {
+    return min.lat <= coordinates.lat && coordinates.lat <= max.lat
+        && min.lng <= coordinates.lng && coordinates.lng <= max.lng;
+}
+
+// StopIndex
+
+StopIndex::StopIndex(std::vector<StopPtr> stops)
+        : stops_(std::move(stops)) {
+    Pack(0, stops_.size(), Axis::Latitude);
+}
+
+StopIndex StopIndex::FromPacked(std::vector<StopPtr> packed_stops) noexcept {
+    StopIndex index;
+    index.stops_ = std::move(packed_stops);
+    return index;
+}
+
+const std::vector<StopPtr>& StopIndex::GetPackedStops() const noexcept {
+    return stops_;
+}
+
+void StopIndex::Pack(std::size_t first, std::size_t last, Axis axis) {
+    if (last - first <= 1) {
+        return;
+    }
+
+    const std::size_t middle = first + (last - first) / 2;
+    std::nth_element(
+            stops_.begin() + first, stops_.begin() + middle, stops_.begin() + last,
+            [axis](StopPtr lhs, StopPtr rhs) noexcept {
+                return GetAxisValue(lhs->coordinates, axis) < GetAxisValue(rhs->coordinates, axis);
+            });
+
+    Pack(first, middle, NextAxis(axis));
+    Pack(middle + 1, last, NextAxis(axis));
+}
+
+/// Branch and bound search that keeps the best candidates in a max-heap by distance
+class StopIndex::NearestSearch {
+public:
+    NearestSearch(const StopIndex& index, geo::Coordinates point, std::size_t count)
+            : index_(index)
+            , point_(point)
+            , count_(count) {
+        candidates_.reserve(count);
+    }
+
+    std::vector<Neighbour> Run() && {
+        if (count_ > 0) {
+            Search(0, index_.stops_.size(), Axis::Latitude);
+        }
+        std::sort(candidates_.begin(), candidates_.end(), IsCloser);
+        return std::move(candidates_);
+    }
+
+private:
+    const StopIndex& index_;
+    geo::Coordinates point_;
+    std::size_t count_;
+    std::vector<Neighbour> candidates_;
+
+    static bool IsCloser(const Neighbour& lhs, const Neighbour& rhs) noexcept {
+        if (lhs.distance != rhs.distance) {
+            return lhs.distance < rhs.distance;
+        }
+        return lhs.stop->name < rhs.stop->name;
+    }
+
+    void Search(std::size_t first, std::size_t last, Axis axis) {
+        if (first >= last) {
+            return;
+        }
+
+        const std::size_t middle = first + (last - first) / 2;
+        StopPtr stop_ptr = index_.stops_[middle];
+        Consider(Neighbour{stop_ptr, geo::ComputeDistance(point_, stop_ptr->coordinates)});
+
+        const double split = GetAxisValue(stop_ptr->coordinates, axis);
+        const bool is_point_before = GetAxisValue(point_, axis) < split;
+        if (is_point_before) {
+            Search(first, middle, NextAxis(axis));
+        } else {
+            Search(middle + 1, last, NextAxis(axis));
+        }
+
+        if (candidates_.size() < count_ || ComputeLowerBound(split, axis) <= candidates_.front().distance) {
+            if (is_point_before) {
+                Search(middle + 1, last, NextAxis(axis));
+            } else {
+                Search(first, middle, NextAxis(axis));
+            }
+        }
+    }
+
+    void Consider(Neighbour neighbour) {
+        if (candidates_.size() < count_) {
+            candidates_.push_back(neighbour);
+            std::push_heap(candidates_.begin(), candidates_.end(), IsCloser);
+        } else if (IsCloser(neighbour, candidates_.front())) {
+            std::pop_heap(candidates_.begin(), candidates_.end(), IsCloser);
+            candidates_.back() = neighbour;
+            std::push_heap(candidates_.begin(), candidates_.end(), IsCloser);
+        }
+    }
+
+    /// The shortest great-circle distance from the point to any point on the other side of the split
+    [[nodiscard]] geo::Meter ComputeLowerBound(double split, Axis axis) const noexcept {
+        using namespace std;
+
+        constexpr double pi = 3.14159265358979323846;
+        constexpr double to_radian = pi / 180.0;
+        constexpr auto mean_earth_radius = geo::Meter{6'371'000.0};
+
+        if (axis == Axis::Latitude) {
+            return mean_earth_radius * (abs(point_.lat.Get() - split) * to_radian);
+        }
+
+        // Longitudes wrap around the antimeridian, so the far side might be closer from the other direction
+        const double lng = point_.lng.Get();
+        const double gap = (lng < split) ? min(split - lng, 180.0 + lng) : min(lng - split, 180.0 - lng);
+        const double cos_lat = max(0.0, cos(point_.lat.Get() * to_radian));
+        return mean_earth_radius * asin(min(1.0, cos_lat * sin(min(gap, 90.0) * to_radian)));
+    }
+};
+
+std::vector<Neighbour> StopIndex::FindNearest(geo::Coordinates point, std::size_t count) const {
+    return NearestSearch(*this, point, count).Run();
+}
+
+std::vector<StopPtr> StopIndex::FindInBox(BoundingBox box) const {
+    std::vector<StopPtr> result;
+    SearchInBox(0, stops_.size(), Axis::Latitude, box, result);
+    std::sort(result.begin(), result.end(), [](StopPtr lhs, StopPtr rhs) noexcept {
+        return lhs->name < rhs->name;
+    });
+    return result;
+}
+
+void StopIndex::SearchInBox(std::size_t first, std::size_t last, Axis axis,
+                            BoundingBox box, std::vector<StopPtr>& result) const {
+    if (first >= last) {
+        return;
+    }
+
+    const std::size_t middle = first + (last - first) / 2;
+    StopPtr stop_ptr = stops_[middle];
+    if (box.Contains(stop_ptr->coordinates)) {
+        result.push_back(stop_ptr);
+    }
+
+    const double split = GetAxisValue(stop_ptr->coordinates, axis);
+    if (GetAxisValue(box.min, axis) <= split) {
+        SearchInBox(first, middle, NextAxis(axis), box, result);
+    }
+    if (GetAxisValue(box.max, axis) >= split) {
+        SearchInBox(middle + 1, last, NextAxis(axis), box, result);
+    }
+}
+
+StopIndex::Axis StopIndex::NextAxis(Axis axis) noexcept {
+    return (axis == Axis::Latitude) ? Axis::Longitude : Axis::Latitude;
+}
+
+double StopIndex::GetAxisValue(geo::Coordinates coordinates, Axis axis) noexcept {
+    return (axis == Axis::Latitude) ? coordinates.lat.Get() : coordinates.lng.Get();
+}
+
+// StopGrid
+
+StopGrid::StopGrid(const std::vector<StopPtr>& stops, geo::Meter max_distance)
+        : max_distance_(max_distance) {
+    using namespace std;
+
+    constexpr double pi = 3.14159265358979323846;
+    constexpr double to_degree = 180.0 / pi;
+    constexpr auto mean_earth_radius = geo::Meter{6'371'000.0};
+
+    if (stops.empty() || max_distance <= geo::Meter{0.0}) {
+        return;
+    }
+
+    // The same distance spans more degrees of longitude closer to the poles,
+    // so columns are as wide as needed at the stop that is the farthest from the equator
+    double max_abs_lat = 0.0;
+    for (StopPtr stop_ptr : stops) {
+        max_abs_lat = max(max_abs_lat, abs(stop_ptr->coordinates.lat.Get()));
+    }
+
+    // A small margin covers the curvature of parallels that the linear estimate of columns neglects
+    constexpr double margin = 1.01;
+    cell_lat_size_ = (max_distance / mean_earth_radius) * to_degree * margin;
+    const double cos_lat = cos(max_abs_lat / to_degree);
+    cell_lng_size_ = (cos_lat * 360.0 > cell_lat_size_) ? cell_lat_size_ / cos_lat : 360.0;
+    column_count_ = max<int64_t>(1, static_cast<int64_t>(floor(360.0 / cell_lng_size_)));
+
+    for (StopPtr stop_ptr : stops) {
+        const auto row = static_cast<int64_t>(floor((stop_ptr->coordinates.lat.Get() + 90.0) / cell_lat_size_));
+        const auto column = static_cast<int64_t>(floor((stop_ptr->coordinates.lng.Get() + 180.0) / cell_lng_size_));
+        cells_[GetCellKey(row, column)].push_back(stop_ptr);
+    }
+}
+
+StopGrid::CellKey StopGrid::GetCellKey(std::int64_t row, std::int64_t column) const noexcept {
+    // Columns wrap around the antimeridian
+    column = ((column % column_count_) + column_count_) % column_count_;
+    return static_cast<CellKey>(row) * static_cast<CellKey>(column_count_) + static_cast<CellKey>(column);
+}
+
+std::vector<StopGrid::CellKey> StopGrid::GetFollowingNeighbourKeys(CellKey key) const {
+    const auto row = static_cast<std::int64_t>(key / column_count_);
+    const auto column = static_cast<std::int64_t>(key % column_count_);
+
+    std::vector<CellKey> keys;
+    keys.reserve(8);
+    for (std::int64_t row_shift = -1; row_shift <= 1; ++row_shift) {
+        if (row + row_shift < 0) {
+            continue;
+        }
+        for (std::int64_t column_shift = -1; column_shift <= 1; ++column_shift) {
+            // Each pair of cells is visited once: from the cell with the smaller key
+            if (const CellKey neighbour_key = GetCellKey(row + row_shift, column + column_shift); neighbour_key > key) {
+                keys.push_back(neighbour_key);
+            }
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return keys;
+}
+
+} // namespace transport_catalogue::spatial
\ No newline at end of file
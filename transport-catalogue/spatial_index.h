@@ -0,0 +1,120 @@
+/// \file
+/// Spatial index over stop coordinates for nearest-stop and bounding-box queries
+
+#pragma once
+
+#include "geo.h"
+#include "domain.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+namespace transport_catalogue::spatial {
+
+struct BoundingBox {
+    geo::Coordinates min;
+    geo::Coordinates max;
+
+    [[nodiscard]] bool Contains(geo::Coordinates coordinates) const noexcept;
+};
+
+struct Neighbour {
+    StopPtr stop;
+    geo::Meter distance;
+};
+
+/// Static 2-d tree over (latitude, longitude) packed into a single array:
+/// the median of every subrange is the root of that subrange,
+/// and the split axis alternates between latitude and longitude with depth
+class StopIndex final {
+public:
+    StopIndex() noexcept = default;
+    explicit StopIndex(std::vector<StopPtr> stops);
+
+    /// Restore the index from stops that have been already packed, e.g. by deserialization
+    [[nodiscard]] static StopIndex FromPacked(std::vector<StopPtr> packed_stops) noexcept;
+
+    [[nodiscard]] const std::vector<StopPtr>& GetPackedStops() const noexcept;
+
+    /// Return at most \p count stops sorted by the great-circle distance to \p point
+    [[nodiscard]] std::vector<Neighbour> FindNearest(geo::Coordinates point, std::size_t count) const;
+
+    /// Return stops inside \p box sorted by their names
+    [[nodiscard]] std::vector<StopPtr> FindInBox(BoundingBox box) const;
+
+private:
+    enum class Axis {
+        Latitude,
+        Longitude,
+    };
+
+    std::vector<StopPtr> stops_;
+
+    void Pack(std::size_t first, std::size_t last, Axis axis);
+
+    class NearestSearch;
+
+    void SearchInBox(std::size_t first, std::size_t last, Axis axis,
+                     BoundingBox box, std::vector<StopPtr>& result) const;
+
+    [[nodiscard]] static Axis NextAxis(Axis axis) noexcept;
+    [[nodiscard]] static double GetAxisValue(geo::Coordinates coordinates, Axis axis) noexcept;
+};
+
+/// Uniform grid over stop coordinates whose cells are at least \p max_distance wide,
+/// so stops closer than that lie either in the same cell or in adjacent ones
+class StopGrid final {
+public:
+    StopGrid(const std::vector<StopPtr>& stops, geo::Meter max_distance);
+
+    /// Call \p func(from, to, distance) once for every unordered pair of distinct stops
+    /// that are not farther than \p max_distance from each other
+    template<typename Func>
+    void ForEachClosePair(Func func) const;
+
+private:
+    using CellKey = std::uint64_t;
+
+    geo::Meter max_distance_;
+    double cell_lat_size_ = 0.0;
+    double cell_lng_size_ = 0.0;
+    std::int64_t column_count_ = 1;
+    std::unordered_map<CellKey, std::vector<StopPtr>> cells_;
+
+    [[nodiscard]] CellKey GetCellKey(std::int64_t row, std::int64_t column) const noexcept;
+    [[nodiscard]] std::vector<CellKey> GetFollowingNeighbourKeys(CellKey key) const;
+};
+
+template<typename Func>
+void StopGrid::ForEachClosePair(Func func) const {
+    const auto consider = [this, &func](StopPtr lhs, StopPtr rhs) {
+        if (const auto distance = geo::ComputeDistance(lhs->coordinates, rhs->coordinates);
+                distance <= max_distance_) {
+            func(lhs, rhs, distance);
+        }
+    };
+
+    for (const auto& [key, stops] : cells_) {
+        for (auto lhs = stops.begin(); lhs != stops.end(); ++lhs) {
+            for (auto rhs = std::next(lhs); rhs != stops.end(); ++rhs) {
+                consider(*lhs, *rhs);
+            }
+        }
+        for (const CellKey neighbour_key : GetFollowingNeighbourKeys(key)) {
+            const auto neighbour_iter = cells_.find(neighbour_key);
+            if (neighbour_iter == cells_.end()) {
+                continue;
+            }
+            for (StopPtr lhs : stops) {
+                for (StopPtr rhs : neighbour_iter->second) {
+                    consider(lhs, rhs);
+                }
+            }
+        }
+    }
+}
+
+} // namespace transport_catalogue::spatial
\ No newline at end of file
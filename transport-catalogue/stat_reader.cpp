@@ -3,6 +3,7 @@
 #include "geo.h"
 #include "domain.h"
 #include "request_handler.h"
+#include "responses.h"
 
 #include <iomanip>
 #include <string_view>
@@ -54,17 +55,14 @@ std::ostream& PrintBusInfo(std::ostream& output, std::string_view bus_name, BusI
 }
 
 const PrintDriver& GetTextPrintDriver(std::ostream& output) {
-    using PrintableStopInfo = std::tuple<int, std::string_view, StopInfo>;
-    using PrintableBusInfo = std::tuple<int, std::string_view, BusInfo>;
-
     static PrintDriver driver(output);
-    driver.RegisterPrintOperation<PrintableStopInfo>([](std::ostream& output, const void* object) {
-        const auto [_, name, stop_info] = *reinterpret_cast<const PrintableStopInfo*>(object);
-        PrintStopInfo(output, name, stop_info);
+    driver.RegisterPrintOperation<StopInfoResponse>([](std::ostream& output, const void* object) {
+        const auto& response = *reinterpret_cast<const StopInfoResponse*>(object);
+        PrintStopInfo(output, response.name, response.info);
     });
-    driver.RegisterPrintOperation<PrintableBusInfo>([](std::ostream& output, const void* object) {
-        const auto [_, name, bus_info] = *reinterpret_cast<const PrintableBusInfo*>(object);
-        PrintBusInfo(output, name, bus_info);
+    driver.RegisterPrintOperation<BusInfoResponse>([](std::ostream& output, const void* object) {
+        const auto& response = *reinterpret_cast<const BusInfoResponse*>(object);
+        PrintBusInfo(output, response.name, response.info);
     });
     return driver;
 }
@@ -143,6 +143,14 @@ Circle& Circle::SetRadius(double radius) noexcept {
     return *this;
 }
 
+Point Circle::GetCenter() const noexcept {
+    return center_;
+}
+
+double Circle::GetRadius() const noexcept {
+    return radius_;
+}
+
 void Circle::RenderObject(const RenderContext& context) const {
     auto& output = context.output;
     output << "<circle cx=\""sv << center_.x << "\" cy=\""sv << center_.y << "\""sv;
@@ -158,6 +166,10 @@ Polyline& Polyline::AddPoint(Point point) {
     return *this;
 }
 
+const std::vector<Point>& Polyline::GetPoints() const noexcept {
+    return points_;
+}
+
 void Polyline::RenderObject(const RenderContext& context) const {
     auto& output = context.output;
     output << "<polyline points=\""sv;
@@ -204,6 +216,26 @@ Text& Text::SetData(std::string data) {
     return *this;
 }
 
+Point Text::GetPosition() const noexcept {
+    return start_;
+}
+
+Point Text::GetOffset() const noexcept {
+    return offset_;
+}
+
+std::uint32_t Text::GetFontSize() const noexcept {
+    return font_size_;
+}
+
+const std::string& Text::GetFontWeight() const noexcept {
+    return font_weight_;
+}
+
+const std::string& Text::GetData() const noexcept {
+    return data_;
+}
+
 void Text::RenderObject(const RenderContext& context) const {
     auto& output = context.output;
     output << "<text x=\""sv << start_.x << "\" y=\""sv << start_.y << "\""sv;
@@ -269,18 +301,54 @@ void Text::EscapeText(std::ostream& output) const {
 // Document
 
 void Document::AddPtr(std::unique_ptr<Object>&& object) {
-    objects_.push_back(std::move(object));
+    objects_.emplace_back(std::move(object));
+}
+
+void Document::Reserve(std::size_t object_count) {
+    objects_.reserve(object_count);
+}
+
+std::size_t Document::GetObjectCount() const noexcept {
+    return objects_.size();
 }
 
 void Document::Render(std::ostream& output) const {
+    RenderPart(output, 0, 1);
+}
+
+void Document::RenderPart(std::ostream& output, std::size_t part_index, std::size_t part_count) const {
     const RenderContext context(output, 4, 0);
-    context.RenderIndent();
-    output << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << '\n';
-    output << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << '\n';
-    for (const auto& object : objects_) {
-        object->Render(context.Indented());
+    if (part_index == 0) {
+        context.RenderIndent();
+        output << "<?xml version=\"1.0\" encoding=\"UTF-8\" ?>"sv << '\n';
+        output << "<svg xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">"sv << '\n';
+    }
+
+    const RenderContext object_context = context.Indented();
+    const auto first = objects_.begin() + objects_.size() * part_index / part_count;
+    const auto last = objects_.begin() + objects_.size() * (part_index + 1) / part_count;
+    for (auto iter = first; iter != last; ++iter) {
+        const auto& object = *iter;
+        if (const auto* object_ptr = std::get_if<std::unique_ptr<Object>>(&object)) {
+            (*object_ptr)->Render(object_context);
+            continue;
+        }
+        object_context.RenderIndent();
+        // The types are final, so RenderObject is called directly
+        std::visit([&object_context](const auto& value) {
+            using Value = std::decay_t<decltype(value)>;
+            if constexpr (std::is_same_v<Value, Circle> || std::is_same_v<Value, Polyline> || std::is_same_v<Value, Text>) {
+                value.RenderObject(object_context);
+            } else if constexpr (std::is_pointer_v<Value>) {
+                value->RenderObject(object_context);
+            }
+        }, object);
+        output << '\n';
+    }
+
+    if (part_index + 1 == part_count) {
+        context.RenderIndent();
+        output << "</svg>"sv;
     }
-    context.RenderIndent();
-    output << "</svg>"sv;
 }
 }  // namespace svg
\ No newline at end of file
@@ -3,10 +3,12 @@
 
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
 #include <memory>
 #include <string>
+#include <type_traits>
 #include <vector>
 #include <optional>
 #include <variant>
@@ -113,6 +115,18 @@ public:
         return AsOwner();
     }
 
+    [[nodiscard]] const std::optional<Color>& GetFillColor() const noexcept {
+        return fill_color_;
+    }
+
+    [[nodiscard]] const std::optional<Color>& GetStrokeColor() const noexcept {
+        return stroke_color_;
+    }
+
+    [[nodiscard]] const std::optional<double>& GetStrokeWidth() const noexcept {
+        return stroke_width_;
+    }
+
 protected:
     ~PathProps() = default;
 
@@ -179,7 +193,12 @@ class Circle final : public Object, public PathProps<Circle> {
 public:
     Circle& SetCenter(Point center) noexcept;
     Circle& SetRadius(double radius) noexcept;
+
+    [[nodiscard]] Point GetCenter() const noexcept;
+    [[nodiscard]] double GetRadius() const noexcept;
 private:
+    friend class Document;
+
     void RenderObject(const RenderContext& context) const override;
 
     Point center_;
@@ -191,7 +210,11 @@ private:
 class Polyline final : public Object, public PathProps<Polyline> {
 public:
     Polyline& AddPoint(Point point);
+
+    [[nodiscard]] const std::vector<Point>& GetPoints() const noexcept;
 private:
+    friend class Document;
+
     void RenderObject(const RenderContext& context) const override;
 
     std::vector<Point> points_;
@@ -207,7 +230,15 @@ public:
     Text& SetFontFamily(std::string font_family);
     Text& SetFontWeight(std::string font_weight);
     Text& SetData(std::string data);
+
+    [[nodiscard]] Point GetPosition() const noexcept;
+    [[nodiscard]] Point GetOffset() const noexcept;
+    [[nodiscard]] std::uint32_t GetFontSize() const noexcept;
+    [[nodiscard]] const std::string& GetFontWeight() const noexcept;
+    [[nodiscard]] const std::string& GetData() const noexcept;
 private:
+    friend class Document;
+
     Point start_ = {0.0, 0.0};
     Point offset_ = {0.0, 0.0};
     std::uint32_t font_size_ = 1;
@@ -238,12 +269,64 @@ public:
     virtual void Draw(ObjectContainer& container) const = 0;
 };
 
+/// Circles, polylines and texts are stored by value in the order of adding and rendered without virtual calls;
+/// other objects are stored on the heap. Shapes kept elsewhere, e.g. between renders, can be referenced instead of copied
 class Document final : public ObjectContainer {
 public:
+    template<typename Obj>
+    void Add(Obj object) {
+        static_assert(std::is_base_of_v<Object, Obj>);
+        if constexpr (std::is_same_v<Obj, Circle> || std::is_same_v<Obj, Polyline> || std::is_same_v<Obj, Text>) {
+            objects_.emplace_back(std::move(object));
+        } else {
+            AddPtr(std::make_unique<Obj>(std::move(object)));
+        }
+    }
+
     void AddPtr(std::unique_ptr<Object>&& object) override;
+
+    /// Add \p shape without copying it; the shape must outlive the document
+    template<typename Obj>
+    void AddReference(const Obj& shape) {
+        static_assert(std::is_same_v<Obj, Circle> || std::is_same_v<Obj, Polyline> || std::is_same_v<Obj, Text>);
+        objects_.emplace_back(&shape);
+    }
+
+    void Reserve(std::size_t object_count);
+
+    [[nodiscard]] std::size_t GetObjectCount() const noexcept;
+
     void Render(std::ostream& output) const;
+
+    /// Render one of \p part_count parts of about the same number of objects, e.g. to render parts concurrently.
+    /// The first part starts with the header and the last one ends with the footer, so the parts concatenated in order
+    /// are the same as the output of Render
+    void RenderPart(std::ostream& output, std::size_t part_index, std::size_t part_count) const;
+
+    /// Call \p visitor with every circle, polyline and text in the order of adding, e.g. to draw them
+    /// in another format. Other objects are skipped
+    template<typename Visitor>
+    void ForEachShape(Visitor&& visitor) const {
+        for (const auto& object : objects_) {
+            std::visit([&visitor](const auto& value) {
+                using Value = std::decay_t<decltype(value)>;
+                if constexpr (std::is_same_v<Value, Circle> || std::is_same_v<Value, Polyline> || std::is_same_v<Value, Text>) {
+                    visitor(value);
+                } else if constexpr (std::is_pointer_v<Value>) {
+                    visitor(*value);
+                } else if (const auto* circle = dynamic_cast<const Circle*>(value.get())) {
+                    visitor(*circle);
+                } else if (const auto* polyline = dynamic_cast<const Polyline*>(value.get())) {
+                    visitor(*polyline);
+                } else if (const auto* text = dynamic_cast<const Text*>(value.get())) {
+                    visitor(*text);
+                }
+            }, object);
+        }
+    }
 private:
-    std::vector<std::unique_ptr<Object>> objects_;
+    std::vector<std::variant<Circle, Polyline, Text, std::unique_ptr<Object>,
+                             const Circle*, const Polyline*, const Text*>> objects_;
 };
 
 } // namespace svg
\ No newline at end of file
@@ -0,0 +1,1991 @@
+#include "unit_tests.h"
+#include "unit_test_tools.h"
+
+#include "../geo.h"
+#include "../deflate.h"
+#include "../png.h"
+#include "../raster.h"
+#include "../router.h"
+#include "../json.h"
+#include "../json_view.h"
+#include "../json_reader.h"
+#include "../map_renderer.h"
+#include "../map_viewport.h"
+#include "../queries.h"
+#include "../request_handler.h"
+#include "../responses.h"
+#include "../server.h"
+#include "../simd_scan.h"
+#include "../snapshot.h"
+#include "../spatial_index.h"
+#include "../svg.h"
+#include "../thread_pool.h"
+#include "../transport_catalogue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace unit_tests {
+
+namespace {
+
+using namespace std::string_literals;
+using namespace std::string_view_literals;
+
+namespace from = transport_catalogue::from;
+namespace into = transport_catalogue::into;
+namespace queries = transport_catalogue::queries;
+namespace renderer = transport_catalogue::renderer;
+namespace router = transport_catalogue::router;
+
+/// The tolerance the catalogue relies on when it sums route lengths from precomputed trigonometry
+const geo::DistanceTolerance distance_tolerance{1e-7, geo::Meter{0.25}};
+
+void CheckSegmentDistances(const std::vector<geo::Coordinates>& points) {
+    geo::Path path;
+    path.Reserve(points.size());
+    for (const geo::Coordinates point : points) {
+        path.PushBack(geo::TrigCoordinates(point));
+    }
+    const std::vector<geo::Meter> distances = path.ComputeSegmentDistances();
+
+    ASSERT_EQUAL(distances.size(), points.empty() ? 0 : points.size() - 1);
+    for (std::size_t i = 0; i < distances.size(); ++i) {
+        const geo::Meter expected = geo::ComputeDistance(points[i], points[i + 1]);
+        ASSERT_HINT(geo::IsClose(distances[i], expected, distance_tolerance),
+                    "segment "s + std::to_string(i) + ": "s + std::to_string(distances[i].Get())
+                    + " != "s + std::to_string(expected.Get()));
+        ASSERT_HINT(geo::IsClose(geo::ComputeDistance(geo::TrigCoordinates(points[i]),
+                                                      geo::TrigCoordinates(points[i + 1])),
+                                 expected, distance_tolerance),
+                    "segment "s + std::to_string(i));
+    }
+}
+
+void TestIsClose() {
+    ASSERT(geo::IsClose(geo::Meter{1000.0}, geo::Meter{1000.2}, distance_tolerance));
+    ASSERT(!geo::IsClose(geo::Meter{1000.0}, geo::Meter{1000.3}, distance_tolerance));
+    // The relative part grows with distances
+    ASSERT(geo::IsClose(geo::Meter{1e7}, geo::Meter{1e7 + 1.0}, distance_tolerance));
+    ASSERT(!geo::IsClose(geo::Meter{1e7}, geo::Meter{1e7 + 1.5}, distance_tolerance));
+    ASSERT(!geo::IsClose(geo::Meter{1.0}, geo::Meter{1.0 + 1e-9}, geo::DistanceTolerance{0.0, geo::Meter{0.0}}));
+}
+
+void TestShortPaths() {
+    CheckSegmentDistances({});
+    CheckSegmentDistances({{geo::Degree{55.75}, geo::Degree{37.62}}});
+}
+
+void TestNearIdenticalPoints() {
+    const geo::Coordinates point{geo::Degree{43.587795}, geo::Degree{39.716901}};
+    CheckSegmentDistances({point, point});
+    CheckSegmentDistances({point,
+                           {point.lat, point.lng + geo::Degree{1e-9}},
+                           {point.lat + geo::Degree{1e-9}, point.lng + geo::Degree{1e-9}},
+                           {point.lat + geo::Degree{1e-6}, point.lng}});
+}
+
+void TestAntipodalPoints() {
+    CheckSegmentDistances({{geo::Degree{10.0}, geo::Degree{20.0}},
+                           {geo::Degree{-10.0}, geo::Degree{-160.0}},
+                           {geo::Degree{10.0}, geo::Degree{20.0}}});
+    CheckSegmentDistances({{geo::Degree{90.0}, geo::Degree{0.0}},
+                           {geo::Degree{-90.0}, geo::Degree{0.0}}});
+    // Almost antipodal points are where acos is the least precise
+    CheckSegmentDistances({{geo::Degree{0.0}, geo::Degree{0.0}},
+                           {geo::Degree{1e-6}, geo::Degree{180.0}}});
+}
+
+void TestRandomPoints() {
+    using unit_test_tools::Generator;
+
+    std::vector<geo::Coordinates> points;
+    for (int i = 0; i < 1000; ++i) {
+        points.emplace_back(geo::Degree{Generator<double>::Get(-90.0, 90.0)},
+                            geo::Degree{Generator<double>::Get(-180.0, 180.0)});
+    }
+    CheckSegmentDistances(points);
+
+    // Neighbouring stops of a city
+    std::vector<geo::Coordinates> city_points;
+    for (int i = 0; i < 1000; ++i) {
+        city_points.emplace_back(geo::Degree{Generator<double>::Get(43.5, 43.7)},
+                                 geo::Degree{Generator<double>::Get(39.6, 39.8)});
+    }
+    CheckSegmentDistances(city_points);
+}
+
+using transport_catalogue::StopPtr;
+using transport_catalogue::spatial::BoundingBox;
+using transport_catalogue::spatial::Neighbour;
+
+void AddRandomStops(transport_catalogue::TransportCatalogue& database, int count,
+                    geo::Coordinates min, geo::Coordinates max) {
+    using unit_test_tools::Generator;
+
+    const auto stops = database.GetAllStops();
+    const auto first_number = std::distance(stops.begin(), stops.end());
+    for (int i = 0; i < count; ++i) {
+        database.AddStop({"Stop "s + std::to_string(first_number + i),
+                          {geo::Degree{Generator<double>::Get(min.lat.Get(), max.lat.Get())},
+                           geo::Degree{Generator<double>::Get(min.lng.Get(), max.lng.Get())}},
+                          {}});
+    }
+}
+
+std::vector<std::string> GetNames(const std::vector<StopPtr>& stops) {
+    std::vector<std::string> names;
+    names.reserve(stops.size());
+    for (StopPtr stop_ptr : stops) {
+        names.push_back(stop_ptr->name);
+    }
+    return names;
+}
+
+void CheckNearestStops(const transport_catalogue::TransportCatalogue& database,
+                       geo::Coordinates point, std::size_t count) {
+    std::vector<Neighbour> expected;
+    for (const auto& stop : database.GetAllStops()) {
+        expected.push_back({&stop, geo::ComputeDistance(point, stop.coordinates)});
+    }
+    std::sort(expected.begin(), expected.end(), [](const Neighbour& lhs, const Neighbour& rhs) {
+        return lhs.distance != rhs.distance ? lhs.distance < rhs.distance : lhs.stop->name < rhs.stop->name;
+    });
+    expected.resize(std::min(count, expected.size()));
+
+    const auto neighbours = database.FindNearestStops(point, count);
+    const std::string hint = "near "s + std::to_string(point.lat.Get()) + ", "s + std::to_string(point.lng.Get());
+    ASSERT_EQUAL_HINT(neighbours.size(), expected.size(), hint);
+    for (std::size_t i = 0; i < expected.size(); ++i) {
+        ASSERT_EQUAL_HINT(neighbours[i].stop->name, expected[i].stop->name, hint);
+        ASSERT_EQUAL_HINT(neighbours[i].distance.Get(), expected[i].distance.Get(), hint);
+    }
+}
+
+void CheckStopsInBox(const transport_catalogue::TransportCatalogue& database, BoundingBox box) {
+    std::vector<StopPtr> expected;
+    for (const auto& stop : database.GetAllStops()) {
+        if (box.Contains(stop.coordinates)) {
+            expected.push_back(&stop);
+        }
+    }
+    std::sort(expected.begin(), expected.end(), [](StopPtr lhs, StopPtr rhs) {
+        return lhs->name < rhs->name;
+    });
+    ASSERT_EQUAL(GetNames(database.FindStopsInBox(box)), GetNames(expected));
+}
+
+void TestNearestStops() {
+    using unit_test_tools::Generator;
+
+    transport_catalogue::TransportCatalogue database;
+    CheckNearestStops(database, {geo::Degree{43.6}, geo::Degree{39.7}}, 3);
+
+    AddRandomStops(database, 1000, {geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}});
+    for (int i = 0; i < 100; ++i) {
+        const geo::Coordinates point{geo::Degree{Generator<double>::Get(43.4, 43.8)},
+                                     geo::Degree{Generator<double>::Get(39.5, 39.9)}};
+        CheckNearestStops(database, point, 0);
+        CheckNearestStops(database, point, 1);
+        CheckNearestStops(database, point, 7);
+    }
+    CheckNearestStops(database, {geo::Degree{43.6}, geo::Degree{39.7}}, 2000);
+
+    // Stops added after a query are found by the next one
+    database.AddStop({"Center"s, {geo::Degree{43.6}, geo::Degree{39.7}}, {}});
+    ASSERT_EQUAL(database.FindNearestStops({geo::Degree{43.6}, geo::Degree{39.7}}, 1).front().stop->name, "Center"s);
+}
+
+void TestNearestStopsAcrossAntimeridian() {
+    using unit_test_tools::Generator;
+
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 300, {geo::Degree{-20.0}, geo::Degree{175.0}}, {geo::Degree{20.0}, geo::Degree{180.0}});
+    AddRandomStops(database, 300, {geo::Degree{-20.0}, geo::Degree{-180.0}}, {geo::Degree{20.0}, geo::Degree{-175.0}});
+    AddRandomStops(database, 100, {geo::Degree{-80.0}, geo::Degree{-180.0}}, {geo::Degree{80.0}, geo::Degree{180.0}});
+
+    // The nearest stops of a point at one side of the antimeridian lie at the other side
+    database.AddStop({"East"s, {geo::Degree{0.0}, geo::Degree{-179.999}}, {}});
+    const auto neighbours = database.FindNearestStops({geo::Degree{0.0}, geo::Degree{179.999}}, 1);
+    ASSERT_EQUAL(neighbours.front().stop->name, "East"s);
+
+    for (int i = 0; i < 100; ++i) {
+        const double lng = Generator<double>::Get(179.0, 180.0);
+        const geo::Coordinates point{geo::Degree{Generator<double>::Get(-20.0, 20.0)},
+                                     geo::Degree{(i % 2 == 0) ? lng : -lng}};
+        CheckNearestStops(database, point, 1);
+        CheckNearestStops(database, point, 10);
+    }
+}
+
+void TestStopsInBox() {
+    using unit_test_tools::Generator;
+
+    transport_catalogue::TransportCatalogue database;
+    CheckStopsInBox(database, {{geo::Degree{-90.0}, geo::Degree{-180.0}}, {geo::Degree{90.0}, geo::Degree{180.0}}});
+
+    AddRandomStops(database, 1000, {geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}});
+    for (int i = 0; i < 100; ++i) {
+        const double lat = Generator<double>::Get(43.4, 43.8);
+        const double lng = Generator<double>::Get(39.5, 39.9);
+        CheckStopsInBox(database, {{geo::Degree{lat}, geo::Degree{lng}},
+                                   {geo::Degree{lat + Generator<double>::Get(0.0, 0.1)},
+                                    geo::Degree{lng + Generator<double>::Get(0.0, 0.1)}}});
+    }
+    // An empty box, a point box and the whole world
+    CheckStopsInBox(database, {{geo::Degree{43.7}, geo::Degree{39.8}}, {geo::Degree{43.5}, geo::Degree{39.6}}});
+    const auto& stop = *database.GetAllStops().begin();
+    CheckStopsInBox(database, {stop.coordinates, stop.coordinates});
+    CheckStopsInBox(database, {{geo::Degree{-90.0}, geo::Degree{-180.0}}, {geo::Degree{90.0}, geo::Degree{180.0}}});
+}
+
+void TestStopsInBoxAtAntimeridian() {
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 500, {geo::Degree{-20.0}, geo::Degree{170.0}}, {geo::Degree{20.0}, geo::Degree{180.0}});
+    AddRandomStops(database, 500, {geo::Degree{-20.0}, geo::Degree{-180.0}}, {geo::Degree{20.0}, geo::Degree{-170.0}});
+    database.AddStop({"West edge"s, {geo::Degree{0.0}, geo::Degree{180.0}}, {}});
+    database.AddStop({"East edge"s, {geo::Degree{0.0}, geo::Degree{-180.0}}, {}});
+
+    CheckStopsInBox(database, {{geo::Degree{-10.0}, geo::Degree{175.0}}, {geo::Degree{10.0}, geo::Degree{180.0}}});
+    CheckStopsInBox(database, {{geo::Degree{-10.0}, geo::Degree{-180.0}}, {geo::Degree{10.0}, geo::Degree{-175.0}}});
+    CheckStopsInBox(database, {{geo::Degree{0.0}, geo::Degree{180.0}}, {geo::Degree{0.0}, geo::Degree{180.0}}});
+}
+
+void CheckClosePairs(const transport_catalogue::TransportCatalogue& database, geo::Meter max_distance) {
+    std::vector<StopPtr> stops;
+    for (const auto& stop : database.GetAllStops()) {
+        stops.push_back(&stop);
+    }
+
+    using NamePair = std::pair<std::string, std::string>;
+    const auto make_pair = [](StopPtr lhs, StopPtr rhs) {
+        return lhs->name < rhs->name ? NamePair{lhs->name, rhs->name} : NamePair{rhs->name, lhs->name};
+    };
+
+    std::vector<NamePair> expected;
+    for (auto lhs = stops.begin(); lhs != stops.end(); ++lhs) {
+        for (auto rhs = std::next(lhs); rhs != stops.end(); ++rhs) {
+            if (geo::ComputeDistance((*lhs)->coordinates, (*rhs)->coordinates) <= max_distance) {
+                expected.push_back(make_pair(*lhs, *rhs));
+            }
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    std::vector<NamePair> pairs;
+    transport_catalogue::spatial::StopGrid(stops, max_distance).ForEachClosePair(
+            [&](StopPtr lhs, StopPtr rhs, geo::Meter distance) {
+                ASSERT_EQUAL(distance.Get(), geo::ComputeDistance(lhs->coordinates, rhs->coordinates).Get());
+                pairs.push_back(make_pair(lhs, rhs));
+            });
+    std::sort(pairs.begin(), pairs.end());
+    // Each pair is reported once
+    ASSERT(std::adjacent_find(pairs.begin(), pairs.end()) == pairs.end());
+    ASSERT_EQUAL_HINT(pairs.size(), expected.size(), "within "s + std::to_string(max_distance.Get()) + " m"s);
+    ASSERT(pairs == expected);
+}
+
+void TestClosePairs() {
+    transport_catalogue::TransportCatalogue database;
+    CheckClosePairs(database, geo::Meter{500.0});
+
+    AddRandomStops(database, 1000, {geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}});
+    CheckClosePairs(database, geo::Meter{0.0});
+    CheckClosePairs(database, geo::Meter{100.0});
+    CheckClosePairs(database, geo::Meter{500.0});
+    CheckClosePairs(database, geo::Meter{5000.0});
+}
+
+void TestClosePairsAcrossAntimeridian() {
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 500, {geo::Degree{-0.1}, geo::Degree{179.95}}, {geo::Degree{0.1}, geo::Degree{180.0}});
+    AddRandomStops(database, 500, {geo::Degree{-0.1}, geo::Degree{-180.0}}, {geo::Degree{0.1}, geo::Degree{-179.95}});
+    database.AddStop({"West edge"s, {geo::Degree{0.0}, geo::Degree{180.0}}, {}});
+    database.AddStop({"East edge"s, {geo::Degree{0.0}, geo::Degree{-180.0}}, {}});
+
+    CheckClosePairs(database, geo::Meter{200.0});
+    CheckClosePairs(database, geo::Meter{1000.0});
+}
+
+void TestClosePairsAtHighLatitudes() {
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 500, {geo::Degree{69.9}, geo::Degree{-180.0}}, {geo::Degree{70.1}, geo::Degree{180.0}});
+    AddRandomStops(database, 300, {geo::Degree{89.9}, geo::Degree{-180.0}}, {geo::Degree{90.0}, geo::Degree{180.0}});
+    AddRandomStops(database, 300, {geo::Degree{-90.0}, geo::Degree{-180.0}}, {geo::Degree{-89.95}, geo::Degree{180.0}});
+
+    // Stops around a pole are close whatever their longitudes are
+    CheckClosePairs(database, geo::Meter{1000.0});
+    CheckClosePairs(database, geo::Meter{5000.0});
+    CheckClosePairs(database, geo::Meter{50000.0});
+}
+
+void TestStopIndexIsBuiltOnce() {
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 10000, {geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}});
+
+    // The first spatial queries of a fresh catalogue run concurrently, e.g. while tiles are rasterized
+    const BoundingBox box{{geo::Degree{43.55}, geo::Degree{39.65}}, {geo::Degree{43.65}, geo::Degree{39.75}}};
+    constexpr std::size_t query_count = 16;
+    std::vector<std::vector<StopPtr>> results(query_count);
+    thread_pool::ThreadPool pool(4);
+    pool.ParallelFor(query_count, [&database, &results, box](std::size_t index) {
+        results[index] = database.FindStopsInBox(box);
+    });
+    for (const auto& result : results) {
+        ASSERT(result == results.front());
+        ASSERT(&database.GetStopIndex() == &database.GetStopIndex());
+    }
+    CheckStopsInBox(database, box);
+}
+
+void TestStopIndexFollowsAddedStops() {
+    transport_catalogue::TransportCatalogue database;
+    AddRandomStops(database, 100, {geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}});
+    const BoundingBox box{{geo::Degree{43.5}, geo::Degree{39.6}}, {geo::Degree{43.7}, geo::Degree{39.8}}};
+    ASSERT_EQUAL(database.FindStopsInBox(box).size(), 100u);
+
+    // Stops added after the index is built are found by later queries
+    database.AddStop({"Added"s, {geo::Degree{43.6}, geo::Degree{39.7}}, {}});
+    ASSERT_EQUAL(database.FindStopsInBox(box).size(), 101u);
+    ASSERT_EQUAL(database.FindNearestStops({geo::Degree{43.6}, geo::Degree{39.7}}, 1).front().stop->name, "Added"s);
+    CheckStopsInBox(database, box);
+}
+
+void TestPrecomputedStatistics() {
+    using unit_test_tools::Generator;
+    using transport_catalogue::Bus;
+
+    // Both catalogues get the same stops, distances and buses
+    transport_catalogue::TransportCatalogue lazy;
+    transport_catalogue::TransportCatalogue precomputed;
+    constexpr int stop_count = 300;
+    const auto get_stop_name = [](int index) {
+        return "Stop "s + std::to_string(index);
+    };
+    for (int i = 0; i < stop_count; ++i) {
+        const geo::Coordinates coordinates{geo::Degree{Generator<double>::Get(43.5, 43.7)},
+                                           geo::Degree{Generator<double>::Get(39.6, 39.8)}};
+        lazy.AddStop({get_stop_name(i), coordinates, {}});
+        precomputed.AddStop({get_stop_name(i), coordinates, {}});
+    }
+    for (int i = 0; i < 200; ++i) {
+        const auto route_type = (i % 2 == 0) ? Bus::RouteType::Full : Bus::RouteType::Half;
+        std::vector<std::string> stop_names;
+        for (int j = Generator<int>::Get(2, 20); j > 0; --j) {
+            // Repeated stops are counted once among unique ones
+            stop_names.push_back(get_stop_name(Generator<int>::Get(0, (i % 10 == 0) ? 5 : stop_count - 1)));
+        }
+        if (route_type == Bus::RouteType::Full) {
+            stop_names.push_back(stop_names.front());
+        }
+        for (std::size_t j = 1; j < stop_names.size(); ++j) {
+            // Distances are set in one direction or in both with different values
+            const geo::Meter distance{Generator<double>::Get(100.0, 3000.0)};
+            const bool is_reversed = Generator<int>::Get(0, 1) == 0;
+            const auto& from = is_reversed ? stop_names[j] : stop_names[j - 1];
+            const auto& to = is_reversed ? stop_names[j - 1] : stop_names[j];
+            for (auto* database : {&lazy, &precomputed}) {
+                database->SetDistanceBetweenStops(from, to, distance);
+            }
+            if (j % 3 == 0) {
+                for (auto* database : {&lazy, &precomputed}) {
+                    database->SetDistanceBetweenStops(to, from, distance + geo::Meter{50.0});
+                }
+            }
+        }
+        lazy.AddBus("Bus "s + std::to_string(i), stop_names, route_type);
+        precomputed.AddBus("Bus "s + std::to_string(i), stop_names, route_type);
+    }
+
+    thread_pool::ThreadPool pool(4);
+    precomputed.PrecomputeStatistics(pool);
+
+    for (int i = 0; i < 200; ++i) {
+        const auto name = "Bus "s + std::to_string(i);
+        const auto* expected = lazy.GetBusInfo(name).value();
+        const auto* info = precomputed.GetBusInfo(name).value();
+        ASSERT_EQUAL_HINT(info->stops_count, expected->stops_count, name);
+        ASSERT_EQUAL_HINT(info->unique_stops_count, expected->unique_stops_count, name);
+        ASSERT_EQUAL_HINT(info->length.route.Get(), expected->length.route.Get(), name);
+        ASSERT_EQUAL_HINT(info->length.geo.Get(), expected->length.geo.Get(), name);
+    }
+    const auto get_bus_names = [](const transport_catalogue::TransportCatalogue::StopInfo& info) {
+        std::vector<std::string> names;
+        for (transport_catalogue::BusPtr bus_ptr : info.buses) {
+            names.push_back(bus_ptr->name);
+        }
+        return names;
+    };
+    for (int i = 0; i < stop_count; ++i) {
+        const auto name = get_stop_name(i);
+        ASSERT_EQUAL_HINT(get_bus_names(*precomputed.GetStopInfo(name).value()),
+                          get_bus_names(*lazy.GetStopInfo(name).value()), name);
+    }
+    ASSERT(!precomputed.GetBusInfo("Bus 200"sv).has_value());
+    ASSERT(!precomputed.GetStopInfo("No stop"sv).has_value());
+}
+
+/// A catalogue with its renderer and router, filled e.g. by lines of process_stream
+struct TestBase {
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler{database, renderer, router};
+
+    explicit TestBase(router::Settings settings) {
+        handler.InitializeRouterSettings(settings);
+        handler.InitializeRouter();
+    }
+
+    /// Answer \p line of process_stream
+    std::string ProcessLine(std::string_view line) {
+        std::ostringstream output;
+        into::JsonLineProcessor processor(handler, output);
+        processor.ProcessLine(line);
+        return output.str();
+    }
+};
+
+router::Settings MakeRouterSettings(unsigned int walking_stop_count = 2) {
+    router::Settings settings;
+    settings.bus_wait_time = router::Minute{1.0};
+    settings.bus_velocity = router::KmPerHour{60.0};
+    settings.walking_velocity = router::KmPerHour{5.0};
+    settings.walking_stop_count = walking_stop_count;
+    return settings;
+}
+
+/// Stops along a meridian: A and B are 1.1 km apart, C is 10 km further north
+const std::string_view meridian_base = R"({"base_requests": [)"
+        R"({"type": "Stop", "name": "A", "latitude": 55.600, "longitude": 37.0, "road_distances": {"B": 1100}},)"
+        R"({"type": "Stop", "name": "B", "latitude": 55.610, "longitude": 37.0, "road_distances": {"C": 10000}},)"
+        R"({"type": "Stop", "name": "C", "latitude": 55.700, "longitude": 37.0, "road_distances": {}},)"
+        R"({"type": "Bus", "name": "1", "stops": ["A", "B", "C"], "is_roundtrip": false}]})"sv;
+
+router::Minute ComputeWalkTime(geo::Coordinates from, geo::Coordinates to) {
+    return router::Minute::ComputeTime(geo::ComputeDistance(from, to), MakeRouterSettings().walking_velocity);
+}
+
+bool IsClose(double lhs, double rhs, double tolerance = 1e-6) {
+    return std::abs(lhs - rhs) < tolerance;
+}
+
+void TestMultiSourceRoute() {
+    using Router = graph::Router<double>;
+    graph::DirectedWeightedGraph<double> graph(5);
+    graph.AddEdge({0, 2, 5.0});
+    graph.AddEdge({1, 2, 1.0});
+    graph.AddEdge({2, 3, 1.0});
+    graph.AddEdge({1, 3, 10.0});
+    graph.AddEdge({0, 3, 4.0});
+    const Router router(graph);
+
+    const std::vector<std::vector<Router::Endpoint>> endpoint_sets{
+            {{0, 0.0}, {1, 3.0}}, {{0, 2.0}, {1, 0.0}}, {{1, 0.0}}, {{4, 0.0}}, {{2, 0.0}, {4, 1.0}},
+            {{3, 0.5}, {2, 0.0}}, {{3, 0.0}}, {{2, 2.0}, {3, 0.0}}, {}};
+    for (const auto& sources : endpoint_sets) {
+        for (const auto& targets : endpoint_sets) {
+            // The best of all pairs of single-source routes
+            std::optional<double> expected_weight;
+            for (const auto& source : sources) {
+                for (const auto& target : targets) {
+                    if (const auto route = router.BuildRoute(source.vertex, target.vertex)) {
+                        const double weight = source.weight + route->weight + target.weight;
+                        expected_weight = expected_weight ? std::min(*expected_weight, weight) : weight;
+                    }
+                }
+            }
+
+            const auto route = router.BuildRoute(sources, targets);
+            ASSERT_EQUAL(route.has_value(), expected_weight.has_value());
+            if (route) {
+                const auto& source = sources.at(route->source_index);
+                const auto& target = targets.at(route->target_index);
+                ASSERT_EQUAL(source.weight + route->route.weight + target.weight, *expected_weight);
+                // The winning route is reconstructed between the chosen endpoints
+                double edge_weight = 0.0;
+                graph::VertexId vertex = source.vertex;
+                for (const auto edge_id : route->route.edges) {
+                    ASSERT_EQUAL(graph.GetEdge(edge_id).from, vertex);
+                    vertex = graph.GetEdge(edge_id).to;
+                    edge_weight += graph.GetEdge(edge_id).weight;
+                }
+                ASSERT_EQUAL(vertex, target.vertex);
+                ASSERT_EQUAL(edge_weight, route->route.weight);
+            }
+        }
+    }
+}
+
+void TestAddressRouteWalksToStops() {
+    TestBase base(MakeRouterSettings());
+    ASSERT_EQUAL(base.ProcessLine(meridian_base), ""s);
+
+    const geo::Coordinates from{geo::Degree{55.599}, geo::Degree{37.0}};
+    const geo::Coordinates to{geo::Degree{55.701}, geo::Degree{37.0}};
+    const auto route = base.handler.GetRouteBetweenPoints(from, to);
+    ASSERT(route);
+    const auto stop_a = base.handler.FindStopBy("A"sv).value();
+    const auto stop_c = base.handler.FindStopBy("C"sv).value();
+    ASSERT(route.GetStartWalk().has_value() && route.GetStartWalk()->stop == stop_a);
+    ASSERT(route.GetFinishWalk().has_value() && route.GetFinishWalk()->stop == stop_c);
+    ASSERT(IsClose(route.GetStartWalk()->time.Get(), ComputeWalkTime(from, stop_a->coordinates).Get()));
+    ASSERT(IsClose(route.GetFinishWalk()->time.Get(), ComputeWalkTime(stop_c->coordinates, to).Get()));
+    // Waiting for a minute and riding 11.1 km at 60 km/h
+    ASSERT(IsClose(route.GetTotalTime().Get(),
+                   route.GetStartWalk()->time.Get() + 1.0 + 11.1 + route.GetFinishWalk()->time.Get()));
+
+    // The first walk names the stop it leads to, and the last one the stop it starts from
+    const auto answer = base.ProcessLine(
+            R"({"stat_requests": [{"type": "Route", "id": 1, "from": {"latitude": 55.599, "longitude": 37.0},)"
+            R"( "to": {"latitude": 55.701, "longitude": 37.0}}]})"sv);
+    const auto items = json::Load(answer).GetRoot().AsDict().at("items"s).AsArray();
+    ASSERT_EQUAL(items.front().AsDict().at("type"s).AsString(), "Walk"s);
+    ASSERT_EQUAL(items.front().AsDict().at("to"s).AsString(), "A"s);
+    ASSERT(items.front().AsDict().count("from"s) == 0);
+    ASSERT_EQUAL(items.back().AsDict().at("type"s).AsString(), "Walk"s);
+    ASSERT_EQUAL(items.back().AsDict().at("from"s).AsString(), "C"s);
+    ASSERT(items.back().AsDict().count("to"s) == 0);
+}
+
+void TestAddressRouteWalksDirectly() {
+    TestBase base(MakeRouterSettings());
+    ASSERT_EQUAL(base.ProcessLine(meridian_base), ""s);
+
+    // Walking between addresses midway from A to B is faster than reaching a stop and waiting for the bus
+    const geo::Coordinates from{geo::Degree{55.603}, geo::Degree{37.0}};
+    const geo::Coordinates to{geo::Degree{55.606}, geo::Degree{37.0}};
+    const auto route = base.handler.GetRouteBetweenPoints(from, to);
+    ASSERT(route);
+    ASSERT(route.begin() == route.end());
+    ASSERT(route.GetStartWalk().has_value() && route.GetStartWalk()->stop == nullptr);
+    ASSERT(!route.GetFinishWalk().has_value());
+    ASSERT(IsClose(route.GetTotalTime().Get(), ComputeWalkTime(from, to).Get()));
+
+    const auto answer = base.ProcessLine(
+            R"({"stat_requests": [{"type": "Route", "id": 1, "from": {"latitude": 55.603, "longitude": 37.0},)"
+            R"( "to": {"latitude": 55.606, "longitude": 37.0}}]})"sv);
+    const auto items = json::Load(answer).GetRoot().AsDict().at("items"s).AsArray();
+    ASSERT_EQUAL(items.size(), 1u);
+    ASSERT_EQUAL(items.front().AsDict().at("type"s).AsString(), "Walk"s);
+    ASSERT(items.front().AsDict().count("to"s) == 0);
+}
+
+void TestAddressRouteWithoutWalkingStops() {
+    TestBase base(MakeRouterSettings(0));
+    ASSERT_EQUAL(base.ProcessLine(meridian_base), ""s);
+
+    // No stops are reached on foot, so even a long trip is walked
+    const geo::Coordinates from{geo::Degree{55.599}, geo::Degree{37.0}};
+    const geo::Coordinates to{geo::Degree{55.701}, geo::Degree{37.0}};
+    const auto route = base.handler.GetRouteBetweenPoints(from, to);
+    ASSERT(route);
+    ASSERT(route.begin() == route.end());
+    ASSERT(route.GetStartWalk().has_value() && route.GetStartWalk()->stop == nullptr);
+    ASSERT(IsClose(route.GetTotalTime().Get(), ComputeWalkTime(from, to).Get()));
+}
+
+void TestRouteWalksBetweenCloseStops() {
+    // B and C are about 111 m apart, but no bus connects them
+    const auto two_lines_base = R"({"base_requests": [)"
+            R"({"type": "Stop", "name": "A", "latitude": 55.600, "longitude": 37.0, "road_distances": {"B": 2000}},)"
+            R"({"type": "Stop", "name": "B", "latitude": 55.618, "longitude": 37.0, "road_distances": {}},)"
+            R"({"type": "Stop", "name": "C", "latitude": 55.619, "longitude": 37.0, "road_distances": {"D": 2000}},)"
+            R"({"type": "Stop", "name": "D", "latitude": 55.637, "longitude": 37.0, "road_distances": {}},)"
+            R"({"type": "Bus", "name": "1", "stops": ["A", "B"], "is_roundtrip": false},)"
+            R"({"type": "Bus", "name": "2", "stops": ["C", "D"], "is_roundtrip": false}]})"sv;
+    const auto route_request = R"({"stat_requests": [{"type": "Route", "id": 1, "from": "A", "to": "D"}]})"sv;
+
+    TestBase without_walks(MakeRouterSettings());
+    ASSERT_EQUAL(without_walks.ProcessLine(two_lines_base), ""s);
+    ASSERT_EQUAL(without_walks.ProcessLine(route_request), R"({"error_message":"not found","request_id":1})"s + "\n"s);
+
+    auto settings = MakeRouterSettings();
+    settings.max_walk_distance = geo::Meter{150.0};
+    TestBase with_walks(settings);
+    ASSERT_EQUAL(with_walks.ProcessLine(two_lines_base), ""s);
+    const auto answer = with_walks.ProcessLine(route_request);
+    const auto items = json::Load(answer).GetRoot().AsDict().at("items"s).AsArray();
+
+    std::vector<std::string> types;
+    for (const auto& item : items) {
+        types.push_back(item.AsDict().at("type"s).AsString());
+    }
+    ASSERT_EQUAL_HINT(types, (std::vector{"Wait"s, "Bus"s, "Walk"s, "Wait"s, "Bus"s}), answer);
+    const auto& walk = items.at(2).AsDict();
+    ASSERT_EQUAL(walk.at("from"s).AsString(), "B"s);
+    ASSERT_EQUAL(walk.at("to"s).AsString(), "C"s);
+    const auto stop_b = with_walks.handler.FindStopBy("B"sv).value();
+    const auto stop_c = with_walks.handler.FindStopBy("C"sv).value();
+    // Times are printed with 6 significant digits
+    ASSERT(IsClose(walk.at("time"s).AsDouble(), ComputeWalkTime(stop_b->coordinates, stop_c->coordinates).Get(), 1e-4));
+}
+
+/// Bytes of \p hex, e.g. golden outputs checked once with zlib and gzip
+std::string FromHex(std::string_view hex) {
+    std::string bytes;
+    bytes.reserve(hex.size() / 2);
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        bytes.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+    }
+    return bytes;
+}
+
+void TestChecksums() {
+    ASSERT_EQUAL(deflate::Crc32(""), 0u);
+    ASSERT_EQUAL(deflate::Crc32("123456789"), 0xCBF43926u);
+    ASSERT_EQUAL(deflate::Crc32("6789", deflate::Crc32("12345")), 0xCBF43926u);
+    ASSERT_EQUAL(deflate::Adler32(""), 1u);
+    ASSERT_EQUAL(deflate::Adler32("Wikipedia"), 0x11E60398u);
+    ASSERT_EQUAL(deflate::Adler32("pedia", deflate::Adler32("Wiki")), 0x11E60398u);
+}
+
+void TestDeflateGoldenBytes() {
+    ASSERT_EQUAL(deflate::Compress(""), FromHex("05c181000000000010ffd508"sv));
+    ASSERT_EQUAL(deflate::CompressZlib(""), FromHex("789c05c181000000000010ffd50800000001"sv));
+    ASSERT_EQUAL(deflate::CompressZlib("a"), FromHex("789c05c18100000000009056ff131000620062"sv));
+    ASSERT_EQUAL(deflate::CompressZlib("abcabcabcabcabcabcabcabc"),
+                 FromHex("789c6dc2010d00000082b0ac4aff0e14e0fb4e1672e00931"sv));
+    ASSERT_EQUAL(deflate::CompressGzip("hello, world\n"),
+                 FromHex("1f8b08000000000000ff05c1b10900000803c1de291cc0b1142c1e0236ae9fbb1d50e5ebe830537424f40d000000"sv));
+}
+
+void TestPngGoldenBytes() {
+    ASSERT_EQUAL(png::Encode(1, 1, {255, 0, 0, 255}),
+                 FromHex("89504e470d0a1a0a0000000d49484452000000010000000108060000001f15c489"
+                         "0000001449444154789c05c101010000008010ff4f17a201050001ff2a0880ee"
+                         "0000000049454e44ae426082"sv));
+    ASSERT_EQUAL(png::Encode(2, 1, {0, 0, 0, 0, 255, 255, 255, 128}),
+                 FromHex("89504e470d0a1a0a0000000d4948445200000002000000010806000000f4227f8a"
+                         "0000001549444154789c15c1810d0000000120a7fb3c5339740980037e2ff0fb83"
+                         "0000000049454e44ae426082"sv));
+}
+
+void TestRasterizeScaled() {
+    svg::Document document;
+    document.Add(svg::Circle().SetCenter({40.0, 40.0}).SetRadius(8.0).SetFillColor("black"s));
+
+    // A canvas of 100 units drawn into a tile of 25 pixels
+    const auto image = raster::Rasterize(document, 25, 25, 0.25);
+    ASSERT_EQUAL(image.width, 25u);
+    ASSERT_EQUAL(image.height, 25u);
+    const auto alpha = [&image](std::size_t x, std::size_t y) {
+        return image.rgba[(y * image.width + x) * 4 + 3];
+    };
+    ASSERT_EQUAL(alpha(10, 10), std::uint8_t{255});
+    ASSERT_EQUAL(alpha(0, 0), std::uint8_t{0});
+    ASSERT_EQUAL(alpha(14, 10), std::uint8_t{0});
+}
+
+renderer::Settings MakeRenderSettings() {
+    renderer::Settings settings;
+    settings.width = 600.0;
+    settings.height = 400.0;
+    settings.padding = 50.0;
+    settings.line_width = 14.0;
+    settings.stop_radius = 5.0;
+    settings.underlayer_width = 3.0;
+    settings.bus_label_font_size = 20;
+    settings.stop_label_font_size = 18;
+    settings.bus_label_offset = {7.0, 15.0};
+    settings.stop_label_offset = {7.0, -3.0};
+    settings.underlayer_color = svg::color::Rgba{255, 255, 255, 0.85};
+    settings.color_palette = {"green"s, svg::color::Rgb{255, 160, 0}, "red"s};
+    return settings;
+}
+
+void TestStreamedBusesRenderLikeWholeMap() {
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler(database, renderer, router);
+    handler.InitializeMapRenderer(MakeRenderSettings());
+    router::Settings router_settings;
+    router_settings.bus_wait_time = router::Minute{2.0};
+    router_settings.bus_velocity = router::KmPerHour{30.0};
+    handler.InitializeRouterSettings(router_settings);
+    handler.InitializeRouter();
+
+    std::ostringstream output;
+    into::JsonLineProcessor processor(handler, output);
+    const std::vector<std::string_view> lines = {
+            R"({"base_requests": [)"
+            R"({"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.20, "road_distances": {"B": 3000}},)"
+            R"({"type": "Stop", "name": "B", "latitude": 55.62, "longitude": 37.25, "road_distances": {"C": 2500}},)"
+            R"({"type": "Stop", "name": "C", "latitude": 55.61, "longitude": 37.30, "road_distances": {}},)"
+            R"({"type": "Bus", "name": "14", "stops": ["A", "B", "C"], "is_roundtrip": false}]})"sv,
+            // Known stops only, so the projection is kept
+            R"({"base_requests": [{"type": "Bus", "name": "01", "stops": ["C", "B"], "is_roundtrip": false}]})"sv,
+            // A stop inside the bounding box
+            R"({"base_requests": [)"
+            R"({"type": "Stop", "name": "D", "latitude": 55.61, "longitude": 37.22, "road_distances": {"A": 1500}},)"
+            R"({"type": "Bus", "name": "20", "stops": ["D", "A", "D"], "is_roundtrip": true}]})"sv,
+            // Stops that grow the bounding box
+            R"({"base_requests": [)"
+            R"({"type": "Stop", "name": "E", "latitude": 55.70, "longitude": 37.40, "road_distances": {"C": 9000}},)"
+            R"({"type": "Stop", "name": "F", "latitude": 55.50, "longitude": 37.10, "road_distances": {"A": 7000}},)"
+            R"({"type": "Bus", "name": "7", "stops": ["F", "A", "B", "C", "E"], "is_roundtrip": false}]})"sv,
+    };
+    for (const auto line : lines) {
+        // The map is rendered between the lines, so that the next one only adds fragments to it
+        const auto rendered_map = handler.GetRenderedMap();
+        processor.ProcessLine(line);
+        ASSERT_EQUAL_HINT(output.str(), ""s, std::string(line));
+
+        const queries::RenderedMap expected_map(handler.RenderMap());
+        ASSERT_HINT(handler.GetRenderedMap()->json_image == expected_map.json_image, std::string(line));
+    }
+
+    processor.ProcessLine(R"({"type": "Route", "id": 1, "from": "F", "to": "E"})"sv);
+    ASSERT_HINT(output.str().find(R"("request_id":1,"total_time")"sv) != std::string::npos, output.str());
+}
+
+void TestMapIsEncodedOnce() {
+    const queries::RenderedMap rendered_map(json::EscapedString("<svg>\"map\"</svg>"sv));
+
+    // Workers answering map queries at once share a single compressed map
+    constexpr std::size_t query_count = 16;
+    std::vector<const json::EscapedString*> results(query_count);
+    thread_pool::ThreadPool pool(4);
+    pool.ParallelFor(query_count, [&rendered_map, &results](std::size_t index) {
+        results[index] = rendered_map.GetEncoded(index % 2 == 0 ? into::Encoding::Gzip : into::Encoding::Deflate);
+    });
+    for (std::size_t index = 0; index < query_count; ++index) {
+        ASSERT(results[index] != nullptr);
+        ASSERT(results[index] == results[index % 2]);
+    }
+    ASSERT(results[0] != results[1]);
+    ASSERT_EQUAL(rendered_map.GetEncoded(into::Encoding::Identity), nullptr);
+}
+
+std::string RenderSvg(const svg::Document& document) {
+    std::ostringstream output;
+    document.Render(output);
+    return output.str();
+}
+
+/// Call \p add with \p count circles, polylines and texts that depend on their indices only
+template<typename Add>
+void AddTestShapes(std::size_t count, Add add) {
+    for (std::size_t i = 0; i < count; ++i) {
+        const double x = static_cast<double>(i % 97) * 1.5;
+        const double y = static_cast<double>(i % 89) / 3.0;
+        if (i % 3 == 0) {
+            add(svg::Circle().SetCenter({x, y}).SetRadius(5.0).SetFillColor("white"s));
+        } else if (i % 3 == 1) {
+            add(svg::Polyline().AddPoint({x, y}).AddPoint({y, x}).AddPoint({x + 1.0, y - 0.25})
+                        .SetFillColor(svg::color::None).SetStrokeColor(svg::color::Rgb{255, 160, 0})
+                        .SetStrokeWidth(14.0).SetStrokeLineCap(svg::StrokeLineCap::ROUND));
+        } else {
+            add(svg::Text().SetPosition({x, y}).SetOffset({7.0, -3.0}).SetFontSize(18).SetFontFamily("Verdana"s)
+                        .SetData("Stop <"s + std::to_string(i) + "> & \"quotes\" Ж"s)
+                        .SetFillColor(svg::color::Rgba{255, 255, 255, 0.85}));
+        }
+    }
+}
+
+void TestDocumentStoresShapesByValue() {
+    for (const std::size_t count : {0, 1, 2, 3, 100}) {
+        // Shapes on the heap are rendered by virtual calls, as all of them were before they were stored by value
+        svg::Document on_heap;
+        AddTestShapes(count, [&on_heap](auto shape) {
+            on_heap.AddPtr(std::make_unique<decltype(shape)>(std::move(shape)));
+        });
+        const std::string expected = RenderSvg(on_heap);
+
+        svg::Document by_value;
+        AddTestShapes(count, [&by_value](auto shape) {
+            by_value.Add(std::move(shape));
+        });
+        ASSERT_EQUAL(RenderSvg(by_value), expected);
+
+        // Shapes added through the container interface, e.g. by drawables, keep their order among the others
+        svg::Document mixed;
+        std::size_t index = 0;
+        AddTestShapes(count, [&mixed, &index](auto shape) {
+            if (index++ % 2 == 0) {
+                static_cast<svg::ObjectContainer&>(mixed).Add(std::move(shape));
+            } else {
+                mixed.Add(std::move(shape));
+            }
+        });
+        ASSERT_EQUAL(RenderSvg(mixed), expected);
+
+        std::deque<svg::Circle> circles;
+        std::deque<svg::Polyline> polylines;
+        std::deque<svg::Text> texts;
+        svg::Document by_reference;
+        AddTestShapes(count, [&](auto shape) {
+            using Shape = decltype(shape);
+            if constexpr (std::is_same_v<Shape, svg::Circle>) {
+                by_reference.AddReference(circles.emplace_back(std::move(shape)));
+            } else if constexpr (std::is_same_v<Shape, svg::Polyline>) {
+                by_reference.AddReference(polylines.emplace_back(std::move(shape)));
+            } else {
+                by_reference.AddReference(texts.emplace_back(std::move(shape)));
+            }
+        });
+        ASSERT_EQUAL(RenderSvg(by_reference), expected);
+
+        std::size_t shape_count = 0;
+        mixed.ForEachShape([&shape_count](const auto&) {
+            ++shape_count;
+        });
+        ASSERT_EQUAL(shape_count, count);
+        ASSERT_EQUAL(mixed.GetObjectCount(), count);
+    }
+}
+
+void TestEscapingBuffer() {
+    using unit_test_tools::Generator;
+
+    const std::vector<std::string> pieces{"a"s, "\""s, "\\"s, "\n"s, "\r"s, "\t"s, "Ж"s, "<svg>"s, " "s};
+    // Texts around the size of the buffer of 8 KiB, so escapes are split between its flushes
+    for (const std::size_t size : {0, 1, 8191, 8192, 8193, 20000}) {
+        std::string value;
+        while (value.size() < size) {
+            value += pieces[Generator<std::size_t>::Get(0, pieces.size() - 1)];
+        }
+
+        std::string target = "kept "s;
+        {
+            json::EscapingBuffer buffer(target);
+            std::ostream output(&buffer);
+            for (std::size_t written = 0; written < value.size();) {
+                const std::size_t count = std::min(value.size() - written, Generator<std::size_t>::Get(1, 5000));
+                output << std::string_view(value).substr(written, count);
+                written += count;
+            }
+        }
+        ASSERT_EQUAL_HINT(target, "kept "s + std::string(json::EscapedString(value).GetEscaped()),
+                          std::to_string(size));
+    }
+
+    // A map rendered straight into its escaped form is the escaped SVG
+    svg::Document document;
+    AddTestShapes(1000, [&document](auto shape) {
+        document.Add(std::move(shape));
+    });
+    ASSERT(queries::RenderedMap(document).json_image == json::EscapedString(RenderSvg(document)));
+}
+
+void TestRenderParts() {
+    // A large document is rendered by the pool in several parts
+    constexpr std::size_t large_count = 3 * queries::RenderedMap::min_part_object_count;
+    for (const std::size_t count : {std::size_t{0}, std::size_t{1}, std::size_t{5}, large_count}) {
+        svg::Document document;
+        AddTestShapes(count, [&document](auto shape) {
+            document.Add(std::move(shape));
+        });
+        const std::string expected = RenderSvg(document);
+
+        // Parts concatenated in order are the whole document, even if there are more parts than objects
+        for (const std::size_t part_count : {1, 2, 3, 7, 16, 20000}) {
+            std::ostringstream output;
+            for (std::size_t index = 0; index < part_count; ++index) {
+                document.RenderPart(output, index, part_count);
+            }
+            ASSERT_EQUAL_HINT(output.str(), expected,
+                              std::to_string(count) + " objects in "s + std::to_string(part_count) + " parts"s);
+        }
+
+        thread_pool::ThreadPool pool(4);
+        ASSERT(queries::RenderedMap(document, &pool).json_image == queries::RenderedMap(document).json_image);
+    }
+}
+
+double ComputeDistanceToSegment(svg::Point point, svg::Point from, svg::Point to) {
+    const double dx = to.x - from.x;
+    const double dy = to.y - from.y;
+    const double length_squared = dx * dx + dy * dy;
+    const double t = length_squared > 0.0
+                     ? std::clamp(((point.x - from.x) * dx + (point.y - from.y) * dy) / length_squared, 0.0, 1.0)
+                     : 0.0;
+    return std::hypot(point.x - (from.x + t * dx), point.y - (from.y + t * dy));
+}
+
+/// Textbook recursive Douglas-Peucker: keep the farthest point of a range if it is farther than \p tolerance
+void SimplifyRange(const std::vector<svg::Point>& points, std::size_t first, std::size_t last, double tolerance,
+                   std::vector<bool>& is_kept) {
+    std::size_t farthest = first;
+    double max_distance = -1.0;
+    for (std::size_t i = first + 1; i < last; ++i) {
+        const double distance = ComputeDistanceToSegment(points[i], points[first], points[last]);
+        if (distance > max_distance) {
+            farthest = i;
+            max_distance = distance;
+        }
+    }
+    if (farthest != first && max_distance > tolerance) {
+        is_kept[farthest] = true;
+        SimplifyRange(points, first, farthest, tolerance, is_kept);
+        SimplifyRange(points, farthest, last, tolerance, is_kept);
+    }
+}
+
+void TestSignificanceSimplifiesLikeDouglasPeucker() {
+    using unit_test_tools::Generator;
+
+    for (std::size_t size = 0; size <= 40; ++size) {
+        for (int attempt = 0; attempt < 20; ++attempt) {
+            std::vector<svg::Point> points;
+            for (std::size_t i = 0; i < size; ++i) {
+                // Some polylines repeat points or run along a line
+                if (attempt % 5 == 0 && i > 0) {
+                    points.push_back(attempt % 10 == 0 ? points.back() : svg::Point{points.back().x + 1.0, 0.0});
+                } else {
+                    points.emplace_back(Generator<double>::Get(0.0, 100.0), Generator<double>::Get(0.0, 100.0));
+                }
+            }
+
+            const auto significance = renderer::ComputeSignificance(points);
+            ASSERT_EQUAL(significance.size(), size);
+            for (const double tolerance : {0.0, 0.5, 2.0, 10.0, 30.0, 1000.0}) {
+                std::vector<bool> expected(size, false);
+                if (size > 0) {
+                    expected.front() = expected.back() = true;
+                    SimplifyRange(points, 0, size - 1, tolerance, expected);
+                }
+
+                std::vector<bool> is_kept(size);
+                for (std::size_t i = 0; i < size; ++i) {
+                    is_kept[i] = significance[i] > tolerance;
+                }
+                ASSERT_HINT(is_kept == expected, std::to_string(size) + " points within "s + std::to_string(tolerance));
+            }
+        }
+    }
+}
+
+std::vector<std::string> GetBusNames(const renderer::ViewportContent& content) {
+    std::vector<std::string> names;
+    for (const auto& route : content.routes) {
+        names.push_back(route.bus->name);
+    }
+    return names;
+}
+
+void TestTileSelection() {
+    using transport_catalogue::Bus;
+    using renderer::Tile;
+
+    // The map spans latitudes from 55.6 to 55.8 and longitudes from 37.0 to 37.2,
+    // so tiles of zoom 1 split it at 55.7 and 37.1
+    transport_catalogue::TransportCatalogue database;
+    database.AddStop({"N1"s, {geo::Degree{55.78}, geo::Degree{37.02}}, {}});
+    database.AddStop({"N2"s, {geo::Degree{55.80}, geo::Degree{37.20}}, {}});
+    database.AddStop({"S1"s, {geo::Degree{55.60}, geo::Degree{37.00}}, {}});
+    database.AddStop({"S2"s, {geo::Degree{55.65}, geo::Degree{37.05}}, {}});
+    database.AddStop({"E1"s, {geo::Degree{55.62}, geo::Degree{37.16}}, {}});
+    database.AddStop({"E2"s, {geo::Degree{55.68}, geo::Degree{37.18}}, {}});
+    database.AddStop({"Unused"s, {geo::Degree{55.72}, geo::Degree{37.02}}, {}});
+    database.AddBus("North"s, std::vector{"N1"sv, "N2"sv}, Bus::RouteType::Half);
+    database.AddBus("South"s, std::vector{"S1"sv, "S2"sv}, Bus::RouteType::Half);
+    database.AddBus("East"s, std::vector{"E1"sv, "E2"sv, "E1"sv}, Bus::RouteType::Full);
+
+    const renderer::ViewportSelector selector(database);
+    const auto select = [&selector](Tile tile) {
+        return selector.Select(selector.GetBox(tile));
+    };
+
+    auto content = select({0, 0, 0});
+    ASSERT_EQUAL(GetBusNames(content), (std::vector{"East"s, "North"s, "South"s}));
+    ASSERT_EQUAL(GetNames(content.stops), (std::vector{"E1"s, "E2"s, "N1"s, "N2"s, "S1"s, "S2"s}));
+
+    content = select({1, 0, 0});
+    ASSERT_EQUAL(GetBusNames(content), std::vector{"North"s});
+    ASSERT_EQUAL(GetNames(content.stops), std::vector{"N1"s});
+    // The label of the bus is at its first stop, and the route leaves the tile
+    ASSERT_EQUAL(content.routes.front().label_positions.size(), 1u);
+    ASSERT_EQUAL(content.routes.front().runs.size(), 1u);
+
+    content = select({1, 1, 0});
+    ASSERT_EQUAL(GetBusNames(content), std::vector{"North"s});
+    ASSERT_EQUAL(GetNames(content.stops), std::vector{"N2"s});
+
+    content = select({1, 0, 1});
+    ASSERT_EQUAL(GetBusNames(content), std::vector{"South"s});
+    ASSERT_EQUAL(GetNames(content.stops), (std::vector{"S1"s, "S2"s}));
+
+    content = select({1, 1, 1});
+    ASSERT_EQUAL(GetBusNames(content), std::vector{"East"s});
+    ASSERT_EQUAL(GetNames(content.stops), (std::vector{"E1"s, "E2"s}));
+
+    // The south-east corner from 55.60 to 55.65 and from 37.15 to 37.20
+    content = select({2, 3, 3});
+    ASSERT_EQUAL(GetBusNames(content), std::vector{"East"s});
+    ASSERT_EQUAL(GetNames(content.stops), std::vector{"E1"s});
+
+    // A tile with a stop of no bus only
+    content = select({2, 0, 1});
+    ASSERT(content.routes.empty() && content.stops.empty());
+
+    (void) selector.GetBox(Tile{Tile::max_zoom, (1 << Tile::max_zoom) - 1, (1 << Tile::max_zoom) - 1});
+    ASSERT_THROW((void) selector.GetBox(Tile{-1, 0, 0}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{Tile::max_zoom + 1, 0, 0}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{0, 1, 0}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{0, 0, 1}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{1, -1, 0}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{1, 0, -1}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{1, 2, 0}), std::invalid_argument);
+    ASSERT_THROW((void) selector.GetBox(Tile{1, 0, 2}), std::invalid_argument);
+}
+
+/// A base file in the temporary directory, removed with the object
+class TempBaseFile {
+public:
+    explicit TempBaseFile(std::string_view name)
+            : path_(std::filesystem::temp_directory_path() / ("transport_catalogue_"s + std::string(name) + ".db"s)) {
+    }
+
+    TempBaseFile(const TempBaseFile&) = delete;
+    TempBaseFile& operator=(const TempBaseFile&) = delete;
+
+    ~TempBaseFile() {
+        std::error_code error;
+        std::filesystem::remove(path_, error);
+    }
+
+    [[nodiscard]] const std::filesystem::path& GetPath() const noexcept {
+        return path_;
+    }
+
+    [[nodiscard]] std::string GetSettingsJson() const {
+        return R"({"file": ")"s + path_.generic_string() + R"("})"s;
+    }
+
+    /// Build the base of \p base_requests with the test render and routing settings, like make_base
+    void Make(std::string_view base_requests) const {
+        const std::string text = R"({"serialization_settings": )"s + GetSettingsJson()
+                + R"(, "render_settings": {"width": 600, "height": 400, "padding": 50, "line_width": 14,)"
+                  R"( "stop_radius": 5, "underlayer_width": 3, "bus_label_font_size": 20,)"
+                  R"( "bus_label_offset": [7, 15], "stop_label_font_size": 18, "stop_label_offset": [7, -3],)"
+                  R"( "underlayer_color": [255, 255, 255, 0.85], "color_palette": ["green", [255, 160, 0], "red"]},)"
+                  R"( "routing_settings": {"bus_wait_time": 2, "bus_velocity": 30},)"
+                  R"( "base_requests": )"s + std::string(base_requests) + "}"s;
+
+        transport_catalogue::TransportCatalogue database;
+        renderer::MapRenderer renderer;
+        router::TransportRouter router;
+        queries::Handler handler(database, renderer, router);
+        std::ostringstream output;
+        handler.ProcessQueries("make_base"sv, from::JsonText{text}, into::Json{output});
+    }
+
+private:
+    std::filesystem::path path_;
+};
+
+/// Two stops 3 km apart, so a route between them takes 6 minutes by bus at 30 km/h besides the wait
+const std::string_view two_stop_base = R"([)"
+        R"({"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.20, "road_distances": {"B": 3000}},)"
+        R"({"type": "Stop", "name": "B", "latitude": 55.62, "longitude": 37.25, "road_distances": {}},)"
+        R"({"type": "Bus", "name": "14", "stops": ["A", "B"], "is_roundtrip": false}])"sv;
+
+/// Buses of every kind: a half route, a roundtrip and a bus through stops of others
+const std::string_view city_base = R"([)"
+        R"({"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.20, "road_distances": {"B": 3000, "D": 1500}},)"
+        R"({"type": "Stop", "name": "B", "latitude": 55.62, "longitude": 37.25, "road_distances": {"C": 2500}},)"
+        R"({"type": "Stop", "name": "C", "latitude": 55.61, "longitude": 37.30, "road_distances": {"E \"Terminal\"": 9000}},)"
+        R"({"type": "Stop", "name": "D", "latitude": 55.61, "longitude": 37.22, "road_distances": {}},)"
+        R"({"type": "Stop", "name": "E \"Terminal\"", "latitude": 55.70, "longitude": 37.40, "road_distances": {}},)"
+        R"({"type": "Bus", "name": "14", "stops": ["A", "B", "C"], "is_roundtrip": false},)"
+        R"({"type": "Bus", "name": "20", "stops": ["D", "A", "D"], "is_roundtrip": true},)"
+        R"({"type": "Bus", "name": "7", "stops": ["A", "B", "C", "E \"Terminal\""], "is_roundtrip": false}])"sv;
+
+/// A handler with the base of \p base_file loaded
+struct LoadedBase {
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler{database, renderer, router};
+
+    explicit LoadedBase(const TempBaseFile& base_file) {
+        const std::string settings = R"({"serialization_settings": )"s + base_file.GetSettingsJson() + "}"s;
+        handler.LoadBase(from::JsonText{settings});
+    }
+
+    /// Answers of process_requests to \p stat_requests
+    std::string Process(std::string_view stat_requests) {
+        const std::string text = R"({"stat_requests": )"s + std::string(stat_requests) + "}"s;
+        std::ostringstream output;
+        ASSERT(handler.ProcessQueries("process_requests"sv, from::JsonText{text}, into::Json{output}));
+        return output.str();
+    }
+};
+
+void TestMapResponseMatchesFreshRender() {
+    const TempBaseFile base_file("map_response"sv);
+    base_file.Make(city_base);
+    LoadedBase base(base_file);
+
+    // Later map requests are answered with the map rendered by the first one
+    const auto answers = base.Process(R"([{"type": "Map", "id": 1}, {"type": "Bus", "name": "14", "id": 2},)"
+                                      R"( {"type": "Map", "id": 3}])"sv);
+    const auto document = json::Load(answers);
+    const auto& responses = document.GetRoot().AsArray();
+    const auto expected_map = RenderSvg(base.handler.RenderMap());
+    ASSERT_EQUAL(responses.at(0).AsDict().at("map"s).AsString(), expected_map);
+    ASSERT_EQUAL(responses.at(2).AsDict().at("map"s).AsString(), expected_map);
+    ASSERT(base.handler.GetRenderedMap() == base.handler.GetRenderedMap());
+    ASSERT(base.handler.GetRenderedMap()->json_image == json::EscapedString(expected_map));
+}
+
+std::vector<std::string> SplitLines(const std::string& text) {
+    std::vector<std::string> lines;
+    std::istringstream input(text);
+    for (std::string line; std::getline(input, line);) {
+        lines.push_back(std::move(line));
+    }
+    return lines;
+}
+
+/// Points of a polyline element and the element without them
+std::pair<std::string, std::string> SplitPolyline(const std::string& line) {
+    const auto points_begin = line.find("points=\""sv) + "points=\""sv.size();
+    const auto points_end = line.find('"', points_begin);
+    return {line.substr(points_begin, points_end - points_begin),
+            line.substr(0, points_begin) + line.substr(points_end)};
+}
+
+void TestItineraryOverlaysMap() {
+    const TempBaseFile base_file("itinerary"sv);
+    base_file.Make(city_base);
+    LoadedBase base(base_file);
+    const auto map_lines = SplitLines(RenderSvg(base.handler.RenderMap()));
+
+    // A transfer from bus 20 to bus 7 at A
+    const auto route = base.handler.GetRouteBetweenStops("D"sv, "E \"Terminal\""sv);
+    ASSERT(route);
+    const auto itinerary = json::Unescape(base.handler.RenderItinerary(route).json_image.GetEscaped());
+    const auto itinerary_lines = SplitLines(itinerary);
+    ASSERT(itinerary_lines.size() > 2);
+
+    // Stops and labels are drawn where the map draws them, and legs run along the routes of their buses
+    std::size_t leg_count = 0;
+    for (const auto& line : itinerary_lines) {
+        if (line.find("<polyline"sv) == std::string::npos) {
+            ASSERT_HINT(std::find(map_lines.begin(), map_lines.end(), line) != map_lines.end(), line);
+            continue;
+        }
+        ++leg_count;
+        const auto leg = SplitPolyline(line);
+        const auto is_along_route = [&leg](const std::string& map_line) {
+            if (map_line.find("<polyline"sv) == std::string::npos) {
+                return false;
+            }
+            const auto route_line = SplitPolyline(map_line);
+            return route_line.second == leg.second && route_line.first.find(leg.first) != std::string::npos;
+        };
+        ASSERT_HINT(std::any_of(map_lines.begin(), map_lines.end(), is_along_route), line);
+    }
+    ASSERT_EQUAL(leg_count, 2u);
+    ASSERT_HINT(itinerary.find(">B</text>"sv) == std::string::npos, itinerary);
+}
+
+void TestStreamSettingsApplyToLoadedBase() {
+    const TempBaseFile base("stream_settings"sv);
+    base.Make(two_stop_base);
+
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler(database, renderer, router);
+    std::ostringstream output;
+    into::JsonLineProcessor processor(handler, output);
+
+    processor.ProcessLine(R"({"serialization_settings": )"s + base.GetSettingsJson()
+                          + R"(, "stat_requests": [{"type": "Map", "id": 1}, )"
+                            R"({"type": "Route", "id": 2, "from": "A", "to": "B"}]})"s);
+    ASSERT_HINT(output.str().find("green"sv) != std::string::npos, output.str());
+    ASSERT_HINT(output.str().find(R"("total_time":8)"sv) != std::string::npos, output.str());
+
+    // Settings without serialization settings change the loaded base instead of being overwritten by it
+    output.str({});
+    processor.ProcessLine(R"({"render_settings": {"width": 300, "height": 400, "padding": 50, "line_width": 14,)"
+                          R"( "stop_radius": 5, "underlayer_width": 3, "bus_label_font_size": 20,)"
+                          R"( "bus_label_offset": [7, 15], "stop_label_font_size": 18, "stop_label_offset": [7, -3],)"
+                          R"( "underlayer_color": [255, 255, 255, 0.85], "color_palette": ["purple"]},)"
+                          R"( "routing_settings": {"bus_wait_time": 20, "bus_velocity": 30},)"
+                          R"( "stat_requests": [{"type": "Map", "id": 3}, {"type": "Route", "id": 4, "from": "A", "to": "B"}]})"sv);
+    ASSERT_HINT(output.str().find("purple"sv) != std::string::npos, output.str());
+    ASSERT_HINT(output.str().find("green"sv) == std::string::npos, output.str());
+    ASSERT_HINT(output.str().find(R"("total_time":26)"sv) != std::string::npos, output.str());
+    ASSERT_EQUAL(renderer.GetSettings()->get().width, 300.0);
+
+    const queries::RenderedMap expected_map(handler.RenderMap());
+    ASSERT(handler.GetRenderedMap()->json_image == expected_map.json_image);
+}
+
+void TestFailedQueryClosesResponses() {
+    const TempBaseFile base("failed_query"sv);
+    base.Make(two_stop_base);
+
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler(database, renderer, router);
+    const std::string text = R"({"serialization_settings": )"s + base.GetSettingsJson()
+            + R"(, "stat_requests": [{"type": "Bus", "id": 1, "name": "14"},)"
+              R"( {"type": "Map", "id": 2, "zoom": 40, "x": 0, "y": 0}, {"type": "Bus", "id": 3, "name": "14"}]})"s;
+
+    std::ostringstream output;
+    bool is_thrown = false;
+    try {
+        handler.ProcessQueries(from::JsonText{text}, into::Json{output});
+    } catch (const std::invalid_argument&) {
+        is_thrown = true;
+    }
+    ASSERT(is_thrown);
+
+    // Responses streamed before the failure still form a valid array
+    const auto document = json::Load(output.str());
+    const auto& responses = document.GetRoot().AsArray();
+    ASSERT_EQUAL(responses.size(), 1u);
+    ASSERT_EQUAL(responses.front().AsDict().at("request_id"s).AsInt(), 1);
+}
+
+void TestStreamErrors() {
+    transport_catalogue::TransportCatalogue database;
+    renderer::MapRenderer renderer;
+    router::TransportRouter router;
+    queries::Handler handler(database, renderer, router);
+
+    const auto answer = [&handler](std::string_view line) {
+        std::ostringstream output;
+        into::JsonLineProcessor processor(handler, output);
+        processor.ProcessLine(line);
+        return output.str();
+    };
+    ASSERT_EQUAL(answer(R"({"type": "Route", "id": 5, "from": "A", "to": "B"})"sv),
+                 R"({"error_message":"not found","request_id":5})"s "\n"s);
+    ASSERT_EQUAL(answer(R"({"type": "NearestStops", "id": 6, "latitude": 55.6, "longitude": 37.2, "count": -1})"sv),
+                 R"({"error_message":"count must be non-negative","request_id":6})"s "\n"s);
+    // Errors of lines without an id, or too malformed to find it, are not matched with a request
+    ASSERT_EQUAL(answer(R"({"stat_requests": [{"type": "Route", "id": 7, "from": "A", "to": "B"}]})"sv),
+                 R"({"error_message":"not found"})"s "\n"s);
+    ASSERT_EQUAL(answer(R"({"type": "Route", "id": 8,)"sv),
+                 R"({"error_message":"Failed to read a character from the stream"})"s "\n"s);
+}
+
+void TestParseEndpoint() {
+    namespace server = transport_catalogue::server;
+
+    ASSERT_EQUAL(std::get<std::uint16_t>(server::Endpoint::Parse("1"sv).address), 1);
+    ASSERT_EQUAL(std::get<std::uint16_t>(server::Endpoint::Parse("8080"sv).address), 8080);
+    ASSERT_EQUAL(std::get<std::uint16_t>(server::Endpoint::Parse("065535"sv).address), 65535);
+    ASSERT_THROW((void) server::Endpoint::Parse("0"sv), std::invalid_argument);
+    ASSERT_THROW((void) server::Endpoint::Parse("65536"sv), std::invalid_argument);
+    ASSERT_THROW((void) server::Endpoint::Parse("18446744073709551617"sv), std::invalid_argument);
+    ASSERT_THROW((void) server::Endpoint::Parse(""sv), std::invalid_argument);
+
+    // Anything but digits is a socket path
+    ASSERT_EQUAL(std::get<std::string>(server::Endpoint::Parse("/tmp/catalogue.sock"sv).address),
+                 "/tmp/catalogue.sock"s);
+    ASSERT_EQUAL(std::get<std::string>(server::Endpoint::Parse("8080.sock"sv).address), "8080.sock"s);
+    ASSERT_EQUAL(std::get<std::string>(server::Endpoint::Parse("-1"sv).address), "-1"s);
+}
+
+void TestLatencyPercentiles() {
+    using namespace std::chrono;
+    using transport_catalogue::server::LatencyHistogram;
+
+    LatencyHistogram histogram;
+    auto summary = histogram.TakeSummary();
+    ASSERT_EQUAL(summary.count, 0u);
+    ASSERT_EQUAL(summary.max.count(), 0);
+
+    // The smallest latencies have buckets of their own, and negative ones count as zero
+    histogram.Record(-5us);
+    histogram.Record(3us);
+    histogram.Record(3999ns);
+    summary = histogram.TakeSummary();
+    ASSERT_EQUAL(summary.count, 3u);
+    ASSERT_EQUAL(summary.p50.count(), 3);
+    ASSERT_EQUAL(summary.p99.count(), 3);
+    ASSERT_EQUAL(summary.max.count(), 3);
+
+    // A summary takes the latencies recorded since the previous one
+    summary = histogram.TakeSummary();
+    ASSERT_EQUAL(summary.count, 0u);
+    ASSERT_EQUAL(summary.max.count(), 0);
+
+    // A percentile is the upper bound of its bucket: 500 lies in [448, 511] and 900 in [896, 1023],
+    // but no percentile exceeds the maximum
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.Record(microseconds(i));
+    }
+    summary = histogram.TakeSummary();
+    ASSERT_EQUAL(summary.count, 1000u);
+    ASSERT_EQUAL(summary.p50.count(), 511);
+    ASSERT_EQUAL(summary.p90.count(), 1000);
+    ASSERT_EQUAL(summary.p99.count(), 1000);
+    ASSERT_EQUAL(summary.max.count(), 1000);
+
+    // Buckets are a quarter of a power of two wide, so a percentile overestimates by less than 25%
+    for (std::int64_t latency = 4; latency < (std::int64_t{1} << 40); latency += latency / 3 + 1) {
+        histogram.Record(microseconds(latency));
+        histogram.Record(microseconds(latency * 100));
+        summary = histogram.TakeSummary();
+        const std::string hint = std::to_string(latency) + " us"s;
+        ASSERT_HINT(summary.p50.count() >= latency, hint);
+        ASSERT_HINT(summary.p50.count() < latency + latency / 4 + 1, hint);
+        ASSERT_EQUAL_HINT(summary.max.count(), latency * 100, hint);
+    }
+}
+
+/// Results of reloads that a snapshot holder reports, which can hold the loading thread until released
+class ReloadLog {
+public:
+    queries::SnapshotHolder::ReloadCallback MakeCallback() {
+        return [this](std::exception_ptr error) {
+            std::unique_lock lock(mutex_);
+            errors_.push_back(error);
+            changed_.notify_all();
+            changed_.wait(lock, [this] {
+                return !is_blocked_;
+            });
+        };
+    }
+
+    void Block() {
+        std::lock_guard guard(mutex_);
+        is_blocked_ = true;
+    }
+
+    void Unblock() {
+        {
+            std::lock_guard guard(mutex_);
+            is_blocked_ = false;
+        }
+        changed_.notify_all();
+    }
+
+    /// Wait for \p count reloads in total and return the error of the last one
+    std::exception_ptr WaitFor(std::size_t count) {
+        std::unique_lock lock(mutex_);
+        changed_.wait(lock, [this, count] {
+            return errors_.size() >= count;
+        });
+        return errors_.at(count - 1);
+    }
+
+    std::size_t GetCount() {
+        std::lock_guard guard(mutex_);
+        return errors_.size();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::vector<std::exception_ptr> errors_;
+    bool is_blocked_ = false;
+};
+
+void TestSnapshotReload() {
+    const TempBaseFile base("snapshot_reload"sv);
+    base.Make(two_stop_base);
+    const std::string settings = R"({"serialization_settings": )"s + base.GetSettingsJson() + "}"s;
+
+    ReloadLog log;
+    std::size_t reload_count = 0;
+    {
+        queries::SnapshotHolder snapshots(queries::Snapshot::Load(from::JsonText{settings}), log.MakeCallback());
+        const auto old_snapshot = snapshots.Get();
+        ASSERT(!old_snapshot->GetHandler().FindStopBy("C"sv).has_value());
+
+        // A query in progress keeps its snapshot, while new ones get the rebuilt base
+        base.Make(R"([)"
+                  R"({"type": "Stop", "name": "A", "latitude": 55.60, "longitude": 37.20, "road_distances": {"C": 1000}},)"
+                  R"({"type": "Stop", "name": "C", "latitude": 55.61, "longitude": 37.20, "road_distances": {}},)"
+                  R"({"type": "Bus", "name": "15", "stops": ["A", "C"], "is_roundtrip": false}])"sv);
+        snapshots.RequestReload();
+        ASSERT(log.WaitFor(++reload_count) == nullptr);
+        const auto new_snapshot = snapshots.Get();
+        ASSERT(new_snapshot != old_snapshot);
+        ASSERT(new_snapshot->GetHandler().FindStopBy("C"sv).has_value());
+        ASSERT(!new_snapshot->GetHandler().FindStopBy("B"sv).has_value());
+        ASSERT(old_snapshot->GetHandler().FindStopBy("B"sv).has_value());
+        ASSERT(!old_snapshot->GetHandler().FindStopBy("C"sv).has_value());
+        ASSERT(old_snapshot->GetHandler().GetRouteBetweenStops("A"sv, "B"sv));
+
+        // Requests made while a reload is in progress result in one more reload
+        log.Block();
+        snapshots.RequestReload();
+        log.WaitFor(++reload_count);
+        for (int i = 0; i < 10; ++i) {
+            snapshots.RequestReload();
+        }
+        log.Unblock();
+        log.WaitFor(++reload_count);
+
+        // A base that fails to load keeps the current snapshot
+        const auto last_snapshot = snapshots.Get();
+        std::ofstream(base.GetPath(), std::ios::binary | std::ios::trunc) << "not a base"sv;
+        snapshots.RequestReload();
+        ASSERT(log.WaitFor(++reload_count) != nullptr);
+        ASSERT(snapshots.Get() == last_snapshot);
+        ASSERT(snapshots.Get()->GetHandler().FindStopBy("C"sv).has_value());
+    }
+    ASSERT_EQUAL(log.GetCount(), reload_count);
+}
+
+/// Vector sizes of the scanner are 16 (SSE2) and 32 (AVX2) bytes
+const std::vector<std::size_t> boundary_lengths{15, 16, 17, 31, 32, 33};
+
+void TestScanBoundaries() {
+    const auto is_quote_backslash_or_control = [](char ch) {
+        return ch == '"' || ch == '\\' || static_cast<unsigned char>(ch) < 0x20;
+    };
+    const auto is_escaped = [](char ch) {
+        return ch == '"' || ch == '\\' || ch == '\n' || ch == '\r';
+    };
+
+    for (std::size_t length = 0; length <= 40; ++length) {
+        for (const char special : {'"', '\\', '\n', '\r', '\t', '\x01', '\x1f'}) {
+            for (std::size_t position = 0; position < length; ++position) {
+                std::string text(length, 'a');
+                text[position] = special;
+                const char* const first = text.data();
+                const char* const last = text.data() + text.size();
+                const auto hint = "length "s + std::to_string(length) + ", position "s + std::to_string(position);
+
+                const auto expected_stop = std::find_if(first, last, is_quote_backslash_or_control);
+                ASSERT_EQUAL_HINT(simd_scan::FindQuoteBackslashOrControl(first, last) - first, expected_stop - first, hint);
+                const auto expected_escaped = std::find_if(first, last, is_escaped);
+                ASSERT_EQUAL_HINT(simd_scan::FindEscaped(first, last) - first, expected_escaped - first, hint);
+            }
+        }
+
+        std::string spaces(length, ' ');
+        ASSERT_EQUAL(simd_scan::SkipSpaces(spaces.data(), spaces.data() + length) - spaces.data(),
+                     static_cast<std::ptrdiff_t>(length));
+        for (std::size_t position = 0; position < length; ++position) {
+            std::string text(length, '\t');
+            text[position] = '{';
+            ASSERT_EQUAL(simd_scan::SkipSpaces(text.data(), text.data() + length) - text.data(),
+                         static_cast<std::ptrdiff_t>(position));
+        }
+    }
+}
+
+/// Parse \p text from chunks of \p chunk_size bytes, so that values are split across chunk boundaries
+json::Node LoadByChunks(const std::string& text, std::size_t chunk_size) {
+    std::istringstream input(text);
+    json::StreamSource source(input, chunk_size);
+    json::NodeBuilder builder;
+    json::Parse(source, builder);
+    return builder.ReleaseNode();
+}
+
+void TestStringsAtVectorBoundaries() {
+    // Escaped and raw characters that end a run of the scanner, and what they are parsed into
+    const std::vector<std::pair<std::string, char>> specials{
+            {"\\\""s, '"'}, {"\\\\"s, '\\'}, {"\\n"s, '\n'}, {"\\t"s, '\t'}, {"\t"s, '\t'}, {"\x01"s, '\x01'}};
+
+    for (const std::size_t length : boundary_lengths) {
+        for (const auto& [input, parsed] : specials) {
+            for (const std::size_t position : {std::size_t(0), length - 2, length - 1}) {
+                const std::string text = "  \""s + std::string(position, 'a') + input
+                                       + std::string(length - position - 1, 'b') + "\"  "s;
+                const std::string expected = std::string(position, 'a') + parsed + std::string(length - position - 1, 'b');
+                ASSERT_EQUAL_HINT(json::Load(text).GetRoot().AsString(), expected, text);
+                // Every chunk size up to the whole text splits the string at a different place
+                for (std::size_t chunk_size = 1; chunk_size <= text.size(); ++chunk_size) {
+                    ASSERT_EQUAL_HINT(LoadByChunks(text, chunk_size).AsString(), expected,
+                                      text + " by "s + std::to_string(chunk_size));
+                }
+            }
+        }
+
+        // Strings end at the vector boundary, and whitespace runs fill whole vectors
+        const std::string plain(length, 'c');
+        const std::string text = std::string(length, ' ') + "[\""s + plain + "\","s + std::string(length, '\n') + "1]"s;
+        for (std::size_t chunk_size = 1; chunk_size <= text.size(); ++chunk_size) {
+            const auto node = LoadByChunks(text, chunk_size);
+            ASSERT_EQUAL(node.AsArray().at(0).AsString(), plain);
+            ASSERT_EQUAL(node.AsArray().at(1).AsInt(), 1);
+        }
+    }
+
+    for (const std::string& text : {"\"line\nbreak\""s, "\"unterminated"s, "\"bad \\x escape\""s}) {
+        bool is_thrown = false;
+        try {
+            (void) json::Load(text);
+        } catch (const json::ParsingError&) {
+            is_thrown = true;
+        }
+        ASSERT_HINT(is_thrown, text);
+    }
+}
+
+void TestNumbers() {
+    // Results of the character-by-character parser that the buffer one replaced
+    struct Number {
+        std::string text;
+        bool is_int;
+        double value;
+    };
+    const std::vector<Number> numbers{
+            {"0"s, true, 0.0},
+            {"-0"s, true, 0.0},
+            {"-0.0"s, false, -0.0},
+            {"0.1"s, false, 0.1},
+            {"1e0"s, false, 1.0},
+            {"1e2"s, false, 100.0},
+            {"2.5e+3"s, false, 2500.0},
+            {"1.5E-2"s, false, 1.5e-2},
+            {"1e-5"s, false, 1e-5},
+            {"1e308"s, false, 1e308},
+            {"1E308"s, false, 1e308},
+            {"-1e308"s, false, -1e308},
+            {"2147483647"s, true, 2147483647.0},
+            {"-2147483648"s, true, -2147483648.0},
+            {"2147483648"s, false, 2147483648.0},
+            {"-2147483649"s, false, -2147483649.0},
+            {"12345678901234567890"s, false, 12345678901234567890.0},
+    };
+
+    for (const auto& number : numbers) {
+        const std::string text = "["s + number.text + ", "s + number.text + "]"s;
+        for (std::size_t chunk_size = 1; chunk_size <= text.size(); ++chunk_size) {
+            const auto hint = number.text + " by "s + std::to_string(chunk_size);
+            const auto root = LoadByChunks(text, chunk_size);
+            for (const auto& node : root.AsArray()) {
+                ASSERT_EQUAL_HINT(node.IsInt(), number.is_int, hint);
+                ASSERT_EQUAL_HINT(node.AsDouble(), number.value, hint);
+                ASSERT_EQUAL_HINT(std::signbit(node.AsDouble()), std::signbit(number.value), hint);
+            }
+        }
+        const auto node = json::Load(number.text).GetRoot();
+        ASSERT_EQUAL_HINT(node.IsInt(), number.is_int, number.text);
+        ASSERT_EQUAL_HINT(node.AsDouble(), number.value, number.text);
+    }
+}
+
+void TestPrintNumbers() {
+    const std::vector<double> values{0.0, -0.0, 0.1, 1.0 / 3.0, 2500.0, 1e-5, 1e21, 1e308, -1e308,
+                                     5e-324, 2147483648.0, 123456.5, 1234567.0};
+    for (const std::streamsize precision : {6, 10, 17}) {
+        for (const double value : values) {
+            // Doubles are printed like the default stream format they replaced
+            std::ostringstream expected;
+            expected.precision(precision);
+            expected << value;
+            std::ostringstream output;
+            output.precision(precision);
+            json::PrintCompact(json::Node(value), output);
+            ASSERT_EQUAL_HINT(output.str(), expected.str(), std::to_string(precision));
+        }
+    }
+
+    for (const int value : {0, -1, 42, std::numeric_limits<int>::max(), std::numeric_limits<int>::min()}) {
+        std::ostringstream output;
+        json::PrintCompact(json::Node(value), output);
+        ASSERT_EQUAL(output.str(), std::to_string(value));
+    }
+}
+
+void TestUnescape() {
+    const std::vector<std::string> values{
+            ""s, "plain"s, "\"quoted\""s, "back\\slash\\"s, "line\nbreak\r\n"s,
+            "<text x=\"1\">Пустая \"остановка\"</text>\n"s, "\\n is not a line break"s};
+    for (const auto& value : values) {
+        ASSERT_EQUAL(json::Unescape(json::EscapedString(value).GetEscaped()), value);
+    }
+}
+
+/// Events of a parser as text, e.g. "key:name" or "int:1"
+class EventLog final : public json::EventHandler {
+public:
+    void Null() override {
+        events.push_back("null"s);
+    }
+    void Bool(bool value) override {
+        events.push_back(value ? "true"s : "false"s);
+    }
+    void Int(int value) override {
+        events.push_back("int:"s + std::to_string(value));
+    }
+    void Double(double value) override {
+        std::ostringstream out;
+        out << "double:"s << value;
+        events.push_back(out.str());
+    }
+    void String(std::string_view value) override {
+        events.push_back("string:"s + std::string(value));
+    }
+
+    void StartArray() override {
+        events.push_back("["s);
+    }
+    void EndArray() override {
+        events.push_back("]"s);
+    }
+
+    void StartDict() override {
+        events.push_back("{"s);
+    }
+    void Key(std::string_view key) override {
+        events.push_back("key:"s + std::string(key));
+    }
+    void EndDict() override {
+        events.push_back("}"s);
+    }
+
+    std::vector<std::string> events;
+};
+
+/// Report \p node to \p handler the way the parser reports its text
+void Replay(const json::Node& node, json::EventHandler& handler) {
+    if (node.IsNull()) {
+        handler.Null();
+    } else if (node.IsBool()) {
+        handler.Bool(node.AsBool());
+    } else if (node.IsInt()) {
+        handler.Int(node.AsInt());
+    } else if (node.IsPureDouble()) {
+        handler.Double(node.AsDouble());
+    } else if (node.IsString()) {
+        handler.String(node.AsString());
+    } else if (node.IsArray()) {
+        handler.StartArray();
+        for (const auto& element : node.AsArray()) {
+            Replay(element, handler);
+        }
+        handler.EndArray();
+    } else {
+        handler.StartDict();
+        for (const auto& [key, value] : node.AsDict()) {
+            handler.Key(key);
+            Replay(value, handler);
+        }
+        handler.EndDict();
+    }
+}
+
+/// Keys of dictionaries are sorted, so their events come in the same order as json::Dict keeps them
+const std::vector<std::string> event_texts{
+        "null"s, "true"s, "-12"s, "2.5e-3"s, R"("text with \"escapes\" Ж\n")"s, "[]"s, "{}"s,
+        R"( [1, [2, [3, []]], {"a": {"b": [false, null]}}, -0.5, "x"] )"s,
+        R"({"base_requests": [{"is_roundtrip": true, "name": "14", "stops": ["A", "B", "A"], "type": "Bus"},)"
+        R"( {"latitude": 55.6, "longitude": 37.2, "name": "A", "road_distances": {"B": 3000}, "type": "Stop"}],)"
+        R"( "routing_settings": {"bus_velocity": 30, "bus_wait_time": 2}})"s};
+
+void TestParseEvents() {
+    for (const auto& text : event_texts) {
+        EventLog expected;
+        Replay(json::Load(text).GetRoot(), expected);
+
+        EventLog from_text;
+        json::Parse(std::string_view(text), from_text);
+        ASSERT_EQUAL_HINT(from_text.events, expected.events, text);
+
+        std::istringstream input(text);
+        EventLog from_stream;
+        json::Parse(input, from_stream);
+        ASSERT_EQUAL_HINT(from_stream.events, expected.events, text);
+    }
+}
+
+void TestStreamedQueriesAnswerLikeText() {
+    const TempBaseFile base("streamed_queries"sv);
+    base.Make(two_stop_base);
+
+    // Requests are read one element at a time from a stream, and from a text that is in memory as a whole
+    const std::string text = R"({"serialization_settings": )"s + base.GetSettingsJson()
+            + R"(, "stat_requests": [{"type": "Bus", "name": "14", "id": 1}, {"id": 2, "name": "A", "type": "Stop"},)"
+              R"( {"type": "Route", "id": 3, "from": "A", "to": "B"}, {"type": "Bus", "id": 4, "name": "14"},)"
+              R"( {"type": "Stop", "id": 5, "name": "C"}]})"s;
+
+    const auto process = [](auto from) {
+        transport_catalogue::TransportCatalogue database;
+        renderer::MapRenderer renderer;
+        router::TransportRouter router;
+        queries::Handler handler(database, renderer, router);
+        std::ostringstream output;
+        handler.ProcessQueries("process_requests"sv, from, into::Json{output});
+        return output.str();
+    };
+
+    std::istringstream input(text);
+    const auto answers = process(from::Json{input});
+    ASSERT_EQUAL(answers, process(from::JsonText{text}));
+
+    const auto document = json::Load(answers);
+    const auto& responses = document.GetRoot().AsArray();
+    ASSERT_EQUAL(responses.size(), 5u);
+    ASSERT_EQUAL(responses.at(0).AsDict().at("stop_count"s).AsInt(), 3);
+    // A repeated request gets the same answer
+    auto repeated_bus = responses.at(0).AsDict();
+    repeated_bus["request_id"s] = 4;
+    ASSERT(responses.at(3) == json::Node{repeated_bus});
+    ASSERT(responses.at(1).AsDict().at("buses"s).AsArray() == json::Array{"14"s});
+    ASSERT_EQUAL(responses.at(4).AsDict().at("error_message"s).AsString(), "not found"s);
+}
+
+void TestInputSourceChunks() {
+    const std::string text = R"({"key": ["value", 1, 2.5, true, null], "other": {"nested": "\"escaped\""}})"s;
+
+    json::BufferSource buffer(text);
+    ASSERT_EQUAL(buffer.NextChunk(), std::string_view(text));
+    ASSERT(buffer.NextChunk().empty());
+
+    for (std::size_t chunk_size = 1; chunk_size <= text.size() + 1; ++chunk_size) {
+        const std::string hint = "by "s + std::to_string(chunk_size);
+        std::istringstream input(text);
+        json::StreamSource source(input, chunk_size);
+        // Every chunk is full but the last one, and the end of input stays empty
+        std::string read;
+        for (auto chunk = source.NextChunk(); !chunk.empty(); chunk = source.NextChunk()) {
+            ASSERT_HINT(chunk.size() == chunk_size || read.size() + chunk.size() == text.size(), hint);
+            read += chunk;
+        }
+        ASSERT_EQUAL_HINT(read, text, hint);
+        ASSERT_HINT(source.NextChunk().empty(), hint);
+
+        // Tokens split between chunks are parsed like a whole text
+        ASSERT_HINT(LoadByChunks(text, chunk_size) == json::Load(text).GetRoot(), hint);
+    }
+}
+
+/// Whether a view node holds the same value as a node of json::Load, which keeps the first of duplicate keys
+bool IsSameNode(const json::view::Node& view, const json::Node& node) {
+    if (node.IsNull()) {
+        return view.IsNull();
+    } else if (node.IsBool()) {
+        return view.IsBool() && view.AsBool() == node.AsBool();
+    } else if (node.IsInt()) {
+        return view.IsInt() && view.AsInt() == node.AsInt();
+    } else if (node.IsPureDouble()) {
+        return view.IsPureDouble() && view.AsDouble() == node.AsDouble();
+    } else if (node.IsString()) {
+        return view.IsString() && view.AsString() == node.AsString();
+    } else if (node.IsArray()) {
+        if (!view.IsArray() || view.AsArray().size() != node.AsArray().size()) {
+            return false;
+        }
+        return std::equal(node.AsArray().begin(), node.AsArray().end(), view.AsArray().begin(),
+                          [](const json::Node& lhs, const json::view::Node& rhs) {
+                              return IsSameNode(rhs, lhs);
+                          });
+    }
+    if (!view.IsDict()) {
+        return false;
+    }
+    const auto dict = view.AsDict();
+    for (const auto& [key, value] : dict) {
+        if (node.AsDict().count(std::string(key)) == 0) {
+            return false;
+        }
+    }
+    return std::all_of(node.AsDict().begin(), node.AsDict().end(), [&dict](const auto& member) {
+        const auto* found = dict.find(member.first);
+        return found != dict.end() && IsSameNode(found->second, member.second);
+    });
+}
+
+void TestViewDocument() {
+    const std::vector<std::string> texts{
+            "null"s, "false"s, "7"s, "-1.25"s, R"("")"s, R"("plain")"s, R"("Ж \"escaped\"\n")"s, "[]"s, "{}"s,
+            R"({"b": 1, "a": [2, {"c": "d"}], "b": 3})"s,
+            R"([{"name": "A", "name": "B"}, {"x": {"y": 1}, "x": {"y": 2, "z": 3}}, {"": 0, "": 1}])"s};
+    for (const auto& text : texts) {
+        const auto document = json::view::Load(text);
+        ASSERT_HINT(IsSameNode(document.GetRoot(), json::Load(text).GetRoot()), text);
+    }
+
+    // The first of duplicate keys wins, like for json::Dict
+    const std::string text = R"({"name": "first", "stops": ["A\tB", "C"], "name": "second"})"s;
+    const auto document = json::view::Load(text);
+    const auto dict = document.GetRoot().AsDict();
+    ASSERT_EQUAL(dict.size(), 3u);
+    ASSERT_EQUAL(dict.at("name"sv).AsString(), "first"sv);
+    ASSERT_EQUAL(std::next(dict.begin(), 2)->second.AsString(), "second"sv);
+    ASSERT(dict.find("missing"sv) == dict.end());
+    ASSERT_THROW((void) dict.at("missing"sv), std::out_of_range);
+
+    // Strings without escapes are views into the text, others are unescaped copies
+    const auto is_in_text = [&text](std::string_view str) {
+        return text.data() <= str.data() && str.data() + str.size() <= text.data() + text.size();
+    };
+    ASSERT(is_in_text(dict.at("name"sv).AsString()));
+    ASSERT(is_in_text(dict.begin()->first));
+    ASSERT_EQUAL(dict.at("stops"sv).AsArray()[0].AsString(), "A\tB"sv);
+    ASSERT(!is_in_text(dict.at("stops"sv).AsArray()[0].AsString()));
+    ASSERT(is_in_text(dict.at("stops"sv).AsArray()[1].AsString()));
+
+    // Strings of a stream outlive its chunks
+    json::view::Arena arena;
+    for (std::size_t chunk_size : {1, 3, 64}) {
+        std::istringstream input(text);
+        json::StreamSource source(input, chunk_size);
+        json::view::NodeBuilder builder(arena);
+        json::Parse(source, builder);
+        const auto node = builder.ReleaseNode();
+        ASSERT(IsSameNode(node, json::Load(text).GetRoot()));
+        ASSERT(!is_in_text(node.AsDict().at("name"sv).AsString()));
+        arena.Reset();
+    }
+}
+
+void TestArena() {
+    json::view::Arena arena(64);
+    auto* first = arena.AllocateArray<char>(1);
+    // Allocations are aligned, and ones larger than a block get a block of their own
+    for (const std::size_t alignment : {1, 2, 4, 8, 16}) {
+        const auto address = reinterpret_cast<std::uintptr_t>(arena.Allocate(3, alignment));
+        ASSERT_EQUAL(address % alignment, 0u);
+    }
+    auto* large = arena.AllocateArray<std::uint64_t>(100);
+    std::fill(large, large + 100, std::uint64_t{1});
+    ASSERT_EQUAL(arena.CopyString("copied"sv), "copied"sv);
+    ASSERT(arena.CopyString({}).empty());
+
+    // Memory is reused after a reset
+    arena.Reset();
+    ASSERT(arena.AllocateArray<char>(1) == first);
+}
+
+void TestArrayWriter() {
+    const json::Node bus = json::Load(
+            R"({"curvature": 1.5, "request_id": 1, "stops": ["A", "B \"C\""], "nested": {"x": []}})"sv).GetRoot();
+    const std::vector<json::Array> arrays{
+            {}, {json::Node{1}}, {bus, json::Node{"text\n"s}, json::Node{nullptr}, json::Node{json::Array{}}, bus}};
+
+    for (const auto& array : arrays) {
+        std::ostringstream expected;
+        json::Print(json::Document(json::Node{array}), expected);
+
+        // Elements are printed as they come, and a closed writer starts a new array
+        std::ostringstream output;
+        json::ArrayWriter writer(output);
+        for (int i = 0; i < 2; ++i) {
+            for (const auto& node : array) {
+                writer.Write(node);
+            }
+            writer.Close();
+        }
+        ASSERT_EQUAL(output.str(), expected.str() + expected.str());
+    }
+}
+
+/// Overrides the responses of stops only, so the others go to registered operations
+class StopPrintDriver final : public into::PrintDriver {
+public:
+    using PrintDriver::PrintDriver;
+    using PrintDriver::Print;
+
+    void Print(const into::StopInfoResponse& response) const override {
+        GetOutput() << "override "s << response.id << ' ' << response.name << '\n';
+    }
+};
+
+void TestResponsePrintDispatch() {
+    std::ostringstream output;
+    StopPrintDriver driver(output);
+    driver.RegisterPrintOperation<into::StopInfoResponse>([](std::ostream& out, const void*) {
+        out << "registered stop\n"s;
+    });
+    driver.RegisterPrintOperation<into::BusInfoResponse>([](std::ostream& out, const void* object) {
+        const auto& response = *static_cast<const into::BusInfoResponse*>(object);
+        out << "registered bus "s << response.id << ' ' << response.name << '\n';
+    });
+    // Types other than built-in responses are printed only with registered operations
+    driver.RegisterPrintOperation<std::string>([](std::ostream& out, const void* object) {
+        out << "registered string "s << *static_cast<const std::string*>(object) << '\n';
+    });
+
+    {
+        const into::Printer printer(driver);
+        printer.Print(into::StopInfoResponse{1, "A"sv, std::nullopt});
+        printer.Print(into::BusInfoResponse{2, "14"sv, std::nullopt});
+        printer.Print("plugin"s);
+    }
+    ASSERT_EQUAL(output.str(), "override 1 A\nregistered bus 2 14\nregistered string plugin\n"s);
+
+    // A driver without overrides looks every response up
+    output.str({});
+    into::PrintDriver base_driver(output);
+    base_driver.RegisterPrintOperation<into::StopInfoResponse>([](std::ostream& out, const void*) {
+        out << "registered stop\n"s;
+    });
+    into::Printer(base_driver).Print(into::StopInfoResponse{3, "B"sv, std::nullopt});
+    ASSERT_EQUAL(output.str(), "registered stop\n"s);
+}
+
+} // namespace
+
+void RunAll() {
+    RUN_TEST(TestIsClose);
+    RUN_TEST(TestShortPaths);
+    RUN_TEST(TestNearIdenticalPoints);
+    RUN_TEST(TestAntipodalPoints);
+    RUN_TEST(TestRandomPoints);
+    RUN_TEST(TestNearestStops);
+    RUN_TEST(TestNearestStopsAcrossAntimeridian);
+    RUN_TEST(TestStopsInBox);
+    RUN_TEST(TestStopsInBoxAtAntimeridian);
+    RUN_TEST(TestClosePairs);
+    RUN_TEST(TestClosePairsAcrossAntimeridian);
+    RUN_TEST(TestClosePairsAtHighLatitudes);
+    RUN_TEST(TestStopIndexIsBuiltOnce);
+    RUN_TEST(TestStopIndexFollowsAddedStops);
+    RUN_TEST(TestPrecomputedStatistics);
+    RUN_TEST(TestMultiSourceRoute);
+    RUN_TEST(TestAddressRouteWalksToStops);
+    RUN_TEST(TestAddressRouteWalksDirectly);
+    RUN_TEST(TestAddressRouteWithoutWalkingStops);
+    RUN_TEST(TestRouteWalksBetweenCloseStops);
+    RUN_TEST(TestChecksums);
+    RUN_TEST(TestDeflateGoldenBytes);
+    RUN_TEST(TestPngGoldenBytes);
+    RUN_TEST(TestRasterizeScaled);
+    RUN_TEST(TestStreamedBusesRenderLikeWholeMap);
+    RUN_TEST(TestMapIsEncodedOnce);
+    RUN_TEST(TestDocumentStoresShapesByValue);
+    RUN_TEST(TestEscapingBuffer);
+    RUN_TEST(TestRenderParts);
+    RUN_TEST(TestSignificanceSimplifiesLikeDouglasPeucker);
+    RUN_TEST(TestTileSelection);
+    RUN_TEST(TestMapResponseMatchesFreshRender);
+    RUN_TEST(TestItineraryOverlaysMap);
+    RUN_TEST(TestStreamSettingsApplyToLoadedBase);
+    RUN_TEST(TestFailedQueryClosesResponses);
+    RUN_TEST(TestStreamErrors);
+    RUN_TEST(TestParseEndpoint);
+    RUN_TEST(TestLatencyPercentiles);
+    RUN_TEST(TestSnapshotReload);
+    RUN_TEST(TestScanBoundaries);
+    RUN_TEST(TestStringsAtVectorBoundaries);
+    RUN_TEST(TestNumbers);
+    RUN_TEST(TestPrintNumbers);
+    RUN_TEST(TestUnescape);
+    RUN_TEST(TestParseEvents);
+    RUN_TEST(TestStreamedQueriesAnswerLikeText);
+    RUN_TEST(TestInputSourceChunks);
+    RUN_TEST(TestViewDocument);
+    RUN_TEST(TestArena);
+    RUN_TEST(TestArrayWriter);
+    RUN_TEST(TestResponsePrintDispatch);
+}
+
+} // namespace unit_tests
\ No newline at end of file
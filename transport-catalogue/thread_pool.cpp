@@ -0,0 +1,62 @@
+#include "thread_pool.h"
+
+namespace thread_pool {
+
+namespace {
+
+thread_local bool is_worker_thread = false;
+
+} // namespace
+
+ThreadPool::ThreadPool(std::size_t thread_count) {
+    if (thread_count == 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    workers_.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this] {
+            Work();
+        });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard guard(mutex_);
+        is_stopped_ = true;
+    }
+    has_task_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+std::size_t ThreadPool::GetThreadCount() const noexcept {
+    return workers_.size();
+}
+
+bool ThreadPool::IsWorkerThread() noexcept {
+    return is_worker_thread;
+}
+
+void ThreadPool::Work() {
+    is_worker_thread = true;
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(mutex_);
+            has_task_.wait(lock, [this] {
+                return is_stopped_ || !tasks_.empty();
+            });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+} // namespace thread_pool
\ No newline at end of file
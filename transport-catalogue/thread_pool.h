@@ -0,0 +1,116 @@
+/// \file
+/// Fixed-size pool of worker threads
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace thread_pool {
+
+class ThreadPool final {
+public:
+    /// Zero \p thread_count means as many threads as the hardware supports
+    explicit ThreadPool(std::size_t thread_count = 0);
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Wait for all submitted tasks and join the workers
+    ~ThreadPool();
+
+    [[nodiscard]] std::size_t GetThreadCount() const noexcept;
+
+    /// Whether the calling thread is a worker of any pool, which should not start more threads of its own
+    [[nodiscard]] static bool IsWorkerThread() noexcept;
+
+    template<typename Func>
+    [[nodiscard]] std::future<std::invoke_result_t<Func>> Submit(Func func);
+
+    /// Run \p func without a way to wait for it, which saves the shared state of a future.
+    /// \p func must not throw
+    template<typename Func>
+    void Post(Func func);
+
+    /// Call \p func(index) for every index in [0, \p count) and wait for all of the calls.
+    /// The first exception thrown by \p func is rethrown
+    template<typename Func>
+    void ParallelFor(std::size_t count, Func func);
+
+private:
+    std::mutex mutex_;
+    std::condition_variable has_task_;
+    std::deque<std::function<void()>> tasks_;
+    bool is_stopped_ = false;
+    std::vector<std::thread> workers_;
+
+    void Work();
+};
+
+template<typename Func>
+std::future<std::invoke_result_t<Func>> ThreadPool::Submit(Func func) {
+    using Result = std::invoke_result_t<Func>;
+
+    // std::function requires copyable targets, while std::packaged_task is move-only
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+    auto future = task->get_future();
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.emplace_back([task] {
+            (*task)();
+        });
+    }
+    has_task_.notify_one();
+    return future;
+}
+
+template<typename Func>
+void ThreadPool::Post(Func func) {
+    {
+        std::lock_guard guard(mutex_);
+        tasks_.emplace_back(std::move(func));
+    }
+    has_task_.notify_one();
+}
+
+template<typename Func>
+void ThreadPool::ParallelFor(std::size_t count, Func func) {
+    if (count == 0) {
+        return;
+    }
+
+    // Several chunks per worker smooth out an uneven cost of indices
+    constexpr std::size_t chunks_per_thread = 4;
+    const std::size_t chunk_count = std::min(count, GetThreadCount() * chunks_per_thread);
+    const std::size_t chunk_size = (count + chunk_count - 1) / chunk_count;
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(chunk_count);
+    for (std::size_t first = 0; first < count; first += chunk_size) {
+        const std::size_t last = std::min(count, first + chunk_size);
+        futures.push_back(Submit([&func, first, last] {
+            for (std::size_t index = first; index < last; ++index) {
+                func(index);
+            }
+        }));
+    }
+
+    // Wait for every chunk before rethrowing, since chunks refer to func
+    for (auto& future : futures) {
+        future.wait();
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+}
+
+} // namespace thread_pool
\ No newline at end of file
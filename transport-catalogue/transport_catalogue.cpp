@@ -2,14 +2,19 @@
 
 #include "kahan_algorithm.h"
 
+#include <cassert>
 #include <unordered_set>
 
 namespace transport_catalogue {
 
 void TransportCatalogue::AddStop(Stop stop) {
+    stop.trig_coordinates = geo::TrigCoordinates(stop.coordinates);
     stops_.push_back(std::move(stop));
     StopPtr stop_ptr = &stops_.back();
     stop_indices_.emplace(stop_ptr->name, stop_ptr);
+    if (stop_index_storage_->is_built.load(std::memory_order_acquire)) {
+        stop_index_storage_ = std::make_unique<StopIndexStorage>();
+    }
 }
 
 void TransportCatalogue::AddBus(Bus bus) {
@@ -78,6 +83,39 @@ TransportCatalogue::DistanceRange TransportCatalogue::GetDistances() const noexc
     return ranges::AsConstRange(distances_);
 }
 
+// Spatial queries
+
+const spatial::StopIndex& TransportCatalogue::GetStopIndex() const {
+    StopIndexStorage& storage = *stop_index_storage_;
+    std::call_once(storage.built, [this, &storage] {
+        std::vector<StopPtr> stops;
+        stops.reserve(stops_.size());
+        for (const Stop& stop : stops_) {
+            stops.push_back(&stop);
+        }
+        storage.stop_index.emplace(std::move(stops));
+        storage.is_built.store(true, std::memory_order_release);
+    });
+    return storage.stop_index.value();
+}
+
+void TransportCatalogue::SetStopIndex(spatial::StopIndex stop_index) {
+    stop_index_storage_ = std::make_unique<StopIndexStorage>();
+    StopIndexStorage& storage = *stop_index_storage_;
+    std::call_once(storage.built, [&storage, &stop_index] {
+        storage.stop_index.emplace(std::move(stop_index));
+        storage.is_built.store(true, std::memory_order_release);
+    });
+}
+
+std::vector<spatial::Neighbour> TransportCatalogue::FindNearestStops(geo::Coordinates point, std::size_t count) const {
+    return GetStopIndex().FindNearest(point, count);
+}
+
+std::vector<StopPtr> TransportCatalogue::FindStopsInBox(spatial::BoundingBox box) const {
+    return GetStopIndex().FindInBox(box);
+}
+
 // Statistics
 
 std::optional<const TransportCatalogue::StopInfo*> TransportCatalogue::GetStopInfo(std::string_view stop_name) const {
@@ -105,7 +143,41 @@ std::optional<const TransportCatalogue::BusInfo*> TransportCatalogue::GetBusInfo
     if (auto bus_stat_iter = bus_infos_.find(bus.value()); bus_stat_iter != bus_infos_.end()) {
         return &bus_stat_iter->second;
     }
-    return &ComputeBusInfo(*bus.value());
+    auto [bus_info_iter, _] = bus_infos_.emplace(bus.value(), ComputeBusInfo(*bus.value()));
+    return &bus_info_iter->second;
+}
+
+void TransportCatalogue::PrecomputeStatistics(thread_pool::ThreadPool& pool) {
+    // Workers must only fill values in place, so all the entries are inserted beforehand
+    std::vector<StopInfoStorage*> stop_info_storages;
+    stop_info_storages.reserve(stops_.size());
+    for (const Stop& stop : stops_) {
+        auto [stop_info_iter, _] = stop_infos_.try_emplace(&stop);
+        stop_info_storages.push_back(&stop_info_iter->second);
+    }
+
+    std::vector<std::pair<BusPtr, BusInfo*>> bus_infos;
+    bus_infos.reserve(buses_.size());
+    for (const Bus& bus : buses_) {
+        auto [bus_info_iter, _] = bus_infos_.try_emplace(&bus);
+        bus_infos.emplace_back(&bus, &bus_info_iter->second);
+    }
+
+    pool.ParallelFor(stop_info_storages.size(), [&stop_info_storages](std::size_t index) {
+        PrepareStopInfo(*stop_info_storages[index]);
+    });
+    pool.ParallelFor(bus_infos.size(), [this, &bus_infos](std::size_t index) {
+        auto [bus_ptr, bus_info_ptr] = bus_infos[index];
+        *bus_info_ptr = ComputeBusInfo(*bus_ptr);
+    });
+}
+
+void TransportCatalogue::SetStopInfo(StopPtr stop_ptr, StopInfo stop_info) {
+    stop_infos_.insert_or_assign(stop_ptr, StopInfoStorage{std::move(stop_info), true});
+}
+
+void TransportCatalogue::SetBusInfo(BusPtr bus_ptr, BusInfo bus_info) {
+    bus_infos_.insert_or_assign(bus_ptr, bus_info);
 }
 
 const TransportCatalogue::StopInfo& TransportCatalogue::PrepareStopInfo(StopInfoStorage& stop_info_storage) {
@@ -123,9 +195,8 @@ const TransportCatalogue::StopInfo& TransportCatalogue::PrepareStopInfo(StopInfo
     return stop_info_storage.stop_info;
 }
 
-const TransportCatalogue::BusInfo& TransportCatalogue::ComputeBusInfo(const Bus& bus) const {
-    auto [bus_info_iter, _] = bus_infos_.emplace(&bus, BusInfo{});
-    BusInfo& bus_info = bus_info_iter->second;
+TransportCatalogue::BusInfo TransportCatalogue::ComputeBusInfo(const Bus& bus) const {
+    BusInfo bus_info;
 
     const auto& stops = bus.stops;
     std::unordered_set<const Stop*> unique_stops;
@@ -151,16 +222,25 @@ TransportCatalogue::BusInfo::Length TransportCatalogue::ComputeFullRouteDistance
     kahan_algorithm::Summation<geo::Meter> sum_geo_length;
 
     const auto& stops = bus.stops;
+    geo::Path path;
+    path.Reserve(stops.size());
+    for (StopPtr stop_ptr : stops) {
+        path.PushBack(stop_ptr->trig_coordinates);
+    }
+    const std::vector<geo::Meter> geo_distances = path.ComputeSegmentDistances();
+
+    auto geo_distance_iter = geo_distances.begin();
     for (const auto [stop_ptr_from, stop_ptr_to] : Zip(stops, Drop(stops, 1))) {
-        sum_route_length += GetDistance(*stop_ptr_from, *stop_ptr_to).value_or(geo::Meter{0});
-        sum_geo_length += GetGeoDistance(*stop_ptr_from, *stop_ptr_to);
+        sum_route_length += FindDistance(*stop_ptr_from, *stop_ptr_to).value_or(geo::Meter{0});
+        assert(geo::IsClose(*geo_distance_iter, GetGeoDistance(*stop_ptr_from, *stop_ptr_to)));
+        sum_geo_length += *geo_distance_iter++;
     }
     length.geo = sum_geo_length.Get();
 
     if (bus.route_type == Bus::RouteType::Half) {
         length.geo *= 2;
         for (const auto [stop_ptr_from, stop_ptr_to] : Zip(Reverse(stops), Drop(Reverse(stops), 1))) {
-            sum_route_length += GetDistance(*stop_ptr_from, *stop_ptr_to).value_or(geo::Meter{0});
+            sum_route_length += FindDistance(*stop_ptr_from, *stop_ptr_to).value_or(geo::Meter{0});
         }
     }
     length.route = sum_route_length.Get();
@@ -187,4 +267,14 @@ std::optional<geo::Meter> TransportCatalogue::GetDistance(const Stop& from, cons
     return distance;
 }
 
+std::optional<geo::Meter> TransportCatalogue::FindDistance(const Stop& from, const Stop& to) const {
+    if (auto from_to_iter = distances_.find({&from, &to}); from_to_iter != distances_.end()) {
+        return from_to_iter->second;
+    }
+    if (auto to_from_iter = distances_.find({&to, &from}); to_from_iter != distances_.end()) {
+        return to_from_iter->second;
+    }
+    return std::nullopt;
+}
+
 } // namespace transport_catalogue
\ No newline at end of file
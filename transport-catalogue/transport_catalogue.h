@@ -6,9 +6,14 @@
 #include "geo.h"
 #include "domain.h"
 #include "ranges.h"
+#include "spatial_index.h"
+#include "thread_pool.h"
 
 #include <algorithm>
+#include <atomic>
 #include <deque>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -49,6 +54,15 @@ public:
     [[nodiscard]] BusRange GetAllBuses() const noexcept;
     [[nodiscard]] DistanceRange GetDistances() const noexcept;
 
+    // Spatial queries
+
+    /// Built on the first call and shared by later ones. Safe to call from several threads
+    [[nodiscard]] const spatial::StopIndex& GetStopIndex() const;
+    void SetStopIndex(spatial::StopIndex stop_index);
+
+    [[nodiscard]] std::vector<spatial::Neighbour> FindNearestStops(geo::Coordinates point, std::size_t count) const;
+    [[nodiscard]] std::vector<StopPtr> FindStopsInBox(spatial::BoundingBox box) const;
+
     // Statistics
 
     struct StopInfo {
@@ -70,6 +84,13 @@ public:
 
     [[nodiscard]] std::optional<const BusInfo*> GetBusInfo(std::string_view bus_name) const;
 
+    /// Compute statistics of all stops and buses at once instead of lazily on queries
+    void PrecomputeStatistics(thread_pool::ThreadPool& pool);
+
+    /// Restore statistics that have been already computed, e.g. by deserialization
+    void SetStopInfo(StopPtr stop_ptr, StopInfo stop_info);
+    void SetBusInfo(BusPtr bus_ptr, BusInfo bus_info);
+
 private:
     template<typename Value>
     using Indices = std::unordered_map<std::string_view, Value>;
@@ -80,6 +101,16 @@ private:
     std::deque<Bus> buses_;
     Indices<BusPtr> bus_indices_;
 
+    struct StopIndexStorage {
+        std::once_flag built;
+        /// Set once the index is built, so that adding stops to a base that has not been queried yet is cheap
+        std::atomic_bool is_built{false};
+        std::optional<spatial::StopIndex> stop_index;
+    };
+
+    /// Replaced as a whole when stops are added after the index is built, since a once_flag cannot be reset
+    std::unique_ptr<StopIndexStorage> stop_index_storage_ = std::make_unique<StopIndexStorage>();
+
     // Statistics
 
     struct StopInfoStorage {
@@ -92,7 +123,7 @@ private:
 
     static const StopInfo& PrepareStopInfo(StopInfoStorage& stop_info_storage);
 
-    const BusInfo& ComputeBusInfo(const Bus& bus) const;
+    [[nodiscard]] BusInfo ComputeBusInfo(const Bus& bus) const;
 
     // Distance
 
@@ -101,6 +132,9 @@ private:
     mutable std::unordered_map<std::pair<StopPtr, StopPtr>, geo::Meter, StopPtrPairHasher> distances_;
 
     [[nodiscard]] std::optional<geo::Meter> GetDistance(const Stop& from, const Stop& to) const;
+
+    /// Unlike GetDistance, does not cache the reversed pair, so it is safe to call concurrently
+    [[nodiscard]] std::optional<geo::Meter> FindDistance(const Stop& from, const Stop& to) const;
 };
 
 template<typename StopContainer>
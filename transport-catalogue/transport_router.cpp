@@ -17,6 +17,9 @@ void TransportRouter::InitializeRouter(const TransportCatalogue& database) {
         using namespace std::string_literals;
         throw std::logic_error("Settings must be initialized before a router creation"s);
     }
+    // The router may be rebuilt after the base has changed
+    router_.reset();
+    indices_ = {};
 
     const auto& stops = database.GetAllStops();
     const auto vertex_count = std::distance(stops.begin(), stops.end()) * 2;
@@ -42,9 +45,24 @@ void TransportRouter::InitializeRouter(const TransportCatalogue& database) {
         }
     }
 
+    AddWalkingEdges();
+
     router_.emplace(graph_);
 }
 
+void TransportRouter::AddWalkingEdges() {
+    if (settings_->max_walk_distance <= geo::Meter{0.0}) {
+        return;
+    }
+
+    const spatial::StopGrid grid(indices_.vertex_id_to_stop_, settings_->max_walk_distance);
+    grid.ForEachClosePair([this](StopPtr lhs, StopPtr rhs, geo::Meter distance) {
+        const auto time = Minute::ComputeTime(distance, settings_->walking_velocity);
+        graph_.AddEdge({GetStartWaitingVertexId(lhs), GetStartWaitingVertexId(rhs), WalkItem{time}});
+        graph_.AddEdge({GetStartWaitingVertexId(rhs), GetStartWaitingVertexId(lhs), WalkItem{time}});
+    });
+}
+
 void TransportRouter::InitializeRouter(const TransportCatalogue& database,
                                        graph::DirectedWeightedGraph<Item> graph,
                                        graph::Router<Item>::RoutesInternalData routes_internal_data) {
@@ -112,6 +130,49 @@ TransportRouter::Result TransportRouter::GetRouteBetweenStops(StopPtr from_ptr,
     return Result(std::move(route_info), *this);
 }
 
+TransportRouter::Result TransportRouter::GetRouteBetweenPoints(
+        geo::Coordinates from, const std::vector<spatial::Neighbour>& origins,
+        geo::Coordinates to, const std::vector<spatial::Neighbour>& destinations) const {
+    if (!router_.has_value()) {
+        throw std::logic_error("Route must be initialized before a route computation"s);
+    }
+
+    using Endpoint = graph::Router<Item>::Endpoint;
+
+    const auto get_endpoints = [this](const std::vector<spatial::Neighbour>& neighbours) {
+        std::vector<Endpoint> endpoints;
+        endpoints.reserve(neighbours.size());
+        for (const auto& [stop_ptr, distance] : neighbours) {
+            endpoints.push_back({GetStartWaitingVertexId(stop_ptr),
+                                 WalkItem{Minute::ComputeTime(distance, settings_->walking_velocity)}});
+        }
+        return endpoints;
+    };
+
+    const Minute direct_walk_time = Minute::ComputeTime(geo::ComputeDistance(from, to), settings_->walking_velocity);
+
+    auto multi_route_info = router_->BuildRoute(get_endpoints(origins), get_endpoints(destinations));
+    if (multi_route_info.has_value()) {
+        const auto& origin = origins[multi_route_info->source_index];
+        const auto& destination = destinations[multi_route_info->target_index];
+        const Minute start_walk_time = Minute::ComputeTime(origin.distance, settings_->walking_velocity);
+        const Minute finish_walk_time = Minute::ComputeTime(destination.distance, settings_->walking_velocity);
+        const Minute total_time = start_walk_time + multi_route_info->route.weight.GetTime() + finish_walk_time;
+
+        if (total_time < direct_walk_time) {
+            multi_route_info->route.weight = CombineItem{total_time};
+            Result result(std::move(multi_route_info->route), *this);
+            result.start_walk_ = Result::Walk{origin.stop, start_walk_time};
+            result.finish_walk_ = Result::Walk{destination.stop, finish_walk_time};
+            return result;
+        }
+    }
+
+    Result result(graph::Router<Item>::RouteInfo{CombineItem{direct_walk_time}, {}}, *this);
+    result.start_walk_ = Result::Walk{nullptr, direct_walk_time};
+    return result;
+}
+
 graph::VertexId TransportRouter::GetStartWaitingVertexId(StopPtr stop_ptr) const {
     return indices_.stop_to_start_waiting_vertex_.at(stop_ptr);
 }
@@ -159,6 +220,10 @@ bool TransportRouter::Item::IsBusItem() const noexcept {
     return std::holds_alternative<BusItem>(*this);
 }
 
+bool TransportRouter::Item::IsWalkItem() const noexcept {
+    return std::holds_alternative<WalkItem>(*this);
+}
+
 const TransportRouter::WaitItem& TransportRouter::Item::GetWaitItem() const {
     return std::get<WaitItem>(*this);
 }
@@ -167,6 +232,10 @@ const TransportRouter::BusItem& TransportRouter::Item::GetBusItem() const {
     return std::get<BusItem>(*this);
 }
 
+const TransportRouter::WalkItem& TransportRouter::Item::GetWalkItem() const {
+    return std::get<WalkItem>(*this);
+}
+
 // Result
 
 TransportRouter::Result::operator bool() const noexcept {
@@ -189,6 +258,10 @@ graph::VertexId TransportRouter::Result::GetVertexId(graph::EdgeId edge_id) cons
     return router_.graph_.GetEdge(edge_id).from;
 }
 
+graph::VertexId TransportRouter::Result::GetTargetVertexId(graph::EdgeId edge_id) const {
+    return router_.graph_.GetEdge(edge_id).to;
+}
+
 TransportRouter::Item TransportRouter::Result::GetItem(graph::EdgeId edge_id) const {
     return router_.graph_.GetEdge(edge_id).weight;
 }
@@ -201,6 +274,14 @@ const Bus& TransportRouter::Result::GetBusBy(graph::EdgeId edge_id) const {
     return *router_.indices_.edge_id_to_bus_.at(edge_id);
 }
 
+const std::optional<TransportRouter::Result::Walk>& TransportRouter::Result::GetStartWalk() const noexcept {
+    return start_walk_;
+}
+
+const std::optional<TransportRouter::Result::Walk>& TransportRouter::Result::GetFinishWalk() const noexcept {
+    return finish_walk_;
+}
+
 TransportRouter::Result::Result(std::optional<graph::Router<Item>::RouteInfo> route_info, const TransportRouter& router)
         : route_info_(std::move(route_info))
         , router_(router) {
@@ -7,6 +7,7 @@
 #include "graph.h"
 #include "router.h"
 #include "transport_catalogue.h"
+#include "spatial_index.h"
 
 #include <optional>
 #include <stdexcept>
@@ -45,6 +46,9 @@ public:
 struct Settings {
     Minute bus_wait_time;
     KmPerHour bus_velocity;
+    KmPerHour walking_velocity{5.0};
+    unsigned int walking_stop_count = 3;
+    geo::Meter max_walk_distance{0.0};
 };
 
 class TransportRouter final {
@@ -64,7 +68,11 @@ public:
         unsigned int span_count = 0;
     };
 
-    using ItemVariant = std::variant<CombineItem, WaitItem, BusItem>;
+    struct WalkItem {
+        Minute time;
+    };
+
+    using ItemVariant = std::variant<CombineItem, WaitItem, BusItem, WalkItem>;
 
     class Item : private ItemVariant {
     public:
@@ -80,9 +88,11 @@ public:
 
         [[nodiscard]] bool IsWaitItem() const noexcept;
         [[nodiscard]] bool IsBusItem() const noexcept;
+        [[nodiscard]] bool IsWalkItem() const noexcept;
 
         [[nodiscard]] const WaitItem& GetWaitItem() const;
         [[nodiscard]] const BusItem& GetBusItem() const;
+        [[nodiscard]] const WalkItem& GetWalkItem() const;
     };
 
     void Initialize(Settings settings);
@@ -113,19 +123,35 @@ public:
 
         [[nodiscard]] Minute GetTotalTime() const;
         [[nodiscard]] graph::VertexId GetVertexId(graph::EdgeId edge_id) const;
+        [[nodiscard]] graph::VertexId GetTargetVertexId(graph::EdgeId edge_id) const;
         [[nodiscard]] Item GetItem(graph::EdgeId edge_id) const;
         [[nodiscard]] const Stop& GetStopBy(graph::VertexId vertex_id) const;
         [[nodiscard]] const Bus& GetBusBy(graph::EdgeId edge_id) const;
+
+        /// Walking leg between an address and a stop of a route; the stop is null if the whole route is a walk
+        struct Walk {
+            StopPtr stop = nullptr;
+            Minute time;
+        };
+
+        [[nodiscard]] const std::optional<Walk>& GetStartWalk() const noexcept;
+        [[nodiscard]] const std::optional<Walk>& GetFinishWalk() const noexcept;
     private:
         friend TransportRouter;
         explicit Result(std::optional<graph::Router<Item>::RouteInfo> route_info, const TransportRouter& router);
 
         std::optional<graph::Router<Item>::RouteInfo> route_info_;
         const TransportRouter& router_;
+        std::optional<Walk> start_walk_;
+        std::optional<Walk> finish_walk_;
     };
 
     [[nodiscard]] Result GetRouteBetweenStops(StopPtr from_ptr, StopPtr to_ptr) const;
 
+    /// Route between two addresses that starts and finishes with walking to one of the given nearby stops
+    [[nodiscard]] Result GetRouteBetweenPoints(geo::Coordinates from, const std::vector<spatial::Neighbour>& origins,
+                                               geo::Coordinates to, const std::vector<spatial::Neighbour>& destinations) const;
+
 private:
     std::optional<Settings> settings_;
     graph::DirectedWeightedGraph<Item> graph_;
@@ -142,6 +168,8 @@ private:
     [[nodiscard]] graph::VertexId GetStartWaitingVertexId(StopPtr stop_ptr) const;
     [[nodiscard]] graph::VertexId GetStartDrivingVertexId(StopPtr stop_ptr) const;
 
+    void AddWalkingEdges();
+
     template<typename StopContainer, typename DistanceGetter>
     void AddEdges(BusPtr bus_ptr, const StopContainer& stops, const DistanceGetter& distance_getter) {
         unsigned int drop_count = 1;